@@ -10,6 +10,7 @@
 
 #include "anglemarker.h"
 #include "atom.h"
+#include "bondgeometry.h"
 #include "defines.h"
 #include "drawinginfo.h"
 #include "label.h"
@@ -36,6 +37,8 @@ class Angle : public QGraphicsPathItem
         return myLabel;
     };
     void updatePosition();
+    // Puts the marker and label where the batched geometry code worked out they should go
+    void setPlacement(const BondGeometry::AnglePlacement &placement);
     Atom *startAtom() const
     {
         return myStartAtom;
@@ -1,4 +1,5 @@
 #include "anglemarker.h"
+#include "svgwriter.h"
 
 AngleMarker::AngleMarker(DrawingInfo *info, QGraphicsItem *parent)
     : QGraphicsPathItem(parent), drawingInfo(info), myColor(Qt::black), hoverOver(false),
@@ -32,21 +33,41 @@ void AngleMarker::hoverLeaveEvent(QGraphicsSceneHoverEvent *event)
     update();
 }
 
+QRectF AngleMarker::boundingRect() const
+{
+    // Enough room for the thicker line drawn while hovering
+    double margin = 0.75 * effectiveWidth;
+    return path().controlPointRect().adjusted(-margin, -margin, margin, margin);
+}
+
 void AngleMarker::paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget)
 {
     Q_UNUSED(option);
     Q_UNUSED(widget);
-    myPen.setWidthF(hoverOver ? 1.5 * effectiveWidth : effectiveWidth);
-    myPen.setColor(Qt::black);
-    painter->setPen(myPen);
+    QPen pen(myPen);
+    pen.setWidthF(hoverOver ? 1.5 * effectiveWidth : effectiveWidth);
+    pen.setColor(Qt::black);
+    painter->setPen(pen);
     painter->drawPath(path());
     if (isSelected()) {
-        myPen.setColor(SELECTED_COLOR);
-        painter->setPen(myPen);
+        pen.setColor(SELECTED_COLOR);
+        painter->setPen(pen);
         painter->drawPath(path());
     }
 }
 
+void AngleMarker::writeSvg(SvgWriter *svg)
+{
+    QPen pen(myPen);
+    pen.setWidthF(hoverOver ? 1.5 * effectiveWidth : effectiveWidth);
+    pen.setColor(Qt::black);
+    svg->writePath(path(), pen);
+    if (isSelected()) {
+        pen.setColor(SELECTED_COLOR);
+        svg->writePath(path(), pen);
+    }
+}
+
 void AngleMarker::serialize(QXmlStreamWriter *writer)
 {
     writer->writeStartElement("AngleMarker");
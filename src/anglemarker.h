@@ -9,6 +9,8 @@
 #include "defines.h"
 #include "drawinginfo.h"
 
+class SvgWriter;
+
 class AngleMarker : public QGraphicsPathItem
 {
   public:
@@ -20,6 +22,7 @@ class AngleMarker : public QGraphicsPathItem
 
     AngleMarker(DrawingInfo *drawingInfo, QGraphicsItem *parent = 0);
 
+    QRectF boundingRect() const;
     void paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget = 0);
     void setOtherMarker(AngleMarker *marker)
     {
@@ -28,8 +31,10 @@ class AngleMarker : public QGraphicsPathItem
     void setHover(bool t_f)
     {
         hoverOver = t_f;
+        update();
     }
 
+    void writeSvg(SvgWriter *svg);
     void serialize(QXmlStreamWriter *writer);
     static AngleMarker *deserialize(QXmlStreamReader *reader, DrawingInfo *drawingInfo);
 
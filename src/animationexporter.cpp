@@ -0,0 +1,275 @@
+#include "animationexporter.h"
+
+#include <QBuffer>
+#include <QCoreApplication>
+#include <QFile>
+#include <QFileInfo>
+#include <QPageSize>
+#include <QPainter>
+#include <QPdfWriter>
+#include <QRunnable>
+#include <QStringList>
+#include <QThread>
+#include <QThreadPool>
+
+#include "apngwriter.h"
+#include "imagewriter.h"
+
+class FrameRenderTask : public QRunnable
+{
+  public:
+    FrameRenderTask(AnimationExporter *exporter, FileParser *frameParser, int frame)
+        : myExporter(exporter), myFrameParser(frameParser), myFrame(frame)
+    {
+    }
+
+    ~FrameRenderTask()
+    {
+        delete myFrameParser;
+    }
+
+    void run()
+    {
+        myExporter->frameDone(myFrame, myExporter->renderFrame(myFrameParser));
+    }
+
+  private:
+    AnimationExporter *myExporter;
+    FileParser *myFrameParser;
+    int myFrame;
+};
+
+// Atoms tell the user about symbols they don't know with a message box, which can't be shown from
+// the workers, so each frame's symbols are checked before it's handed over
+static QString unknownSymbol(const FileParser *frameParser)
+{
+    const AtomLabels *labels = frameParser->labels();
+    for (int i = 0; i < labels->size(); ++i) {
+        QString label = labels->label(i);
+        if (!Atom::hasKnownMass(label)) {
+            return label;
+        }
+    }
+    return QString();
+}
+
+AnimationExporter::AnimationExporter(FileParser *parser, DrawingInfo *info, DrawingCanvas *canvas)
+    : myParser(parser), mySceneRect(canvas->sceneRect()), myBackground(canvas->backgroundBrush()),
+      myLabeledBonds(canvas->labeledBonds()), myStyles(canvas->itemStyles()), myFormat(Unknown),
+      myFrameDelay(DEFAULT_ANIMATION_FRAME_DELAY_MS), myDotsPerInch(DEFAULT_IMAGE_DPI),
+      myProgress(0)
+{
+    mySettings.copySettings(info);
+}
+
+AnimationExporter::Format AnimationExporter::determineFormat(const QString &fileName)
+{
+    QString suffix = QFileInfo(fileName).suffix().toLower();
+    if (suffix == "png") {
+        return PNGSequence;
+    }
+    if (suffix == "apng") {
+        return APNG;
+    }
+    if (suffix == "pdf") {
+        return PDF;
+    }
+    return Unknown;
+}
+
+QString AnimationExporter::sequenceFileName(const QString &fileName, int frame, int last)
+{
+    QFileInfo info(fileName);
+    int digits = QString::number(last + 1).size();
+    return info.path() + "/" + info.completeBaseName() +
+           QString("_%1.png").arg(frame + 1, digits, 10, QChar('0'));
+}
+
+AnimationExporter::RenderedFrame AnimationExporter::renderFrame(FileParser *frameParser) const
+{
+    DrawingInfo info;
+    info.copySettings(&mySettings);
+    DrawingCanvas canvas(&info, frameParser);
+    // Frames from a project have no file name, so the canvas won't have loaded them itself
+    if (frameParser->fileName().isEmpty()) {
+        canvas.loadFromParser();
+    }
+    canvas.setSceneRect(mySceneRect);
+    canvas.setBackgroundBrush(myBackground);
+    canvas.applyItemStyles(myStyles);
+    int numBonds = canvas.getBonds().size();
+    foreach (int bond, myLabeledBonds) {
+        if (bond < numBonds) {
+            canvas.addBondLabel(bond);
+        }
+    }
+    // Loading sized the molecule to fit this frame alone, so go back to the view's scale to stop
+    // the animation from zooming in and out
+    info.setMoleculeMaxDimension(mySettings.moleculeMaxDimension());
+    info.determineScaleFactor();
+    canvas.refresh();
+
+    RenderedFrame rendered;
+    if (myFormat == PDF) {
+        QRectF target(QPointF(0.0, 0.0), ImageWriter::outputSize(mySceneRect));
+        ImageWriter::render(&canvas, &rendered.picture, target);
+    } else {
+        // Compressing is a good part of the work, so it's done here rather than by the writer
+        QBuffer buffer(&rendered.png);
+        buffer.open(QIODevice::WriteOnly);
+        ImageWriter::renderImage(&canvas, myDotsPerInch).save(&buffer, "PNG");
+    }
+    return rendered;
+}
+
+void AnimationExporter::frameDone(int frame, const RenderedFrame &rendered)
+{
+    QMutexLocker locker(&myLock);
+    myFinishedFrames.insert(frame, rendered);
+    myFrameReady.wakeAll();
+}
+
+bool AnimationExporter::waitForFrame(int frame, RenderedFrame *rendered)
+{
+    QMutexLocker locker(&myLock);
+    while (!myFinishedFrames.contains(frame)) {
+        myFrameReady.wait(&myLock, 50);
+        if (myProgress) {
+            // Keep the progress dialog responsive while the workers are busy
+            locker.unlock();
+            QCoreApplication::processEvents();
+            locker.relock();
+            if (myProgress->wasCanceled()) {
+                return false;
+            }
+        }
+    }
+    *rendered = myFinishedFrames.take(frame);
+    return true;
+}
+
+bool AnimationExporter::write(const QString &fileName, int first, int last)
+{
+    myFormat = determineFormat(fileName);
+    myErrorMessage.clear();
+    if (myFormat == Unknown) {
+        myErrorMessage = "Unsupported animation type:\n\n" + fileName +
+                         "\n\nSupported extensions are\n.png (one file per frame), .apng, .pdf";
+        return false;
+    }
+    if (first < 0 || last >= myParser->numMolecules() || first > last) {
+        myErrorMessage = "There are no frames in that range";
+        return false;
+    }
+    int numFrames = last - first + 1;
+
+    // Only one of these is used, depending on the format
+    QSize pageSize = ImageWriter::outputSize(mySceneRect);
+    ApngWriter apngWriter(fileName, numFrames, myFrameDelay);
+    QPdfWriter pdfWriter(fileName);
+    QPainter pdfPainter;
+    if (myFormat == APNG && !apngWriter.open()) {
+        myErrorMessage = "Unable to open " + fileName + " for writing";
+        return false;
+    }
+    if (myFormat == PDF) {
+        pdfWriter.setPageSize(QPageSize(pageSize, QPageSize::Point));
+        pdfWriter.setPageMargins(QMarginsF(0.0, 0.0, 0.0, 0.0));
+        if (!pdfPainter.begin(&pdfWriter)) {
+            myErrorMessage = "Unable to open " + fileName + " for writing";
+            return false;
+        }
+        pdfPainter.setRenderHint(QPainter::SmoothPixmapTransform, true);
+        pdfPainter.setRenderHint(QPainter::Antialiasing, true);
+        pdfPainter.setRenderHint(QPainter::HighQualityAntialiasing, true);
+    }
+
+    int numThreads = QThread::idealThreadCount();
+    int maxPending = numThreads * ANIMATION_FRAMES_PER_THREAD;
+    QThreadPool pool;
+    pool.setMaxThreadCount(numThreads);
+    myFinishedFrames.clear();
+
+    bool ok = true;
+    int next = first;
+    // The images of a PNG sequence written so far, which go again if it's cut short
+    QStringList sequenceFiles;
+    for (int frame = first; ok && frame <= last; ++frame) {
+        // Keep the workers busy, without getting too far ahead of the writing.  The parser isn't
+        // safe to share, so the frames are copied out of it here.
+        while (ok && next <= last && next - frame < maxPending) {
+            FileParser *frameParser = myParser->frameParser(next);
+            QString symbol = unknownSymbol(frameParser);
+            if (!symbol.isEmpty()) {
+                delete frameParser;
+                myErrorMessage = "I don't know the mass of the atom " + symbol;
+                ok = false;
+                break;
+            }
+            pool.start(new FrameRenderTask(this, frameParser, next));
+            ++next;
+        }
+        if (!ok) {
+            break;
+        }
+
+        RenderedFrame rendered;
+        if (!waitForFrame(frame, &rendered)) {
+            myErrorMessage = "The export was cancelled";
+            ok = false;
+            break;
+        }
+        if (myFormat == PNGSequence) {
+            QFile file(sequenceFileName(fileName, frame, last));
+            if (file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+                sequenceFiles.append(file.fileName());
+                ok = file.write(rendered.png) == rendered.png.size();
+            } else {
+                ok = false;
+            }
+            if (!ok) {
+                myErrorMessage = "Unable to write " + file.fileName();
+            }
+        } else if (myFormat == APNG) {
+            ok = apngWriter.addFrame(rendered.png);
+            if (!ok) {
+                myErrorMessage = "Unable to write " + fileName;
+            }
+        } else {
+            if (frame != first) {
+                pdfWriter.newPage();
+            }
+            // The frames were drawn at the image size, in points; the page is in device pixels
+            pdfPainter.save();
+            pdfPainter.scale(pdfWriter.width() / double(pageSize.width()),
+                             pdfWriter.height() / double(pageSize.height()));
+            pdfPainter.drawPicture(0, 0, rendered.picture);
+            pdfPainter.restore();
+        }
+        if (myProgress) {
+            myProgress->setValue(frame - first + 1);
+        }
+    }
+
+    // Frames that haven't been started are dropped, and the rest are left to finish
+    pool.clear();
+    pool.waitForDone();
+    myFinishedFrames.clear();
+
+    if (myFormat == APNG && !apngWriter.close() && ok) {
+        myErrorMessage = "Unable to write " + fileName;
+        ok = false;
+    }
+    if (myFormat == PDF) {
+        pdfPainter.end();
+        if (!ok) {
+            QFile::remove(fileName);
+        }
+    }
+    if (!ok) {
+        foreach (const QString &sequenceFile, sequenceFiles) {
+            QFile::remove(sequenceFile);
+        }
+    }
+    return ok;
+}
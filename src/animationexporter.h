@@ -0,0 +1,95 @@
+#ifndef ANIMATIONEXPORTER_H_
+#define ANIMATIONEXPORTER_H_
+
+#include <QBrush>
+#include <QByteArray>
+#include <QList>
+#include <QMap>
+#include <QMutex>
+#include <QPicture>
+#include <QProgressDialog>
+#include <QRectF>
+#include <QString>
+#include <QWaitCondition>
+
+#include "drawingcanvas.h"
+#include "drawinginfo.h"
+#include "fileparser.h"
+
+/*
+ * Writes a range of a trajectory's frames out as an animation: a numbered PNG for each frame, an
+ * animated PNG, or a PDF with a page for each frame.  The frames are drawn on a thread pool, each
+ * on a canvas of its own that's built from a copy of just that frame and the view's settings, with
+ * the orientation and scale held at the view's, so no frame depends on any other and they can be
+ * finished in any order.  The frames are written out in order as they arrive, and only a few are
+ * ever kept waiting, so the memory used doesn't grow with the length of the trajectory.  The
+ * labels, colors and sizes given to the view's atoms, and the dashing and thickness of its bonds,
+ * are carried over to the same atoms and bonds in every frame.
+ */
+class AnimationExporter
+{
+  public:
+    enum Format { PNGSequence, APNG, PDF, Unknown };
+
+    // The view being exported, whose settings are taken as they are now
+    AnimationExporter(FileParser *parser, DrawingInfo *info, DrawingCanvas *canvas);
+
+    static Format determineFormat(const QString &fileName);
+    // The name of the given frame's image in a PNG sequence, numbered from one
+    static QString sequenceFileName(const QString &fileName, int frame, int last);
+
+    void setFrameDelay(int ms)
+    {
+        myFrameDelay = ms;
+    }
+    // Only the PNGs have a resolution; the PDF pages are always the same size
+    void setDotsPerInch(int dotsPerInch)
+    {
+        myDotsPerInch = dotsPerInch;
+    }
+    // Kept up to date as the frames are written, and checked for cancellation
+    void setProgressDialog(QProgressDialog *progress)
+    {
+        myProgress = progress;
+    }
+    // The frames count from zero, and last is included
+    bool write(const QString &fileName, int first, int last);
+    const QString &errorMessage() const
+    {
+        return myErrorMessage;
+    }
+
+  protected:
+    struct RenderedFrame {
+        // The frame as a PNG file, or as drawing commands for a PDF page
+        QByteArray png;
+        QPicture picture;
+    };
+    friend class FrameRenderTask;
+
+    // Run on the worker threads
+    RenderedFrame renderFrame(FileParser *frameParser) const;
+    void frameDone(int frame, const RenderedFrame &rendered);
+    // Run on the calling thread; false if the user cancels while waiting
+    bool waitForFrame(int frame, RenderedFrame *rendered);
+
+    FileParser *myParser;
+    // A copy of the view's settings, which the workers only read
+    DrawingInfo mySettings;
+    QRectF mySceneRect;
+    QBrush myBackground;
+    QList<int> myLabeledBonds;
+    DrawingCanvas::ItemStyles myStyles;
+    Format myFormat;
+    int myFrameDelay;
+    int myDotsPerInch;
+    QProgressDialog *myProgress;
+    QString myErrorMessage;
+
+    // Frames that are done, waiting to be written
+    QMutex myLock;
+    QWaitCondition myFrameReady;
+    QMap<int, RenderedFrame> myFinishedFrames;
+};
+
+#endif /*ANIMATIONEXPORTER_H_*/
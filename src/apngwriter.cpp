@@ -0,0 +1,155 @@
+#include "apngwriter.h"
+
+#include <cstring>
+#include <zlib.h>
+
+static const char pngSignature[8] = {'\x89', 'P', 'N', 'G', '\r', '\n', '\x1a', '\n'};
+
+// How the next frame treats this one, and how it's combined with what's there already: frames
+// are left as they are, and each replaces the last outright, transparent parts and all
+#define APNG_DISPOSE_OP_NONE 0
+#define APNG_BLEND_OP_SOURCE 0
+
+static quint32 readUInt32(const char *data)
+{
+    const uchar *bytes = reinterpret_cast<const uchar *>(data);
+    return (quint32(bytes[0]) << 24) | (quint32(bytes[1]) << 16) | (quint32(bytes[2]) << 8) |
+           quint32(bytes[3]);
+}
+
+ApngWriter::ApngWriter(const QString &fileName, int numFrames, int frameDelayMs)
+    : myFile(fileName), myNumFrames(numFrames), myFrameDelayMs(frameDelayMs),
+      myFramesWritten(0), mySequenceNumber(0)
+{
+}
+
+bool ApngWriter::open()
+{
+    if (!myFile.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        return false;
+    }
+    return myFile.write(pngSignature, sizeof(pngSignature)) == sizeof(pngSignature);
+}
+
+bool ApngWriter::addFrame(const QByteArray &png)
+{
+    if (myFramesWritten >= myNumFrames || png.size() < int(sizeof(pngSignature)) ||
+        memcmp(png.constData(), pngSignature, sizeof(pngSignature)) != 0) {
+        return false;
+    }
+
+    // Split the PNG into its chunks, keeping the header and image data and any ancillary chunks
+    // that have to come before the first frame
+    QByteArray header;
+    QByteArray ancillary;
+    QList<QByteArray> imageData;
+    const char *data = png.constData();
+    int pos = sizeof(pngSignature);
+    while (pos + 12 <= png.size()) {
+        int length = readUInt32(data + pos);
+        if (length < 0 || pos + 12 + length > png.size()) {
+            return false;
+        }
+        QByteArray type(data + pos + 4, 4);
+        QByteArray body(data + pos + 8, length);
+        if (type == "IHDR") {
+            header = body;
+        } else if (type == "IDAT") {
+            imageData.append(body);
+        } else if (type == "IEND") {
+            break;
+        } else if (imageData.isEmpty()) {
+            // Colour space and resolution chunks; the text ones Qt adds come along too
+            ancillary.append(png.mid(pos, 12 + length));
+        }
+        pos += 12 + length;
+    }
+    // Only the first thirteen bytes of the header are defined, and the first eight are the size
+    if (header.size() != 13 || imageData.isEmpty()) {
+        return false;
+    }
+
+    if (myFramesWritten == 0) {
+        myHeader = header;
+        writeChunk("IHDR", header);
+        QByteArray control;
+        appendUInt32(control, myNumFrames);
+        // Loop forever
+        appendUInt32(control, 0);
+        writeChunk("acTL", control);
+        myFile.write(ancillary);
+    } else if (header != myHeader) {
+        return false;
+    }
+
+    QByteArray frameControl;
+    appendUInt32(frameControl, mySequenceNumber++);
+    frameControl.append(header.constData(), 8);
+    appendUInt32(frameControl, 0);
+    appendUInt32(frameControl, 0);
+    appendUInt16(frameControl, quint16(qBound(0, myFrameDelayMs, 65535)));
+    appendUInt16(frameControl, 1000);
+    frameControl.append(char(APNG_DISPOSE_OP_NONE));
+    frameControl.append(char(APNG_BLEND_OP_SOURCE));
+    writeChunk("fcTL", frameControl);
+
+    // The first frame is also the image shown by viewers that don't animate, so it stays as IDAT
+    foreach (const QByteArray &body, imageData) {
+        if (myFramesWritten == 0) {
+            writeChunk("IDAT", body);
+        } else {
+            QByteArray frameData;
+            appendUInt32(frameData, mySequenceNumber++);
+            frameData.append(body);
+            writeChunk("fdAT", frameData);
+        }
+    }
+    ++myFramesWritten;
+    return myFile.error() == QFile::NoError;
+}
+
+bool ApngWriter::close()
+{
+    // The frame count is already written, so an animation cut short is no good
+    if (myFramesWritten != myNumFrames) {
+        myFile.close();
+        myFile.remove();
+        return false;
+    }
+    writeChunk("IEND", QByteArray());
+    bool ok = myFile.error() == QFile::NoError;
+    myFile.close();
+    return ok;
+}
+
+void ApngWriter::writeChunk(const char *type, const QByteArray &data)
+{
+    QByteArray chunk;
+    chunk.reserve(data.size() + 12);
+    appendUInt32(chunk, data.size());
+    chunk.append(type, 4);
+    chunk.append(data);
+    appendUInt32(chunk, crc(type, data));
+    myFile.write(chunk);
+}
+
+void ApngWriter::appendUInt32(QByteArray &data, quint32 value)
+{
+    data.append(char(value >> 24));
+    data.append(char(value >> 16));
+    data.append(char(value >> 8));
+    data.append(char(value));
+}
+
+void ApngWriter::appendUInt16(QByteArray &data, quint16 value)
+{
+    data.append(char(value >> 8));
+    data.append(char(value));
+}
+
+// The CRC-32 that PNG uses, over the chunk's type and data
+quint32 ApngWriter::crc(const char *type, const QByteArray &data)
+{
+    return crc32(crc32(0, reinterpret_cast<const Bytef *>(type), 4),
+                 reinterpret_cast<const Bytef *>(data.constData()), data.size());
+}
@@ -0,0 +1,40 @@
+#ifndef APNGWRITER_H_
+#define APNGWRITER_H_
+
+#include <QByteArray>
+#include <QFile>
+#include <QString>
+
+/*
+ * Streams an animated PNG to a file, a frame at a time.  Qt can write PNGs but not animate them,
+ * so each frame comes in already encoded as a PNG, and its compressed image data is just moved
+ * into the animation's chunks; nothing is decoded or compressed again.  Every frame must be the
+ * same size and type as the first, and the number of frames has to be known up front, as it's
+ * written before any of them.
+ */
+class ApngWriter
+{
+  public:
+    ApngWriter(const QString &fileName, int numFrames, int frameDelayMs);
+
+    bool open();
+    bool addFrame(const QByteArray &png);
+    bool close();
+
+  protected:
+    void writeChunk(const char *type, const QByteArray &data);
+    static void appendUInt32(QByteArray &data, quint32 value);
+    static void appendUInt16(QByteArray &data, quint16 value);
+    static quint32 crc(const char *type, const QByteArray &data);
+
+    QFile myFile;
+    int myNumFrames;
+    int myFrameDelayMs;
+    int myFramesWritten;
+    // Shared by the frame controls and frame data chunks, which must be numbered in order
+    quint32 mySequenceNumber;
+    // The first frame's header, which every other frame must match
+    QByteArray myHeader;
+};
+
+#endif /*APNGWRITER_H_*/
@@ -1,4 +1,5 @@
 #include "arrow.h"
+#include "svgwriter.h"
 
 DragBox::DragBox(double x, double y, DrawingInfo *info, QGraphicsItem *parent)
     : QGraphicsRectItem(parent), hoverOver(false), drawingInfo(info),
@@ -48,14 +49,15 @@ void DragBox::paint(QPainter *painter, const QStyleOptionGraphicsItem *option, Q
     {
         return;
     }
-    myPen.setWidthF(0.001 * drawingInfo->scaleFactor());
-    myPen.setColor(Qt::black);
-    painter->setPen(myPen);
+    QPen pen(myPen);
+    pen.setWidthF(0.001 * drawingInfo->scaleFactor());
+    pen.setColor(Qt::black);
+    painter->setPen(pen);
     painter->drawRect(rect());
 }
 
 Arrow::Arrow(double x, double y, DrawingInfo *info, QGraphicsItem *parent)
-    : QGraphicsLineItem(parent), drawingInfo(info), hoverOver(false)
+    : QGraphicsLineItem(parent), drawingInfo(info), effectiveWidth(0.0), hoverOver(false)
 {
     setFlag(QGraphicsItem::ItemIsSelectable, true);
     setAcceptHoverEvents(true);
@@ -96,8 +98,12 @@ void Arrow::updatePosition()
         line().p2() - QPointF(sin(angle + PI / 3.0) * arrowSize, cos(angle + PI / 3.0) * arrowSize);
     QPointF arrowP2 = line().p2() - QPointF(sin(angle + PI - PI / 3.0) * arrowSize,
                                             cos(angle + PI - PI / 3.0) * arrowSize);
-    arrowHead.clear();
-    arrowHead << line().p2() << arrowP1 << arrowP2;
+    QPolygonF head;
+    head << line().p2() << arrowP1 << arrowP2;
+    if (head != arrowHead) {
+        prepareGeometryChange();
+        arrowHead = head;
+    }
 
     // Stop the line at the butt of the arrowhead, not the tip
     if (line().length() > arrowSize) {
@@ -109,32 +115,58 @@ void Arrow::updatePosition()
     setThickness(myThickness);
 }
 
+QRectF Arrow::boundingRect() const
+{
+    // Enough room for the much thicker line drawn while hovering over a selected arrow
+    double margin = 5.0 * effectiveWidth;
+    QRectF bounds = QRectF(line().p1(), line().p2()).normalized() | arrowHead.boundingRect();
+    return bounds.adjusted(-margin, -margin, margin, margin);
+}
+
 void Arrow::paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget)
 {
     Q_UNUSED(option);
     Q_UNUSED(widget);
-    myPen.setWidthF(hoverOver ? 2.0 * effectiveWidth : effectiveWidth);
-    myPen.setColor(Qt::black);
+    QPen pen(myPen);
+    pen.setWidthF(hoverOver ? 2.0 * effectiveWidth : effectiveWidth);
+    pen.setColor(Qt::black);
     // Draw the line
-    painter->setPen(myPen);
+    painter->setPen(pen);
     painter->drawLine(line());
     // Now the arrowhead, the brush is thin to make the corners look correct
     painter->setBrush(Qt::black);
-    myPen.setWidthF(0.001);
-    painter->setPen(myPen);
+    pen.setWidthF(0.001);
+    painter->setPen(pen);
     painter->drawPolygon(arrowHead);
     if (isSelected()) {
-        myPen.setWidthF(hoverOver ? 10.0 * effectiveWidth : effectiveWidth);
-        myPen.setColor(SELECTED_COLOR);
-        painter->setPen(myPen);
+        pen.setWidthF(hoverOver ? 10.0 * effectiveWidth : effectiveWidth);
+        pen.setColor(SELECTED_COLOR);
+        painter->setPen(pen);
         painter->drawLine(line());
         painter->setBrush(SELECTED_COLOR);
-        myPen.setWidthF(0.001);
-        painter->setPen(myPen);
+        pen.setWidthF(0.001);
+        painter->setPen(pen);
         painter->drawPolygon(arrowHead);
     }
 }
 
+void Arrow::writeSvg(SvgWriter *svg)
+{
+    QPen pen(myPen);
+    pen.setWidthF(hoverOver ? 2.0 * effectiveWidth : effectiveWidth);
+    pen.setColor(Qt::black);
+    svg->writeLine(line(), pen);
+    pen.setWidthF(0.001);
+    svg->writePolygon(arrowHead, pen, Qt::black);
+    if (isSelected()) {
+        pen.setWidthF(hoverOver ? 10.0 * effectiveWidth : effectiveWidth);
+        pen.setColor(SELECTED_COLOR);
+        svg->writeLine(line(), pen);
+        pen.setWidthF(0.001);
+        svg->writePolygon(arrowHead, pen, SELECTED_COLOR);
+    }
+}
+
 void Arrow::mouseReleaseEvent(QGraphicsSceneMouseEvent *event)
 {
     // A null event to prevent unwanted deselection
@@ -9,6 +9,8 @@
 #include "defines.h"
 #include "drawinginfo.h"
 
+class SvgWriter;
+
 class DragBox : public QGraphicsRectItem
 {
   public:
@@ -67,6 +69,7 @@ class Arrow : public QGraphicsLineItem
     }
 
     Arrow(double x, double y, DrawingInfo *drawingInfo, QGraphicsItem *parent = 0);
+    QRectF boundingRect() const;
     void paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget = 0);
 
     void setColor(const QColor &color)
@@ -85,8 +88,13 @@ class Arrow : public QGraphicsLineItem
     }
     void setThickness(const double val)
     {
+        double width = drawingInfo->scaleFactor() * val;
+        // The bounds depend on the width
+        if (width != effectiveWidth) {
+            prepareGeometryChange();
+        }
         myThickness = val;
-        effectiveWidth = drawingInfo->scaleFactor() * val;
+        effectiveWidth = width;
     }
     void updatePosition(double x, double y);
     void updatePosition();
@@ -105,6 +113,7 @@ class Arrow : public QGraphicsLineItem
         setAcceptHoverEvents(arg);
     }
 
+    void writeSvg(SvgWriter *svg);
     void serialize(QXmlStreamWriter *writer);
     static Arrow *deserialize(QXmlStreamReader *reader, DrawingInfo *drawingInfo);
 
@@ -1,26 +1,32 @@
 #include "atom.h"
+#include "svgwriter.h"
 
-QMap<QString, QVariant> Atom::labelToVdwRadius;
-QMap<QString, QVariant> Atom::labelToMass;
-QMap<QString, QVariant> Atom::labelToColor;
+// The radius that the atoms are drawn at in SVG output, before they're scaled to size; it's also
+// the one at which the label has the font size it's given
+#define SVG_ATOM_RADIUS 20.0
+
+QMap<QString, QVariant> Atom::colorOverrides;
 
 Atom::Atom(QString element, DrawingInfo *i, QGraphicsItem *parent)
-    : QGraphicsEllipseItem(parent), myFontSizeStyle(SmallLabel), myX(0.0), myY(0.0), myZ(0.0),
-      myScaleFactor(DEFAULT_ATOM_SCALE_FACTOR), mySymbol(element), myID(0), hoverOver(false),
+    : QGraphicsEllipseItem(parent), myEffectiveRadius(0.0), myFontSizeStyle(SmallLabel), myX(0.0),
+      myY(0.0), myZ(0.0), myDepth(0.0), myScaleFactor(DEFAULT_ATOM_SCALE_FACTOR), mySymbol(element),
+      myFontSize(DEFAULT_ATOM_LABEL_FONT_SIZE), myGeometryDirty(true), myID(0),
+      myAtomicNumber(PeriodicTable::atomicNumber(element)), hoverOver(false),
       fill_color(Qt::white), _info(i)
 {
     setDrawingStyle(_info->getDrawingStyle());
 
     myLabel = (mySymbol == "H" ? "" : mySymbol);
 
-    // This is a bit of a hack.  All atoms after Xe have Xe's vdW radius
-    if (labelToVdwRadius.value(mySymbol).toDouble() == 0.0 && mySymbol != "X") {
+    if (myAtomicNumber < 0) {
+        // This is a bit of a hack.  Anything unrecognized gets the heavy atoms' radius
         myRadius = 1.44;
+        myMass = 0.0;
     } else {
-        myRadius = labelToVdwRadius.value(mySymbol).toDouble();
+        myRadius = PeriodicTable::element(myAtomicNumber).radius;
+        myMass = PeriodicTable::element(myAtomicNumber).mass;
     }
-    myMass = labelToMass.value(mySymbol).toDouble();
-    if (myMass == 0.0 && mySymbol != "X") {
+    if (!hasKnownMass(mySymbol)) {
         QString errorMessage = "I don't know the mass of the atom " + mySymbol;
         error(errorMessage, __FILE__, __LINE__);
         return;
@@ -29,10 +35,13 @@ Atom::Atom(QString element, DrawingInfo *i, QGraphicsItem *parent)
     setFlag(QGraphicsItem::ItemIsSelectable, true);
     setAcceptHoverEvents(true);
     setAcceptDrops(true);
-    myEffectiveRadius =
-        _info->scaleFactor() * (1.0 + zValue() * _info->perspective()) * myRadius * myScaleFactor;
-    setRect(QRectF(
-        -myEffectiveRadius, -myEffectiveRadius, 2.0 * myEffectiveRadius, 2.0 * myEffectiveRadius));
+    updateGeometry();
+}
+
+bool Atom::hasKnownMass(const QString &symbol)
+{
+    int atomicNumber = PeriodicTable::atomicNumber(symbol);
+    return symbol == "X" || (atomicNumber >= 0 && PeriodicTable::element(atomicNumber).mass != 0.0);
 }
 
 void Atom::setLabel(const QString &text)
@@ -43,6 +52,7 @@ void Atom::setLabel(const QString &text)
     myLabel.clear();
     myLabelSubscript.clear();
     myLabelSuperscript.clear();
+    myGeometryDirty = true;
     if (rx.exactMatch(text) == true) {
         myLabel = rx.cap(1);
         if (rx.cap(2).startsWith('_')) {
@@ -63,7 +73,7 @@ void Atom::setDrawingStyle(DrawingInfo::DrawingStyle style)
     if (style == DrawingInfo::Simple) {
         fill_color = Qt::white;
     } else {
-        fill_color = labelToColor.value(mySymbol).value<QColor>();
+        fill_color = color(mySymbol);
     }
 }
 
@@ -75,6 +85,7 @@ void Atom::setFontSizeStyle(FontSizeStyle style)
         setLabelFontSize(DEFAULT_ATOM_LABEL_FONT_SIZE);
     }
     myFontSizeStyle = style;
+    myGeometryDirty = true;
 }
 
 void Atom::hoverEnterEvent(QGraphicsSceneHoverEvent *event)
@@ -93,7 +104,7 @@ void Atom::hoverLeaveEvent(QGraphicsSceneHoverEvent *event)
 
 QRectF Atom::boundingRect() const
 {
-    return rect();
+    return myBounds;
 }
 
 void Atom::computeRadius()
@@ -102,21 +113,50 @@ void Atom::computeRadius()
         _info->scaleFactor() * (1.0 + zValue() * _info->perspective()) * myRadius * myScaleFactor;
 }
 
-void Atom::paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget)
+void Atom::updateGeometry()
 {
-    Q_UNUSED(option);
-    Q_UNUSED(widget);
+    // The myEffectiveRadius changes on zooming/rotation, but the scene's index only needs to hear
+    // about it if it actually moved
+    double oldRadius = myEffectiveRadius;
     computeRadius();
-
-    // The myEffectiveRadius changes on zooming/rotation so we must always update it
+    // Any change to the label font, not just its family, moves the label's bounds
+    QFont labelFont = _info->getAtomLabelFont();
+    if (myEffectiveRadius > 0.0) {
+        labelFont.setPointSizeF(double(myFontSize) * myEffectiveRadius / 20.0);
+    }
+    if (!myGeometryDirty && myEffectiveRadius == oldRadius && labelFont == myLabelFont) {
+        return;
+    }
+    prepareGeometryChange();
     setRect(QRectF(
         -myEffectiveRadius, -myEffectiveRadius, 2.0 * myEffectiveRadius, 2.0 * myEffectiveRadius));
+    myLabelFont = labelFont;
+    // The bounds have to cover the thicker outline drawn while hovering, so that hovering only
+    // ever repaints the atom itself
+    double hoverWidth = _info->scaleFactor() * 0.02;
+    myBounds = bodyBounds(rect().adjusted(-hoverWidth, -hoverWidth, hoverWidth, hoverWidth));
+    myGeometryDirty = false;
+}
+
+void Atom::paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget)
+{
+    Q_UNUSED(option);
+    Q_UNUSED(widget);
+    // While the view is being dragged, a flat disc will do
+    if (_info->lowDetail()) {
+        painter->setPen(Qt::NoPen);
+        painter->setBrush(fill_color);
+        painter->drawEllipse(rect());
+        if (isSelected()) {
+            painter->setBrush(SELECTED_COLOR);
+            painter->drawEllipse(rect());
+        }
+        return;
+    }
     // If the item is selected, use a lighter color for the filling
     QPen linestyle;
-    // If we're hovering over the item, use thicker lines
-    linestyle.setWidthF((hoverOver ? _info->scaleFactor() * 0.04 : _info->scaleFactor() * 0.01));
+    linestyle.setWidthF(lineWidth());
     linestyle.setColor(Qt::black);
-    painter->setPen(linestyle);
     // The outline of the atom is a little bit too diffuse, here's another more diffuse circle
     // that accounts for the width of the line so that the gradient and fogging options look pretty
     float lineWidth = linestyle.widthF() / 2.0;
@@ -125,6 +165,37 @@ void Atom::paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWid
                     2.0 * myEffectiveRadius + 2.0 * lineWidth,
                     2.0 * myEffectiveRadius + 2.0 * lineWidth);
 
+    if (!drawSprite(painter, linestyle, fillRect)) {
+        drawBody(painter, linestyle, fillRect);
+    }
+    painter->setPen(_info->getAtomTextColor());
+
+    // Draw a semi-transparent green circle over any selected atoms
+    if (isSelected()) {
+        painter->setBrush(SELECTED_COLOR);
+        painter->drawEllipse(rect());
+    }
+    // Draw a semi-transparent white circle for fogging
+    if (_info->getUseFogging()) {
+        painter->setPen(Qt::transparent);
+        painter->setBrush(QColor(255, 255, 255, fogOpacity()));
+        painter->drawEllipse(fillRect);
+    }
+}
+
+double Atom::fogOpacity() const
+{
+    double dZ = _info->maxZ() - _info->minZ();
+    double thisZ = fabs(myDepth - _info->maxZ());
+    double opacity = (dZ > TINY ? 2.56 * (_info->getFoggingScale()) * (thisZ / dZ) : 0.0);
+    opacity = (opacity < 0 ? 0 : opacity);
+    opacity = (opacity > 255 ? 255 : opacity);
+    return opacity;
+}
+
+void Atom::drawBody(QPainter *painter, const QPen &linestyle, const QRectF &fillRect) const
+{
+    painter->setPen(linestyle);
     // The circle defnining the atom
     if (_info->getDrawingStyle() == DrawingInfo::Gradient) {
         // Define a gradient pattern to fill the atom
@@ -195,8 +266,7 @@ void Atom::paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWid
     }
 
     // Now draw the atomic symbol on there
-    setLabelFontSize(myFontSize);
-    QFontMetricsF labelFM(_info->getAtomLabelFont());
+    QFontMetricsF labelFM(myLabelFont);
     // TODO check these offsets.  I think there's a bug in the height reported by fontmetrics
     QPointF labelPos;
     if (myFontSizeStyle == LargeLabel) {
@@ -206,12 +276,11 @@ void Atom::paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWid
     }
     painter->setPen(_info->getAtomTextColor());
     painter->setBrush(_info->getAtomTextColor());
-    painter->setFont(_info->getAtomLabelFont());
+    painter->setFont(myLabelFont);
     painter->drawText(labelPos, myLabel);
     // If there's a subscript to be drawn, do it
     if (myLabelSubscript.size()) {
-        QFont subscriptFont(_info->getAtomLabelFont().family(),
-                            (int)(_info->getAtomLabelFont().pointSizeF() / 2.0));
+        QFont subscriptFont(myLabelFont.family(), (int)(myLabelFont.pointSizeF() / 2.0));
         painter->setFont(subscriptFont);
         qreal hOffset = labelFM.width(myLabel);
         QFontMetricsF subscriptFM(subscriptFont);
@@ -222,8 +291,7 @@ void Atom::paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWid
 
     // If there's a superscript to be drawn, do it
     if (myLabelSuperscript.size()) {
-        QFont superscriptFont(_info->getAtomLabelFont().family(),
-                              (int)(_info->getAtomLabelFont().pointSizeF() / 2.0));
+        QFont superscriptFont(myLabelFont.family(), (int)(myLabelFont.pointSizeF() / 2.0));
         painter->setFont(superscriptFont);
         qreal hOffset = labelFM.width(myLabel);
         qreal vOffset2 = labelFM.height();
@@ -233,22 +301,207 @@ void Atom::paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWid
         painter->drawText(labelPos + QPointF(hOffset, -vOffset2 + 2.0 * vOffset),
                           myLabelSuperscript);
     }
+}
+
+QRectF Atom::bodyBounds(const QRectF &fillRect) const
+{
+    // Generous, so that the label is never clipped: the sub and superscripts are really half size
+    QFontMetricsF labelFM(myLabelFont);
+    qreal width = labelFM.width(myLabel);
+    QRectF labelRect(-width / 2.0,
+                     -labelFM.height(),
+                     width + labelFM.width(myLabelSubscript) + labelFM.width(myLabelSuperscript),
+                     2.0 * labelFM.height());
+    return fillRect.united(labelRect);
+}
+
+bool Atom::drawSprite(QPainter *painter, const QPen &linestyle, const QRectF &fillRect) const
+{
+    // Pixmaps only live on the GUI thread, and vector output (printing, PDF and SVG export) has
+    // to stay vector output
+    if (QThread::currentThread() != QCoreApplication::instance()->thread()) {
+        return false;
+    }
+    QPaintEngine *engine = painter->paintEngine();
+    if (!engine || (engine->type() != QPaintEngine::Raster &&
+                    engine->type() != QPaintEngine::OpenGL2)) {
+        return false;
+    }
+    // Sprites are only reusable if the view is not rotated, sheared or flipped
+    QTransform transform = painter->worldTransform();
+    if (transform.type() > QTransform::TxScale || transform.m11() <= 0.0 ||
+        fabs(transform.m11() - transform.m22()) > TINY) {
+        return false;
+    }
+    qreal pixelRatio = painter->device()->devicePixelRatioF();
+    qreal scale = transform.m11() * pixelRatio;
+    QRectF bounds = bodyBounds(fillRect);
+    if (bounds.width() * scale > ATOM_SPRITE_MAX_SIZE ||
+        bounds.height() * scale > ATOM_SPRITE_MAX_SIZE) {
+        return false;
+    }
 
-    // Draw a semi-transparent green circle over any selected atoms
+    // Everything that changes the way the atom looks, bar the overlays, goes in the key
+    QString key = QString("atom:%1:%2:%3:%4:%5:%6:%7")
+                      .arg(fill_color.rgba())
+                      .arg(_info->getDrawingStyle())
+                      .arg(myFontSizeStyle)
+                      .arg(qRound(myEffectiveRadius * scale / ATOM_SPRITE_RADIUS_STEP))
+                      .arg(qRound(linestyle.widthF() * scale / ATOM_SPRITE_RADIUS_STEP))
+                      .arg(_info->getAtomTextColor().rgba())
+                      .arg(pixelRatio);
+    key += ":" + myLabelFont.key() + ":" + label();
+
+    QPixmap sprite;
+    if (!QPixmapCache::find(key, &sprite)) {
+        // One pixel of padding keeps the antialiased edges
+        sprite = QPixmap(ceil(bounds.width() * scale) + 2, ceil(bounds.height() * scale) + 2);
+        sprite.fill(Qt::transparent);
+        QPainter spritePainter(&sprite);
+        spritePainter.setRenderHints(painter->renderHints());
+        spritePainter.translate(1.0, 1.0);
+        spritePainter.scale(scale, scale);
+        spritePainter.translate(-bounds.topLeft());
+        drawBody(&spritePainter, linestyle, fillRect);
+        spritePainter.end();
+        sprite.setDevicePixelRatio(pixelRatio);
+        QPixmapCache::insert(key, sprite);
+    }
+
+    QPointF topLeft = transform.map(bounds.topLeft());
+    painter->save();
+    painter->resetTransform();
+    painter->drawPixmap(QPointF(qRound(topLeft.x() * pixelRatio) - 1.0,
+                                qRound(topLeft.y() * pixelRatio) - 1.0) /
+                            pixelRatio,
+                        sprite);
+    painter->restore();
+    return true;
+}
+
+QString Atom::svgSymbolKey() const
+{
+    QString key = QString("%1:%2:%3:%4:%5")
+                      .arg(fill_color.rgba())
+                      .arg(_info->getDrawingStyle())
+                      .arg(myFontSizeStyle)
+                      .arg(myFontSize)
+                      .arg(_info->getAtomTextColor().rgba());
+    return key + ":" + _info->getAtomLabelFont().key() + ":" + label();
+}
+
+void Atom::writeSvgSymbol(SvgWriter *svg, const QString &id) const
+{
+    // This is drawBody() again, at SVG_ATOM_RADIUS.  The outlines take their width from each use
+    // of the drawing, as that doesn't grow with the atom; the HoukMol blob's outline is thinner on
+    // screen, but not so as anyone would notice.
+    QXmlStreamWriter *xml = svg->xml();
+    const double r = SVG_ATOM_RADIUS;
+    DrawingInfo::DrawingStyle style = _info->getDrawingStyle();
+    if (style == DrawingInfo::Gradient) {
+        xml->writeStartElement("radialGradient");
+        xml->writeAttribute("id", id + "-gradient");
+        xml->writeAttribute("gradientUnits", "userSpaceOnUse");
+        xml->writeAttribute("cx", "0");
+        xml->writeAttribute("cy", "0");
+        xml->writeAttribute("r", SvgWriter::number(r));
+        xml->writeAttribute("fx", SvgWriter::number(r / 2.1));
+        xml->writeAttribute("fy", SvgWriter::number(-r / 2.1));
+        xml->writeAttribute("spreadMethod", "repeat");
+        xml->writeEmptyElement("stop");
+        xml->writeAttribute("offset", "0");
+        svg->writeColor("stop-color", Qt::white);
+        xml->writeEmptyElement("stop");
+        xml->writeAttribute("offset", "1");
+        svg->writeColor("stop-color", fill_color);
+        xml->writeEndElement();
+    }
+
+    xml->writeStartElement("g");
+    xml->writeAttribute("id", id);
+    xml->writeEmptyElement("circle");
+    xml->writeAttribute("r", SvgWriter::number(r));
+    if (style == DrawingInfo::Gradient) {
+        xml->writeAttribute("fill", "url(#" + id + "-gradient)");
+    } else {
+        svg->writeColor("fill", fill_color);
+    }
+    svg->writeColor("stroke", Qt::black);
+
+    // The arcs for the "3D" look, the lower half of a flat ellipse and one side of a thin one
+    if (myFontSizeStyle != LargeLabel) {
+        QString arcs = QString("M%1 0A%1 %2 0 0 1 %3 0M0 %3A%2 %1 0 0 %4 0 %1")
+                           .arg(SvgWriter::number(r))
+                           .arg(SvgWriter::number(r / 2.0))
+                           .arg(SvgWriter::number(-r))
+                           .arg(style == DrawingInfo::HoukMol ? 1 : 0);
+        xml->writeEmptyElement("path");
+        xml->writeAttribute("d", arcs);
+        xml->writeAttribute("fill", "none");
+        svg->writeColor("stroke", Qt::black);
+    }
+
+    // The blob for HoukMol and its mirror image for the colored style
+    if (style == DrawingInfo::HoukMol || style == DrawingInfo::SimpleColored) {
+        double side = (style == DrawingInfo::HoukMol ? -1.0 : 1.0);
+        QPointF startPoint(side * r / 1.8, -r / 20.0);
+        QPainterPath path(startPoint);
+        path.quadTo(QPointF(side * r / 1.2, -r / 1.2), QPointF(side * r / 20.0, -r / 1.8));
+        path.quadTo(QPointF(side * r / 2.1, -r / 2.1), startPoint);
+        xml->writeEmptyElement("path");
+        xml->writeAttribute("d", SvgWriter::pathData(path));
+        svg->writeColor("fill", Qt::white);
+        svg->writeColor("stroke", style == DrawingInfo::HoukMol ? Qt::black : Qt::transparent);
+    }
+
+    // The label, which at this radius has just the font size it was given
+    if (!myLabel.isEmpty() || !myLabelSubscript.isEmpty() || !myLabelSuperscript.isEmpty()) {
+        QFont labelFont = _info->getAtomLabelFont();
+        labelFont.setPointSizeF(double(myFontSize) * r / 20.0);
+        QFontMetricsF labelFM(labelFont);
+        QPointF labelPos(-labelFM.width(myLabel) / 2.0,
+                         labelFM.height() / (myFontSizeStyle == LargeLabel ? 3.0 : 3.5));
+        QColor textColor = _info->getAtomTextColor();
+        if (!myLabel.isEmpty()) {
+            svg->writeText(labelPos, myLabel, labelFont, textColor);
+        }
+        QFont scriptFont(labelFont.family());
+        scriptFont.setPointSizeF(labelFont.pointSizeF() / 2.0);
+        QFontMetricsF scriptFM(scriptFont);
+        qreal hOffset = labelFM.width(myLabel);
+        if (myLabelSubscript.size()) {
+            svg->writeText(labelPos + QPointF(hOffset, scriptFM.height() / 3.0),
+                           myLabelSubscript, scriptFont, textColor);
+        }
+        if (myLabelSuperscript.size()) {
+            svg->writeText(
+                labelPos + QPointF(hOffset, -labelFM.height() + 2.0 * scriptFM.height() / 3.0),
+                myLabelSuperscript, scriptFont, textColor);
+        }
+    }
+    xml->writeEndElement();
+}
+
+void Atom::writeSvg(SvgWriter *svg, const QString &symbol, const QPointF &center) const
+{
+    QXmlStreamWriter *xml = svg->xml();
+    double scale = myEffectiveRadius / SVG_ATOM_RADIUS;
+    xml->writeEmptyElement("use");
+    xml->writeAttribute("xlink:href", "#" + symbol);
+    xml->writeAttribute("transform",
+                        QString("translate(%1 %2) scale(%3)")
+                            .arg(SvgWriter::number(center.x()))
+                            .arg(SvgWriter::number(center.y()))
+                            .arg(SvgWriter::number(scale)));
+    if (scale > 0.0) {
+        xml->writeAttribute("stroke-width", SvgWriter::number(lineWidth() / scale));
+    }
     if (isSelected()) {
-        painter->setBrush(SELECTED_COLOR);
-        painter->drawEllipse(rect());
+        svg->writeCircle(center, myEffectiveRadius, SELECTED_COLOR);
     }
-    // Draw a semi-transparent white circle for fogging
     if (_info->getUseFogging()) {
-        double dZ = _info->maxZ() - _info->minZ();
-        double thisZ = fabs(myZ - _info->maxZ());
-        double opacity = (dZ > TINY ? 2.56 * (_info->getFoggingScale()) * (thisZ / dZ) : 0.0);
-        opacity = (opacity < 0 ? 0 : opacity);
-        opacity = (opacity > 255 ? 255 : opacity);
-        painter->setPen(Qt::transparent);
-        painter->setBrush(QColor(255, 255, 255, opacity));
-        painter->drawEllipse(fillRect);
+        svg->writeCircle(center, myEffectiveRadius + lineWidth() / 2.0,
+                         QColor(255, 255, 255, fogOpacity()));
     }
 }
 
@@ -258,304 +511,20 @@ double Atom::bondLength(Atom *s, Atom *e)
         sqrt(pow(s->x() - e->x(), 2.0) + pow(s->y() - e->y(), 2.0) + pow(s->z() - e->z(), 2.0)));
 }
 
-void Atom::fillLabelToVdwRadiusMap()
-{
-    static bool filled = false;
-    // After Xe, everything looks the same anyway, so 1.44 is used for mega heavy atoms
-    if (!filled) {
-        labelToVdwRadius.insert(QString("X"), 0.00);
-        labelToVdwRadius.insert(QString("H"), 0.30);
-        labelToVdwRadius.insert(QString("He"), 0.93);
-        labelToVdwRadius.insert(QString("Li"), 1.23);
-        labelToVdwRadius.insert(QString("Be"), 0.90);
-        labelToVdwRadius.insert(QString("B"), 0.82);
-        labelToVdwRadius.insert(QString("C"), 0.77);
-        labelToVdwRadius.insert(QString("N"), 0.75);
-        labelToVdwRadius.insert(QString("O"), 0.73);
-        labelToVdwRadius.insert(QString("F"), 0.72);
-        labelToVdwRadius.insert(QString("Ne"), 0.71);
-        labelToVdwRadius.insert(QString("Na"), 1.54);
-        labelToVdwRadius.insert(QString("Mg"), 1.36);
-        labelToVdwRadius.insert(QString("Al"), 1.18);
-        labelToVdwRadius.insert(QString("Si"), 1.11);
-        labelToVdwRadius.insert(QString("P"), 1.06);
-        labelToVdwRadius.insert(QString("S"), 1.02);
-        labelToVdwRadius.insert(QString("Cl"), 0.99);
-        labelToVdwRadius.insert(QString("Ar"), 0.98);
-        labelToVdwRadius.insert(QString("K"), 2.03);
-        labelToVdwRadius.insert(QString("Ca"), 1.74);
-        labelToVdwRadius.insert(QString("Sc"), 1.44);
-        labelToVdwRadius.insert(QString("Ti"), 1.32);
-        labelToVdwRadius.insert(QString("V"), 1.22);
-        labelToVdwRadius.insert(QString("Cr"), 1.18);
-        labelToVdwRadius.insert(QString("Mn"), 1.17);
-        labelToVdwRadius.insert(QString("Fe"), 1.17);
-        labelToVdwRadius.insert(QString("Co"), 1.16);
-        labelToVdwRadius.insert(QString("Ni"), 1.15);
-        labelToVdwRadius.insert(QString("Cu"), 1.17);
-        labelToVdwRadius.insert(QString("Zn"), 1.25);
-        labelToVdwRadius.insert(QString("Ga"), 1.26);
-        labelToVdwRadius.insert(QString("Ge"), 1.22);
-        labelToVdwRadius.insert(QString("As"), 1.20);
-        labelToVdwRadius.insert(QString("Se"), 1.16);
-        labelToVdwRadius.insert(QString("Br"), 1.14);
-        labelToVdwRadius.insert(QString("Kr"), 1.12);
-        labelToVdwRadius.insert(QString("Rb"), 2.16);
-        labelToVdwRadius.insert(QString("Sr"), 1.91);
-        labelToVdwRadius.insert(QString("Y"), 1.62);
-        labelToVdwRadius.insert(QString("Zr"), 1.45);
-        labelToVdwRadius.insert(QString("Nb"), 1.34);
-        labelToVdwRadius.insert(QString("Mo"), 1.30);
-        labelToVdwRadius.insert(QString("Tc"), 1.27);
-        labelToVdwRadius.insert(QString("Ru"), 1.25);
-        labelToVdwRadius.insert(QString("Rh"), 1.25);
-        labelToVdwRadius.insert(QString("Pd"), 1.28);
-        labelToVdwRadius.insert(QString("Ag"), 1.34);
-        labelToVdwRadius.insert(QString("Cd"), 1.48);
-        labelToVdwRadius.insert(QString("In"), 1.44);
-        labelToVdwRadius.insert(QString("Sn"), 1.41);
-        labelToVdwRadius.insert(QString("Sb"), 1.40);
-        labelToVdwRadius.insert(QString("Te"), 1.36);
-        labelToVdwRadius.insert(QString("I"), 1.33);
-        labelToVdwRadius.insert(QString("Xe"), 1.31);
-    }
-    filled = true;
-}
-
-void Atom::fillLabelToMassMap()
+QColor Atom::defaultColor(const QString &symbol)
 {
-    static bool filled = false;
-    // These were all "borrowed" from PSI3's masses.h file
-    if (!filled) {
-        labelToMass.insert(QString("X"), 0.000000000);
-        labelToMass.insert(QString("H"), 1.007825032);
-        labelToMass.insert(QString("He"), 4.002603254);
-        labelToMass.insert(QString("Li"), 7.016004548);
-        labelToMass.insert(QString("Be"), 9.012182201);
-        labelToMass.insert(QString("B"), 11.009305406);
-        labelToMass.insert(QString("C"), 12.000000000);
-        labelToMass.insert(QString("N"), 14.003074005);
-        labelToMass.insert(QString("O"), 15.994914620);
-        labelToMass.insert(QString("F"), 18.998403224);
-        labelToMass.insert(QString("Ne"), 19.992440175);
-        labelToMass.insert(QString("Na"), 22.989769281);
-        labelToMass.insert(QString("Mg"), 23.985041699);
-        labelToMass.insert(QString("Al"), 26.981538627);
-        labelToMass.insert(QString("Si"), 27.976926532);
-        labelToMass.insert(QString("P"), 30.973761629);
-        labelToMass.insert(QString("S"), 31.972070999);
-        labelToMass.insert(QString("Cl"), 34.968852682);
-        labelToMass.insert(QString("Ar"), 39.962383123);
-        labelToMass.insert(QString("K"), 38.963706679);
-        labelToMass.insert(QString("Ca"), 39.962590983);
-        labelToMass.insert(QString("Sc"), 44.955911909);
-        labelToMass.insert(QString("Ti"), 47.947946281);
-        labelToMass.insert(QString("V"), 50.943959507);
-        labelToMass.insert(QString("Cr"), 51.940507472);
-        labelToMass.insert(QString("Mn"), 54.938045141);
-        labelToMass.insert(QString("Fe"), 55.934937475);
-        labelToMass.insert(QString("Co"), 58.933195048);
-        labelToMass.insert(QString("Ni"), 57.935342907);
-        labelToMass.insert(QString("Cu"), 62.929597474);
-        labelToMass.insert(QString("Zn"), 63.929142222);
-        labelToMass.insert(QString("Ga"), 68.925573587);
-        labelToMass.insert(QString("Ge"), 73.921177767);
-        labelToMass.insert(QString("As"), 74.921596478);
-        labelToMass.insert(QString("Se"), 79.916521271);
-        labelToMass.insert(QString("Br"), 78.918337087);
-        labelToMass.insert(QString("Kr"), 85.910610729);
-        labelToMass.insert(QString("Rb"), 84.911789737);
-        labelToMass.insert(QString("Sr"), 87.905612124);
-        labelToMass.insert(QString("Y"), 88.905848295);
-        labelToMass.insert(QString("Zr"), 89.904704416);
-        labelToMass.insert(QString("Nb"), 92.906378058);
-        labelToMass.insert(QString("Mo"), 97.905408169);
-        labelToMass.insert(QString("Tc"), 98.906254747);
-        labelToMass.insert(QString("Ru"), 101.904349312);
-        labelToMass.insert(QString("Rh"), 102.905504292);
-        labelToMass.insert(QString("Pd"), 105.903485715);
-        labelToMass.insert(QString("Ag"), 106.90509682);
-        labelToMass.insert(QString("Cd"), 113.90335854);
-        labelToMass.insert(QString("In"), 114.903878484);
-        labelToMass.insert(QString("Sn"), 119.902194676);
-        labelToMass.insert(QString("Sb"), 120.903815686);
-        labelToMass.insert(QString("Te"), 129.906224399);
-        labelToMass.insert(QString("I"), 126.904472681);
-        labelToMass.insert(QString("Xe"), 131.904153457);
-        labelToMass.insert(QString("Cs"), 132.905451932);
-        labelToMass.insert(QString("Ba"), 137.905247237);
-        labelToMass.insert(QString("La"), 138.906353267);
-        labelToMass.insert(QString("Ce"), 139.905438706);
-        labelToMass.insert(QString("Pr"), 140.907652769);
-        labelToMass.insert(QString("Nd"), 144.912749023);
-        labelToMass.insert(QString("Pm"), 151.919732425);
-        labelToMass.insert(QString("Sm"), 152.921230339);
-        labelToMass.insert(QString("Eu"), 157.924103912);
-        labelToMass.insert(QString("Gd"), 158.925346757);
-        labelToMass.insert(QString("Tb"), 163.929174751);
-        labelToMass.insert(QString("Dy"), 164.93032207);
-        labelToMass.insert(QString("Ho"), 165.930293061);
-        labelToMass.insert(QString("Er"), 168.93421325);
-        labelToMass.insert(QString("Tm"), 173.938862089);
-        labelToMass.insert(QString("Yb"), 174.940771819);
-        labelToMass.insert(QString("Lu"), 179.946549953);
-        labelToMass.insert(QString("Hf"), 180.947995763);
-        labelToMass.insert(QString("Ta"), 183.950931188);
-        labelToMass.insert(QString("W"), 186.955753109);
-        labelToMass.insert(QString("Re"), 191.96148069);
-        labelToMass.insert(QString("Os"), 192.96292643);
-        labelToMass.insert(QString("Ir"), 194.964791134);
-        labelToMass.insert(QString("Pt"), 196.966568662);
-        labelToMass.insert(QString("Au"), 201.970643011);
-        labelToMass.insert(QString("Hg"), 204.974427541);
-        labelToMass.insert(QString("Tl"), 207.976652071);
-        labelToMass.insert(QString("Pb"), 208.980398734);
-        labelToMass.insert(QString("Bi"), 208.982430435);
-        labelToMass.insert(QString("Po"), 210.987496271);
-        labelToMass.insert(QString("At"), 222.017577738);
-        labelToMass.insert(QString("Rn"), 222.01755173);
-        labelToMass.insert(QString("Fr"), 228.031070292);
-        labelToMass.insert(QString("Ra"), 227.027752127);
-        labelToMass.insert(QString("Ac"), 232.038055325);
-        labelToMass.insert(QString("Th"), 231.03588399);
-        labelToMass.insert(QString("Pa"), 238.050788247);
-        labelToMass.insert(QString("U"), 237.048173444);
-        labelToMass.insert(QString("Np"), 242.058742611);
-        labelToMass.insert(QString("Pu"), 243.06138108);
-        labelToMass.insert(QString("Am"), 247.07035354);
-        labelToMass.insert(QString("Cm"), 247.07030708);
-        labelToMass.insert(QString("Bk"), 251.079586788);
-        labelToMass.insert(QString("Cf"), 252.082978512);
-        labelToMass.insert(QString("Es"), 257.095104724);
-        labelToMass.insert(QString("Fm"), 258.098431319);
-        labelToMass.insert(QString("Md"), 255.093241131);
-        labelToMass.insert(QString("No"), 260.105504);
-        labelToMass.insert(QString("Lr"), 263.112547);
-        labelToMass.insert(QString("Rf"), 255.107398);
-        labelToMass.insert(QString("Db"), 259.114500);
-        labelToMass.insert(QString("Sg"), 262.122892);
-        labelToMass.insert(QString("Bh"), 263.128558);
-        labelToMass.insert(QString("Hs"), 265.136151);
-        labelToMass.insert(QString("Mt"), 281.162061);
-        labelToMass.insert(QString("Ds"), 272.153615);
-        labelToMass.insert(QString("Rg"), 283.171792);
+    int atomicNumber = PeriodicTable::atomicNumber(symbol);
+    if (atomicNumber < 0) {
+        return QColor();
     }
+    const Element &element = PeriodicTable::element(atomicNumber);
+    return QColor(element.red, element.green, element.blue);
 }
 
-void Atom::fillLabelToColorMap()
+QColor Atom::color(const QString &symbol, const QMap<QString, QVariant> &overrides)
 {
-    labelToColor.insert(QString("X"), QColor(255, 20, 147));
-    labelToColor.insert(QString("H"), QColor(255, 255, 255));
-    labelToColor.insert(QString("He"), QColor(217, 255, 255));
-    labelToColor.insert(QString("Li"), QColor(204, 128, 255));
-    labelToColor.insert(QString("Be"), QColor(194, 255, 0));
-    labelToColor.insert(QString("B"), QColor(255, 181, 181));
-    labelToColor.insert(QString("C"), QColor(144, 144, 144));
-    labelToColor.insert(QString("N"), QColor(40, 80, 248));
-    labelToColor.insert(QString("O"), QColor(255, 13, 13));
-    labelToColor.insert(QString("F"), QColor(144, 224, 80));
-    labelToColor.insert(QString("Ne"), QColor(179, 227, 245));
-    labelToColor.insert(QString("Na"), QColor(171, 92, 242));
-    labelToColor.insert(QString("Mg"), QColor(138, 255, 0));
-    labelToColor.insert(QString("Al"), QColor(191, 166, 166));
-    labelToColor.insert(QString("Si"), QColor(240, 200, 160));
-    labelToColor.insert(QString("P"), QColor(255, 128, 0));
-    labelToColor.insert(QString("S"), QColor(255, 255, 48));
-    labelToColor.insert(QString("Cl"), QColor(31, 240, 31));
-    labelToColor.insert(QString("Ar"), QColor(128, 209, 227));
-    labelToColor.insert(QString("K"), QColor(143, 64, 212));
-    labelToColor.insert(QString("Ca"), QColor(61, 255, 0));
-    labelToColor.insert(QString("Sc"), QColor(230, 230, 230));
-    labelToColor.insert(QString("Ti"), QColor(191, 194, 199));
-    labelToColor.insert(QString("V"), QColor(166, 166, 171));
-    labelToColor.insert(QString("Cr"), QColor(138, 153, 199));
-    labelToColor.insert(QString("Mn"), QColor(156, 122, 199));
-    labelToColor.insert(QString("Fe"), QColor(224, 102, 51));
-    labelToColor.insert(QString("Co"), QColor(240, 144, 160));
-    labelToColor.insert(QString("Ni"), QColor(80, 208, 80));
-    labelToColor.insert(QString("Cu"), QColor(200, 128, 51));
-    labelToColor.insert(QString("Zn"), QColor(125, 128, 176));
-    labelToColor.insert(QString("Ga"), QColor(194, 143, 143));
-    labelToColor.insert(QString("Ge"), QColor(102, 143, 143));
-    labelToColor.insert(QString("As"), QColor(189, 128, 227));
-    labelToColor.insert(QString("Se"), QColor(255, 161, 0));
-    labelToColor.insert(QString("Br"), QColor(166, 41, 41));
-    labelToColor.insert(QString("Kr"), QColor(92, 184, 209));
-    labelToColor.insert(QString("Rb"), QColor(112, 46, 176));
-    labelToColor.insert(QString("Sr"), QColor(0, 255, 0));
-    labelToColor.insert(QString("Y"), QColor(148, 255, 255));
-    labelToColor.insert(QString("Zr"), QColor(148, 224, 224));
-    labelToColor.insert(QString("Nb"), QColor(115, 194, 201));
-    labelToColor.insert(QString("Mo"), QColor(84, 181, 181));
-    labelToColor.insert(QString("Tc"), QColor(59, 158, 158));
-    labelToColor.insert(QString("Ru"), QColor(36, 143, 143));
-    labelToColor.insert(QString("Rh"), QColor(10, 125, 140));
-    labelToColor.insert(QString("Pd"), QColor(0, 105, 133));
-    labelToColor.insert(QString("Ag"), QColor(192, 192, 192));
-    labelToColor.insert(QString("Cd"), QColor(255, 217, 143));
-    labelToColor.insert(QString("In"), QColor(166, 117, 115));
-    labelToColor.insert(QString("Sn"), QColor(102, 128, 128));
-    labelToColor.insert(QString("Sb"), QColor(158, 99, 181));
-    labelToColor.insert(QString("Te"), QColor(212, 122, 0));
-    labelToColor.insert(QString("I"), QColor(148, 0, 148));
-    labelToColor.insert(QString("Xe"), QColor(66, 158, 176));
-    labelToColor.insert(QString("Cs"), QColor(87, 23, 143));
-    labelToColor.insert(QString("Ba"), QColor(0, 201, 0));
-    labelToColor.insert(QString("La"), QColor(112, 212, 255));
-    labelToColor.insert(QString("Ce"), QColor(255, 255, 199));
-    labelToColor.insert(QString("Pr"), QColor(217, 255, 199));
-    labelToColor.insert(QString("Nd"), QColor(199, 255, 199));
-    labelToColor.insert(QString("Pm"), QColor(163, 255, 199));
-    labelToColor.insert(QString("Sm"), QColor(143, 255, 199));
-    labelToColor.insert(QString("Eu"), QColor(97, 255, 199));
-    labelToColor.insert(QString("Gd"), QColor(69, 255, 199));
-    labelToColor.insert(QString("Tb"), QColor(48, 255, 199));
-    labelToColor.insert(QString("Dy"), QColor(31, 255, 199));
-    labelToColor.insert(QString("Ho"), QColor(0, 255, 156));
-    labelToColor.insert(QString("Er"), QColor(0, 230, 117));
-    labelToColor.insert(QString("Tm"), QColor(0, 212, 82));
-    labelToColor.insert(QString("Yb"), QColor(0, 191, 56));
-    labelToColor.insert(QString("Lu"), QColor(0, 171, 36));
-    labelToColor.insert(QString("Hf"), QColor(77, 194, 255));
-    labelToColor.insert(QString("Ta"), QColor(77, 166, 255));
-    labelToColor.insert(QString("W"), QColor(33, 148, 214));
-    labelToColor.insert(QString("Re"), QColor(38, 125, 171));
-    labelToColor.insert(QString("Os"), QColor(38, 102, 150));
-    labelToColor.insert(QString("Ir"), QColor(23, 84, 135));
-    labelToColor.insert(QString("Pt"), QColor(208, 208, 224));
-    labelToColor.insert(QString("Au"), QColor(255, 209, 35));
-    labelToColor.insert(QString("Hg"), QColor(184, 184, 208));
-    labelToColor.insert(QString("Tl"), QColor(166, 84, 77));
-    labelToColor.insert(QString("Pb"), QColor(87, 89, 97));
-    labelToColor.insert(QString("Bi"), QColor(158, 79, 181));
-    labelToColor.insert(QString("Po"), QColor(171, 92, 0));
-    labelToColor.insert(QString("At"), QColor(117, 79, 69));
-    labelToColor.insert(QString("Rn"), QColor(66, 130, 150));
-    labelToColor.insert(QString("Fr"), QColor(66, 0, 102));
-    labelToColor.insert(QString("Ra"), QColor(0, 125, 0));
-    labelToColor.insert(QString("Ac"), QColor(112, 171, 250));
-    labelToColor.insert(QString("Th"), QColor(0, 186, 255));
-    labelToColor.insert(QString("Pa"), QColor(0, 161, 255));
-    labelToColor.insert(QString("U"), QColor(0, 143, 255));
-    labelToColor.insert(QString("Np"), QColor(0, 128, 255));
-    labelToColor.insert(QString("Pu"), QColor(0, 107, 255));
-    labelToColor.insert(QString("Am"), QColor(84, 92, 242));
-    labelToColor.insert(QString("Cm"), QColor(120, 92, 227));
-    labelToColor.insert(QString("Bk"), QColor(138, 79, 227));
-    labelToColor.insert(QString("Cf"), QColor(161, 54, 212));
-    labelToColor.insert(QString("Es"), QColor(179, 31, 212));
-    labelToColor.insert(QString("Fm"), QColor(179, 31, 186));
-    labelToColor.insert(QString("Md"), QColor(179, 13, 166));
-    labelToColor.insert(QString("No"), QColor(189, 13, 135));
-    labelToColor.insert(QString("Lr"), QColor(199, 0, 102));
-    labelToColor.insert(QString("Rf"), QColor(204, 0, 89));
-    labelToColor.insert(QString("Db"), QColor(209, 0, 79));
-    labelToColor.insert(QString("Sg"), QColor(217, 0, 69));
-    labelToColor.insert(QString("Bh"), QColor(224, 0, 56));
-    labelToColor.insert(QString("Hs"), QColor(230, 0, 46));
-    labelToColor.insert(QString("Mt"), QColor(235, 0, 38));
-    labelToColor.insert(QString("Ds"), QColor(183, 189, 199));
-    labelToColor.insert(QString("Rg"), QColor(183, 189, 199));
+    QMap<QString, QVariant>::const_iterator color = overrides.constFind(symbol);
+    return color == overrides.constEnd() ? defaultColor(symbol) : color.value().value<QColor>();
 }
 
 void Atom::serialize(QXmlStreamWriter *writer)
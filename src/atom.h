@@ -12,6 +12,9 @@
 #include "defines.h"
 #include "drawinginfo.h"
 #include "error.h"
+#include "periodictable.h"
+
+class SvgWriter;
 
 class Atom : public QGraphicsEllipseItem
 {
@@ -19,13 +22,14 @@ class Atom : public QGraphicsEllipseItem
     enum { Type = UserType + ATOMTYPE };
     enum FontSizeStyle { SmallLabel, LargeLabel };
 
-    static QMap<QString, QVariant> labelToVdwRadius;
-    static QMap<QString, QVariant> labelToMass;
-    static QMap<QString, QVariant> labelToColor;
+    // The colors the user has chosen in place of the periodic table's, by symbol
+    static QMap<QString, QVariant> colorOverrides;
 
-    static void fillLabelToVdwRadiusMap();
-    static void fillLabelToMassMap();
-    static void fillLabelToColorMap();
+    static QColor defaultColor(const QString &symbol);
+    // Atoms complain about any other symbol when they're made
+    static bool hasKnownMass(const QString &symbol);
+    static QColor color(const QString &symbol,
+                        const QMap<QString, QVariant> &overrides = colorOverrides);
 
     Atom(QString element, DrawingInfo *info, QGraphicsItem *parent = 0);
 
@@ -59,6 +63,11 @@ class Atom : public QGraphicsEllipseItem
     {
         return myZ;
     }
+    // How far the atom is towards the viewer, once the view's rotation has been applied
+    double depth() const
+    {
+        return myDepth;
+    }
     bool labelHasSubscript()
     {
         return !myLabelSubscript.isEmpty();
@@ -75,36 +84,54 @@ class Atom : public QGraphicsEllipseItem
     {
         return myScaleFactor;
     }
+    QColor fillColor() const
+    {
+        return fill_color;
+    }
+    FontSizeStyle fontSizeStyle() const
+    {
+        return myFontSizeStyle;
+    }
     double effectiveRadius() const
     {
         return myEffectiveRadius;
     }
+    // The atomic number, or -1 if the symbol isn't an element
+    int atomicNumber() const
+    {
+        return myAtomicNumber;
+    }
     QString symbol() const
     {
         return mySymbol;
     }
-    QString label()
+    QString label() const
     {
         return (myLabel + (myLabelSubscript.size() ? "_" + myLabelSubscript : "") +
                 (myLabelSuperscript.size() ? "^" + myLabelSuperscript : ""));
     }
     void computeRadius();
+    // The layout pass: brings the rect and label font up to date, so that paint() needn't
+    void updateGeometry();
     void setLabelSubscript(const QString &string)
     {
         myLabelSubscript = string;
+        myGeometryDirty = true;
     }
     void setLabelSuperscript(const QString &string)
     {
         myLabelSuperscript = string;
+        myGeometryDirty = true;
     }
     void setLabelFontSize(int val)
     {
         myFontSize = val;
-        _info->getAtomLabelFont().setPointSizeF(double(val) * myEffectiveRadius / 20.0);
+        myGeometryDirty = true;
     }
     void setScaleFactor(double val)
     {
         myScaleFactor = val;
+        myGeometryDirty = true;
     }
     void setX(double val)
     {
@@ -118,6 +145,10 @@ class Atom : public QGraphicsEllipseItem
     {
         myZ = val;
     }
+    void setDepth(double val)
+    {
+        myDepth = val;
+    }
     void setLabel(const QString &text);
     void setAcceptsHovers(bool arg)
     {
@@ -129,6 +160,7 @@ class Atom : public QGraphicsEllipseItem
     void setColor(QColor color)
     {
         fill_color = color;
+        update();
     }
     void setFontSizeStyle(FontSizeStyle style);
     void setID(int val)
@@ -140,7 +172,22 @@ class Atom : public QGraphicsEllipseItem
 
     static double bondLength(Atom *, Atom *);
 
+    // Atoms that look the same, bar their size and position, share one drawing in SVG output
+    QString svgSymbolKey() const;
+    void writeSvgSymbol(SvgWriter *svg, const QString &id) const;
+    void writeSvg(SvgWriter *svg, const QString &symbol, const QPointF &center) const;
+
   protected:
+    void drawBody(QPainter *painter, const QPen &linestyle, const QRectF &fillRect) const;
+    QRectF bodyBounds(const QRectF &fillRect) const;
+    bool drawSprite(QPainter *painter, const QPen &linestyle, const QRectF &fillRect) const;
+    double lineWidth() const
+    {
+        // If we're hovering over the item, use thicker lines
+        return (hoverOver ? _info->scaleFactor() * 0.04 : _info->scaleFactor() * 0.01);
+    }
+    // How much of the white fog is drawn over the atom, out of 255
+    double fogOpacity() const;
     void hoverEnterEvent(QGraphicsSceneHoverEvent *event);
     void hoverLeaveEvent(QGraphicsSceneHoverEvent *event);
 
@@ -151,13 +198,19 @@ class Atom : public QGraphicsEllipseItem
     double myX;
     double myY;
     double myZ;
+    double myDepth;
     double myScaleFactor;
     QString myLabel;
     QString mySymbol;
     QString myLabelSubscript;
     QString myLabelSuperscript;
     int myFontSize;
+    QFont myLabelFont;
+    // Everything paint() might touch, worked out along with the rest of the geometry
+    QRectF myBounds;
+    bool myGeometryDirty;
     int myID;
+    int myAtomicNumber;
     bool hoverOver;
     QColor fill_color;
     DrawingInfo *_info;
@@ -14,7 +14,7 @@ AtomButton::AtomButton(DrawingCanvas *d, const char *label)
     QSize icon_box(dimension1, dimension2);
     // Start by drawing the button icon
     QPixmap icon(icon_box);
-    icon.fill(Atom::labelToColor.value(_label).value<QColor>());
+    icon.fill(Atom::color(_label));
     QPainter painter(&icon);
     QString text(_label);
     QFont font;
@@ -49,7 +49,7 @@ void AtomButton::refreshColor()
 
     QSize icon_box(dimension1, dimension2);
     QPixmap icon(icon_box);
-    icon.fill(Preferences::_colorChanges.value(_label).value<QColor>());
+    icon.fill(Atom::color(_label, Preferences::_colorChanges));
     QPainter painter(&icon);
     QString text(_label);
     QFont font;
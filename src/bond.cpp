@@ -1,19 +1,16 @@
 #include "bond.h"
+#include "svgwriter.h"
 
 Bond::Bond(Atom *atom1, Atom *atom2, DrawingInfo *info, QGraphicsItem *parent)
     : QGraphicsLineItem(parent), myStartAtom(atom1), myEndAtom(atom2), _info(info),
-      myThickness(DEFAULT_BOND_THICKNESS), hoverOver(false), dashedLine(false), myLabel(0),
-      myPen(Qt::black)
+      myThickness(DEFAULT_BOND_THICKNESS), effectiveWidth(0.0), hoverOver(false),
+      dashedLine(false), myLabel(0), myPen(Qt::black)
 {
     setFlag(QGraphicsItem::ItemIsSelectable, true);
     setAcceptHoverEvents(true);
-    updatePosition();
-    // So that the width of the line is correct when determining the shape
-    myPen.setWidth(effectiveWidth);
-    setPen(myPen);
-    myPen.setWidthF(hoverOver ? 1.5 * effectiveWidth : effectiveWidth);
-
     myLength = computeLength();
+    // This also sets the width of the line used to determine the shape
+    updatePosition();
 }
 
 void Bond::mouseReleaseEvent(QGraphicsSceneMouseEvent *event)
@@ -44,6 +41,7 @@ void Bond::hoverEnterEvent(QGraphicsSceneHoverEvent *event)
 {
     Q_UNUSED(event);
     hoverOver = true;
+    myPen.setWidthF(1.5 * effectiveWidth);
     update();
 }
 
@@ -51,6 +49,7 @@ void Bond::hoverLeaveEvent(QGraphicsSceneHoverEvent *event)
 {
     Q_UNUSED(event);
     hoverOver = false;
+    myPen.setWidthF(effectiveWidth);
     update();
 }
 
@@ -58,50 +57,32 @@ void Bond::updatePosition()
 {
     Atom *atom1 = myStartAtom;
     Atom *atom2 = myEndAtom;
+    double length = _info->scaleFactor() * myLength;
+    setPlacement(BondGeometry::placeBond(atom1->pos().x(), atom1->pos().y(), atom1->zValue(),
+                                         atom1->effectiveRadius(), atom2->pos().x(),
+                                         atom2->pos().y(), atom2->zValue(),
+                                         atom2->effectiveRadius(), length));
+}
+
+void Bond::setPlacement(const BondGeometry::BondPlacement &placement)
+{
+    setZValue(placement.z);
+    myPen.setCapStyle(placement.roundCap ? Qt::RoundCap : Qt::SquareCap);
+    double width = (1.0 + _info->perspective() * zValue()) * myThickness * _info->scaleFactor();
+    // The bounds depend on the width, so the scene has to hear about it before it changes
+    if (width != effectiveWidth) {
+        prepareGeometryChange();
+        effectiveWidth = width;
+        // The item's own pen is only used to work out the shape, for picking
+        QPen shapePen(pen());
+        shapePen.setWidthF(effectiveWidth);
+        setPen(shapePen);
+    }
+    setLine(QLineF(placement.start, placement.end));
+    myPen.setWidthF(hoverOver ? 1.5 * effectiveWidth : effectiveWidth);
 
-    double radius1 = atom1->effectiveRadius();
-    double radius2 = atom2->effectiveRadius();
-    double x1 = atom1->pos().x();
-    double y1 = atom1->pos().y();
-    double z1 = atom1->zValue();
-    double x2 = atom2->pos().x();
-    double y2 = atom2->pos().y();
-    double z2 = atom2->zValue();
-    double dx = x2 - x1;
-    double dy = y2 - y1;
-    double dz = z2 - z1;
-    double norm = sqrt(dx * dx + dy * dy);
-    // Phi is the angle subtended by the bond and the y axis(which runs negative)
-    double sinPhi = (norm == 0.0 ? 0.0 : dx / norm);
-    double cosPhi = (norm == 0.0 ? 0.0 : dy / norm);
-    // The angle subtended by the bond and the z axis
-    double r = sqrt(dx * dx + dy * dy + dz * dz);
-    double sinTheta = norm / r;
-    QPointF startPoint;
-    QPointF endPoint;
-
-    startPoint.setX(x1 + (radius1 * sinTheta * sinPhi));
-    startPoint.setY(y1 + (radius1 * sinTheta * cosPhi));
-    endPoint.setX(x2 - (radius2 * sinTheta * sinPhi));
-    endPoint.setY(y2 - (radius2 * sinTheta * cosPhi));
-    setLine(QLineF(startPoint, endPoint));
-
-    // The average position is used to determine the scale factor
-    // the TINY is there in case both atoms are at the same z
-    // in which case we must guarantee the bond goes behind the atoms
-    setZValue((atom1->zValue() + atom2->zValue()) / 2.0 - TINY);
-    myPen.setCapStyle((fabs(dz) > DZ_ZERO_TOL ? Qt::RoundCap : Qt::SquareCap));
-    effectiveWidth = (1.0 + _info->perspective() * zValue()) * myThickness * _info->scaleFactor();
-
-    // A cheap and cheerful guess of the label's position
     if (myLabel != 0) {
-        double length = _info->scaleFactor() * myLength;
-        // Account for differing radii
-        double rMidPoint = radius1 + (length - radius1 - radius2) / 2.0;
-        QPointF labelPos;
-        labelPos.setX(myLabel->dX() + x1 + rMidPoint * sinTheta * sinPhi);
-        labelPos.setY(myLabel->dY() + y1 + rMidPoint * sinTheta * cosPhi);
-        myLabel->setPos(labelPos);
+        myLabel->setPos(placement.labelAnchor + QPointF(myLabel->dX(), myLabel->dY()));
         myLabel->update();
     }
 }
@@ -117,35 +98,71 @@ void Bond::toggleDashing()
         this->generateDashedPen();
     }
     dashedLine = !dashedLine;
+    update();
+}
+
+QRectF Bond::boundingRect() const
+{
+    // Enough room for the caps and for the thicker line drawn while hovering
+    double margin = 0.75 * effectiveWidth;
+    return QRectF(line().p1(), line().p2()).normalized().adjusted(-margin, -margin, margin, margin);
 }
 
 void Bond::paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget)
 {
     Q_UNUSED(option);
     Q_UNUSED(widget);
-    myPen.setWidthF(hoverOver ? 1.5 * effectiveWidth : effectiveWidth);
-    myPen.setColor(_info->getBondColor());
+    // While the view is being dragged, a hairline will do
+    if (_info->lowDetail()) {
+        QPen pen(isSelected() ? SELECTED_COLOR : _info->getBondColor(), 0);
+        painter->setPen(pen);
+        painter->drawLine(line());
+        return;
+    }
+    // The width was worked out in updatePosition(), only the colors are decided here
+    QPen pen(myPen);
+    pen.setColor(_info->getBondColor());
     painter->setBrush(_info->getBondColor());
-    painter->setPen(myPen);
+    painter->setPen(pen);
     painter->drawLine(line());
     if (isSelected()) {
-        myPen.setColor(SELECTED_COLOR);
-        painter->setPen(myPen);
+        pen.setColor(SELECTED_COLOR);
+        painter->setPen(pen);
         painter->drawLine(line());
     }
     // Draw a semi-transparent white line for fogging
     if (_info->getUseFogging()) {
-        double dZ = _info->maxBondZ() - _info->minBondZ();
-        double thisZ = fabs(computeMidZ() - _info->maxBondZ());
-        double opacity = (dZ > TINY ? 2.56 * (_info->getFoggingScale()) * (thisZ / dZ) : 0.0);
-        opacity = (opacity < 0 ? 0 : opacity);
-        opacity = (opacity > 255 ? 255 : opacity);
-        myPen.setColor(QColor(255, 255, 255, opacity));
-        painter->setPen(myPen);
+        pen.setColor(QColor(255, 255, 255, fogOpacity()));
+        painter->setPen(pen);
         painter->drawLine(line());
     }
 }
 
+void Bond::writeSvg(SvgWriter *svg)
+{
+    QPen pen(myPen);
+    pen.setColor(_info->getBondColor());
+    svg->writeLine(line(), pen);
+    if (isSelected()) {
+        pen.setColor(SELECTED_COLOR);
+        svg->writeLine(line(), pen);
+    }
+    if (_info->getUseFogging()) {
+        pen.setColor(QColor(255, 255, 255, fogOpacity()));
+        svg->writeLine(line(), pen);
+    }
+}
+
+double Bond::fogOpacity()
+{
+    double dZ = _info->maxBondZ() - _info->minBondZ();
+    double thisZ = fabs(computeMidZ() - _info->maxBondZ());
+    double opacity = (dZ > TINY ? 2.56 * (_info->getFoggingScale()) * (thisZ / dZ) : 0.0);
+    opacity = (opacity < 0 ? 0 : opacity);
+    opacity = (opacity > 255 ? 255 : opacity);
+    return opacity;
+}
+
 void Bond::serialize(QXmlStreamWriter *writer)
 {
     writer->writeStartElement("Bond");
@@ -8,10 +8,13 @@
 #include <iostream>
 
 #include "atom.h"
+#include "bondgeometry.h"
 #include "defines.h"
 #include "drawinginfo.h"
 #include "label.h"
 
+class SvgWriter;
+
 class Bond : public QGraphicsLineItem
 {
   private:
@@ -34,6 +37,7 @@ class Bond : public QGraphicsLineItem
 
     Bond(Atom *startAtom, Atom *endAtom, DrawingInfo *drawingInfo, QGraphicsItem *parent = 0);
 
+    QRectF boundingRect() const;
     void paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget = 0);
 
     void setColor(const QColor &color)
@@ -47,6 +51,8 @@ class Bond : public QGraphicsLineItem
     void toggleDashing();
     void toggleLabel();
     void updatePosition();
+    // Puts the bond where the batched geometry code worked out it should go
+    void setPlacement(const BondGeometry::BondPlacement &placement);
     Label *label()
     {
         return myLabel;
@@ -65,7 +71,7 @@ class Bond : public QGraphicsLineItem
     }
     double computeMidZ()
     {
-        return myStartAtom->z() + myEndAtom->z() / 2.0;
+        return myStartAtom->depth() + myEndAtom->depth() / 2.0;
     }
     double thickness() const
     {
@@ -86,6 +92,7 @@ class Bond : public QGraphicsLineItem
         return dashedLine;
     }
 
+    void writeSvg(SvgWriter *svg);
     void serialize(QXmlStreamWriter *writer);
     static Bond *
     deserialize(QXmlStreamReader *reader, DrawingInfo *drawingInfo, QList<Atom *> atoms);
@@ -110,6 +117,8 @@ class Bond : public QGraphicsLineItem
     {
         return Atom::bondLength(myStartAtom, myEndAtom);
     }
+    // How much of the white fog is drawn over the bond, out of 255
+    double fogOpacity();
 };
 
 #endif /*BOND_H_*/
@@ -0,0 +1,27 @@
+#include "bondgeometry.h"
+
+void BondGeometry::placeBonds(int numBonds, const int *atom1, const int *atom2,
+                              const double *lengths, const double *x, const double *y,
+                              const double *z, const double *radii, BondPlacement *placements)
+{
+    for (int i = 0; i < numBonds; ++i) {
+        int a = atom1[i];
+        int b = atom2[i];
+        placements[i] =
+            placeBond(x[a], y[a], z[a], radii[a], x[b], y[b], z[b], radii[b], lengths[i]);
+    }
+}
+
+void BondGeometry::placeAngles(int numAngles, const int *start, const int *center,
+                               const int *end, const double *x, const double *y, const double *z,
+                               const double *radii, double markerOffset,
+                               AnglePlacement *placements)
+{
+    for (int i = 0; i < numAngles; ++i) {
+        int a = start[i];
+        int c = center[i];
+        int b = end[i];
+        placements[i] = placeAngle(x[a], y[a], z[a], x[c], y[c], z[c], x[b], y[b], z[b],
+                                   radii[c] + markerOffset);
+    }
+}
@@ -0,0 +1,129 @@
+#ifndef BONDGEOMETRY_H_
+#define BONDGEOMETRY_H_
+
+#include <QPointF>
+#include <cmath>
+
+#include "defines.h"
+
+/*
+ * Works out where the bonds and angle markers go, from the atoms' screen positions, depths and
+ * radii.  Everything is done with plain vector algebra: the directions the old code found by
+ * going to and from angles with acos, sin and cos are just the normalized bond vectors, so there
+ * is no trigonometry left at all.  The batched versions take the atoms as flat arrays, with the
+ * atoms of each bond or angle given as indices, so the canvas can place everything in one pass;
+ * the single versions are there for items that move on their own.
+ */
+class BondGeometry
+{
+  public:
+    struct BondPlacement {
+        QPointF start;
+        QPointF end;
+        double z;
+        bool roundCap;
+        // Where the bond label goes, before the user's own offset is added
+        QPointF labelAnchor;
+    };
+
+    struct AnglePlacement {
+        // Each half of the marker is a quadratic from the bond to the middle of the arc
+        QPointF start;
+        QPointF startGuide;
+        QPointF end;
+        QPointF endGuide;
+        QPointF mid;
+        double startZ;
+        double endZ;
+        // Where the angle label goes, before the user's own offset is added
+        QPointF labelAnchor;
+    };
+
+    // The length is the bond's own length, in scene units, which is where the label is centered
+    static BondPlacement placeBond(double x1, double y1, double z1, double radius1, double x2,
+                                   double y2, double z2, double radius2, double length)
+    {
+        BondPlacement p;
+        double dx = x2 - x1;
+        double dy = y2 - y1;
+        double dz = z2 - z1;
+        double r = sqrt(dx * dx + dy * dy + dz * dz);
+        // The screen direction, shortened by however much the bond points out of the screen
+        double ux = (r == 0.0 ? 0.0 : dx / r);
+        double uy = (r == 0.0 ? 0.0 : dy / r);
+        p.start = QPointF(x1 + radius1 * ux, y1 + radius1 * uy);
+        p.end = QPointF(x2 - radius2 * ux, y2 - radius2 * uy);
+        // The TINY is there in case both atoms are at the same z, in which case we must guarantee
+        // the bond goes behind the atoms
+        p.z = (z1 + z2) / 2.0 - TINY;
+        p.roundCap = fabs(dz) > DZ_ZERO_TOL;
+        // Account for differing radii
+        double rMidPoint = radius1 + (length - radius1 - radius2) / 2.0;
+        p.labelAnchor = QPointF(x1 + rMidPoint * ux, y1 + rMidPoint * uy);
+        return p;
+    }
+
+    // The marker is drawn on a sphere of the given radius about the center atom
+    static AnglePlacement placeAngle(double x1, double y1, double z1, double xc, double yc,
+                                     double zc, double x3, double y3, double z3, double radius)
+    {
+        // The angle markers stop short of the bonds, by this fraction of the other bond
+        static const double fraction = atan(ANGLE_MARKER_OFFSET);
+        AnglePlacement p;
+        // The points where the arc would touch the bonds, relative to the center atom
+        double a1x = x1 - xc, a1y = y1 - yc, a1z = z1 - zc;
+        double a3x = x3 - xc, a3y = y3 - yc, a3z = z3 - zc;
+        double s1 = radius / sqrt(a1x * a1x + a1y * a1y + a1z * a1z);
+        double s3 = radius / sqrt(a3x * a3x + a3y * a3y + a3z * a3z);
+        a1x *= s1, a1y *= s1, a1z *= s1;
+        a3x *= s3, a3y *= s3, a3z *= s3;
+
+        // Both are radius long, so their sum points to the middle of the arc
+        double mx = a1x + a3x, my = a1y + a3y, mz = a1z + a3z;
+        double s = radius / sqrt(mx * mx + my * my + mz * mz);
+        mx *= s, my *= s, mz *= s;
+
+        // The ends of the marker, pulled in from the bonds; both have the same length
+        double sx = a1x + fraction * a3x, sy = a1y + fraction * a3y, sz = a1z + fraction * a3z;
+        double ex = a3x + fraction * a1x, ey = a3y + fraction * a1y, ez = a3z + fraction * a1z;
+        s = radius / sqrt(sx * sx + sy * sy + sz * sz);
+        sx *= s, sy *= s, sz *= s;
+        ex *= s, ey *= s, ez *= s;
+
+        // The quarter and three quarter points along the arc, which are also the same length
+        s = radius / sqrt((mx + sx) * (mx + sx) + (my + sy) * (my + sy) + (mz + sz) * (mz + sz));
+        double q1x = s * (sx + mx), q1y = s * (sy + my);
+        double q3x = s * (ex + mx), q3y = s * (ey + my);
+
+        p.start = QPointF(xc + sx, yc + sy);
+        p.end = QPointF(xc + ex, yc + ey);
+        p.mid = QPointF(xc + mx, yc + my);
+        // This is the interpolation formula to force each curve through its quarter point
+        p.startGuide = QPointF(xc + 2.0 * q1x - 0.5 * (sx + mx), yc + 2.0 * q1y - 0.5 * (sy + my));
+        p.endGuide = QPointF(xc + 2.0 * q3x - 0.5 * (ex + mx), yc + 2.0 * q3y - 0.5 * (ey + my));
+        p.startZ = zc + sz;
+        p.endZ = zc + ez;
+        // A cheap and cheerful guess of the label's position
+        p.labelAnchor = QPointF(xc + 1.5 * s * (ex + sx), yc + 1.5 * s * (ey + sy));
+        return p;
+    }
+
+    /*
+     * The atoms are given as arrays of their screen positions, depths and radii.  Each bond is
+     * between atoms atom1[i] and atom2[i], and has length lengths[i].
+     */
+    static void placeBonds(int numBonds, const int *atom1, const int *atom2, const double *lengths,
+                           const double *x, const double *y, const double *z,
+                           const double *radii, BondPlacement *placements);
+
+    /*
+     * Each angle is between atoms start[i], center[i] and end[i], and its marker is drawn at
+     * markerOffset further out than the center atom's radius.
+     */
+    static void placeAngles(int numAngles, const int *start, const int *center, const int *end,
+                            const double *x, const double *y, const double *z,
+                            const double *radii, double markerOffset,
+                            AnglePlacement *placements);
+};
+
+#endif /*BONDGEOMETRY_H_*/
@@ -0,0 +1,128 @@
+#include "bondperception.h"
+
+#include <algorithm>
+#include <cmath>
+
+// The grid is never allowed more than this many cells per atom, however spread out they are
+#define MAX_CELLS_PER_ATOM 8
+
+static bool isFinite(double x, double y, double z)
+{
+    return std::isfinite(x) && std::isfinite(y) && std::isfinite(z);
+}
+
+QVector<BondPerception::AtomPair> BondPerception::findBonds(int numAtoms, const double *x,
+                                                            const double *y, const double *z,
+                                                            const double *radii, double scale)
+{
+    QVector<AtomPair> bonds;
+    if (numAtoms < 2) {
+        return bonds;
+    }
+
+    // Atoms with a NaN or infinite coordinate can't bond, and would stop the cell size below from
+    // ever settling, so they're left out of the grid
+    double xMin = 0.0, xMax = 0.0, yMin = 0.0, yMax = 0.0, zMin = 0.0, zMax = 0.0;
+    double maxRadius = 0.0;
+    int numPlaced = 0;
+    for (int i = 0; i < numAtoms; ++i) {
+        if (!isFinite(x[i], y[i], z[i])) {
+            continue;
+        }
+        if (numPlaced++ == 0) {
+            xMin = xMax = x[i];
+            yMin = yMax = y[i];
+            zMin = zMax = z[i];
+        }
+        xMin = std::min(xMin, x[i]);
+        xMax = std::max(xMax, x[i]);
+        yMin = std::min(yMin, y[i]);
+        yMax = std::max(yMax, y[i]);
+        zMin = std::min(zMin, z[i]);
+        zMax = std::max(zMax, z[i]);
+        maxRadius = std::max(maxRadius, radii[i]);
+    }
+    if (numPlaced < 2) {
+        return bonds;
+    }
+
+    // No bond can be longer than this, so bonded atoms are always in the same or adjacent cells
+    double cellSize = std::max(2.0 * maxRadius * scale, 1e-3);
+    double cellsX, cellsY, cellsZ;
+    for (;;) {
+        cellsX = std::floor((xMax - xMin) / cellSize) + 1.0;
+        cellsY = std::floor((yMax - yMin) / cellSize) + 1.0;
+        cellsZ = std::floor((zMax - zMin) / cellSize) + 1.0;
+        if (cellsX * cellsY * cellsZ <= double(MAX_CELLS_PER_ATOM) * numPlaced) {
+            break;
+        }
+        cellSize *= 2.0;
+    }
+    int nx = static_cast<int>(cellsX);
+    int ny = static_cast<int>(cellsY);
+    int nz = static_cast<int>(cellsZ);
+    int numCells = nx * ny * nz;
+
+    // A counting sort of the atoms by cell; cellStart[c] is where cell c's atoms begin
+    QVector<int> cellOf(numAtoms, -1);
+    QVector<int> cellStart(numCells + 1, 0);
+    for (int i = 0; i < numAtoms; ++i) {
+        if (!isFinite(x[i], y[i], z[i])) {
+            continue;
+        }
+        int cx = static_cast<int>((x[i] - xMin) / cellSize);
+        int cy = static_cast<int>((y[i] - yMin) / cellSize);
+        int cz = static_cast<int>((z[i] - zMin) / cellSize);
+        cellOf[i] = (cz * ny + cy) * nx + cx;
+        ++cellStart[cellOf[i] + 1];
+    }
+    for (int c = 0; c < numCells; ++c) {
+        cellStart[c + 1] += cellStart[c];
+    }
+    QVector<int> cellAtoms(numPlaced);
+    QVector<int> next = cellStart;
+    for (int i = 0; i < numAtoms; ++i) {
+        if (cellOf[i] >= 0) {
+            cellAtoms[next[cellOf[i]]++] = i;
+        }
+    }
+
+    QVector<int> partners;
+    for (int i = 0; i < numAtoms; ++i) {
+        if (cellOf[i] < 0) {
+            continue;
+        }
+        int cx = cellOf[i] % nx;
+        int cy = (cellOf[i] / nx) % ny;
+        int cz = cellOf[i] / (nx * ny);
+        partners.clear();
+        for (int dz = std::max(cz - 1, 0); dz <= std::min(cz + 1, nz - 1); ++dz) {
+            for (int dy = std::max(cy - 1, 0); dy <= std::min(cy + 1, ny - 1); ++dy) {
+                for (int dx = std::max(cx - 1, 0); dx <= std::min(cx + 1, nx - 1);
+                     ++dx) {
+                    int cell = (dz * ny + dy) * nx + dx;
+                    for (int k = cellStart[cell]; k < cellStart[cell + 1]; ++k) {
+                        // Each cell's atoms are in order, so the rest are all after atom i
+                        int j = cellAtoms[k];
+                        if (j >= i) {
+                            break;
+                        }
+                        double deltaX = x[i] - x[j];
+                        double deltaY = y[i] - y[j];
+                        double deltaZ = z[i] - z[j];
+                        double cutoff = (radii[i] + radii[j]) * scale;
+                        if (deltaX * deltaX + deltaY * deltaY + deltaZ * deltaZ <
+                            cutoff * cutoff) {
+                            partners.append(j);
+                        }
+                    }
+                }
+            }
+        }
+        std::sort(partners.begin(), partners.end());
+        foreach (int j, partners) {
+            bonds.append(AtomPair(i, j));
+        }
+    }
+    return bonds;
+}
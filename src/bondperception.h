@@ -0,0 +1,27 @@
+#ifndef BONDPERCEPTION_H_
+#define BONDPERCEPTION_H_
+
+#include <QPair>
+#include <QVector>
+
+/*
+ * Decides which atoms are bonded: two atoms are bonded if they're closer than the sum of their
+ * radii, multiplied by a scale factor.  Rather than comparing every pair of atoms, they're
+ * sorted into a grid of cells at least as wide as the longest possible bond, so each atom only
+ * needs comparing with those in its own cell and the 26 around it, and the time taken grows
+ * linearly with the number of atoms.
+ */
+class BondPerception
+{
+  public:
+    typedef QPair<int, int> AtomPair;
+
+    /*
+     * Returns the bonded pairs of atoms, as (i, j) with j < i, in order of i then j, which is the
+     * order a loop over every pair would find them in.
+     */
+    static QVector<AtomPair> findBonds(int numAtoms, const double *x, const double *y,
+                                       const double *z, const double *radii, double scale);
+};
+
+#endif /*BONDPERCEPTION_H_*/
@@ -16,6 +16,7 @@
 #define ANGLELABELTYPE 7
 #define BONDLABELTYPE 8
 #define TEXTLABELTYPE 9
+#define MOLECULEITEMTYPE 10
 
 #define TINY 0.00001
 
@@ -47,6 +48,40 @@
 
 #define DEFAULT_ARROW_THICKNESS 0.013
 
+// The number of decoded atoms kept around when stepping through a trajectory
+#define FRAME_CACHE_ATOMS 200000
+// Files larger than this are split up and indexed on several threads at once
+#define PARALLEL_PARSE_SIZE (16 * 1024 * 1024)
+// Files at least this large have their frames saved to a cache, so they open quickly next time
+#define TRAJECTORY_CACHE_SIZE (4 * 1024 * 1024)
+// The caches are pruned to this much disk space, keeping the ones most recently written
+#define TRAJECTORY_CACHE_LIMIT (qint64(2048) * 1024 * 1024)
+// How much of an output file is looked through for signs of the program that wrote it
+#define DEFAULT_FILE_TYPE_DETECTION_KB 256
+// Atom sprites are cached at this fraction of a pixel in radius; larger atoms are drawn directly
+#define ATOM_SPRITE_RADIUS_STEP 0.25
+#define ATOM_SPRITE_MAX_SIZE 512
+// Molecules with more atoms than this are drawn by a single item, rather than one item per atom
+#define BATCHED_RENDERING_ATOMS 5000
+// Scheduled refreshes are run at most this often, which is about once per display frame
+#define REFRESH_INTERVAL_MS 16
+// While the view is dragged, molecules at least this big are drawn as plain discs and lines...
+#define DEFAULT_LOD_ATOMS 1000
+// ...until the drag ends, or the mouse has been still for this long
+#define DEFAULT_LOD_IDLE_MS 250
+// How many different bond and angle values are kept laid out, ready to draw
+#define LABEL_TEXT_CACHE_SIZE 1000
+// Exporting an animation keeps at most this many frames per thread drawn but not yet written
+#define ANIMATION_FRAMES_PER_THREAD 2
+#define DEFAULT_ANIMATION_FRAME_DELAY_MS 100
+// Images are five times the size of the scene, which at this resolution is the size of the PDFs
+#define DEFAULT_IMAGE_DPI 72
+// PNG and TIFF images bigger than this are drawn and written a band of rows at a time...
+#define TILED_IMAGE_MIN_BYTES (64 * 1024 * 1024)
+// ...in bands of about this size, with at most this many per thread waiting to be written
+#define IMAGE_BAND_BYTES (16 * 1024 * 1024)
+#define IMAGE_BANDS_PER_THREAD 2
+
 #define BOHR_TO_ANG 0.529177249
 #define ANG_TO_BOHR 1.889725989
 #define DEG_TO_RAD 0.01745329251994330
@@ -54,6 +89,8 @@
 #define PI 3.14159265
 
 #define ANGLE_MARKER_OFFSET 0.4
+// How much further out than the center atom the angle marker is drawn, in Angstrom
+#define ANGLE_MARKER_DISTANCE 0.2
 
 #define ITEM_IS_LABEL                                                                              \
     item->type() == Label::AngleLabelType || item->type() == Label::BondLabelType ||               \
@@ -1,5 +1,9 @@
 #include "drawingcanvas.h"
 #include <QColorDialog>
+#include <QDebug>
+#include <QSettings>
+#include <QThread>
+#include <algorithm>
 
 #define SIGN(a, b) (b >= 0 ? (a >= 0 ? a : -a) : (a >= 0 ? -a : a))
 #define MAX(a, b) (a > b ? a : b)
@@ -24,15 +28,29 @@ extern void DGESVD(char *,
 
 DrawingCanvas::DrawingCanvas(DrawingInfo *info, FileParser *in_parser, QObject *parent)
     : QGraphicsScene(parent), parser(in_parser), drawingInfo(info), myBackgroundColor(Qt::white),
-      myMoveCursor(QPixmap(":/images/cursor_move.png")),
-      myRotateCursor(QPixmap(":/images/cursor_rotate.png")),
       myBackgroundAlpha(DEFAULT_BACKGROUND_OPACITY / 100.0 * 255)
 {
+    // Pixmaps only live on the GUI thread, and canvases built elsewhere are only ever rendered
+    if (QThread::currentThread() == QCoreApplication::instance()->thread()) {
+        myMoveCursor = QCursor(QPixmap(":/images/cursor_move.png"));
+        myRotateCursor = QCursor(QPixmap(":/images/cursor_rotate.png"));
+    }
     myMode = Select;
     bondline = 0;
     selectionRectangle = 0;
     myArrow = 0;
     myTempMoveItem = 0;
+    myMoleculeItem = 0;
+    myRefreshTimer = new QTimer(this);
+    myRefreshTimer->setSingleShot(true);
+    connect(myRefreshTimer, SIGNAL(timeout()), this, SLOT(refresh()));
+    myDetailTimer = new QTimer(this);
+    myDetailTimer->setSingleShot(true);
+    connect(myDetailTimer, SIGNAL(timeout()), this, SLOT(restoreDetail()));
+    memset(&myRefreshStats, 0, sizeof(myRefreshStats));
+    // Only ever switched on by hand, when the refresh timing needs looking at
+    QSettings settings;
+    myLogRefreshes = settings.value("Log Refresh Timing", false).toBool();
     // Hack to make the background border disappear (unless background color is changed)
     // myBackgroundColor.setAlpha(myBackgroundAlpha);
     myBackgroundColor.setAlpha(0);
@@ -50,7 +68,7 @@ DrawingCanvas::DrawingCanvas(DrawingInfo *info, FileParser *in_parser, QObject *
 void DrawingCanvas::updateAtomColors(QMap<QString, QVariant> newColors)
 {
     foreach (Atom *atom, atomsList) {
-        atom->setColor(newColors.value(atom->symbol()).value<QColor>());
+        atom->setColor(Atom::color(atom->symbol(), newColors));
     }
     update();
 }
@@ -65,12 +83,15 @@ void DrawingCanvas::focusOutEvent(QFocusEvent *event)
     }
 }
 
+// The scene's background brush is kept in step with the color, so that copies of the canvas, and
+// the SVG writer, can take it from there
 void DrawingCanvas::drawBackground(QPainter *painter, const QRectF &)
 {
-    if (myBackgroundColor.alpha() == 0) {
+    QBrush brush = backgroundBrush();
+    if (brush.style() == Qt::NoBrush || brush.color().alpha() == 0) {
         return;
     }
-    painter->setBrush(myBackgroundColor);
+    painter->setBrush(brush);
     painter->drawRect(sceneRect());
 }
 
@@ -80,20 +101,37 @@ void DrawingCanvas::clearAll()
         removeItem(item);
         delete item;
     }
+    // The molecule item's atoms and bonds never made it into the scene
+    if (myMoleculeItem != 0) {
+        qDeleteAll(atomsList);
+        qDeleteAll(bondsList);
+        myMoleculeItem = 0;
+    }
     atomsList.clear();
     bondsList.clear();
     anglesList.clear();
     arrowsList.clear();
     textLabelsList.clear();
+    myNeighbours.clear();
+    myBondIndex.clear();
+    myAngleIndex.clear();
+    myCoordinates.clear();
 }
 
 void DrawingCanvas::storeLabeledBonds()
 {
+    persistantBonds += labeledBonds();
+}
+
+QList<int> DrawingCanvas::labeledBonds() const
+{
+    QList<int> labeled;
     for (int i = 0; i < bondsList.size(); i++) {
         if (bondsList[i]->hasLabel()) {
-            persistantBonds.push_back(i);
+            labeled.push_back(i);
         }
     }
+    return labeled;
 }
 
 void DrawingCanvas::restoreLabeledBonds()
@@ -104,12 +142,100 @@ void DrawingCanvas::restoreLabeledBonds()
     persistantBonds.clear();
 }
 
+// Bonds are matched up between steps by the atoms they join, whichever way round they are
+static QPair<int, int> bondKey(const Bond *bond)
+{
+    int start = bond->startAtom()->ID();
+    int end = bond->endAtom()->ID();
+    return start < end ? qMakePair(start, end) : qMakePair(end, start);
+}
+
+DrawingCanvas::ItemStyles DrawingCanvas::itemStyles() const
+{
+    ItemStyles styles;
+    styles.atoms.reserve(atomsList.size());
+    foreach (Atom *atom, atomsList) {
+        AtomStyle style;
+        style.symbol = atom->symbol();
+        style.label = atom->label();
+        style.color = atom->fillColor();
+        style.scaleFactor = atom->scaleFactor();
+        style.fontSize = atom->fontSize();
+        style.fontSizeStyle = atom->fontSizeStyle();
+        styles.atoms.append(style);
+    }
+    foreach (Bond *bond, bondsList) {
+        if (bond->isDashed() || bond->thickness() != DEFAULT_BOND_THICKNESS) {
+            BondStyle style;
+            style.thickness = bond->thickness();
+            style.dashed = bond->isDashed();
+            styles.bonds.insert(bondKey(bond), style);
+        }
+    }
+    return styles;
+}
+
+void DrawingCanvas::applyItemStyles(const ItemStyles &styles)
+{
+    int numAtoms = std::min(atomsList.size(), styles.atoms.size());
+    for (int i = 0; i < numAtoms; ++i) {
+        const AtomStyle &style = styles.atoms[i];
+        Atom *atom = atomsList[i];
+        // A different molecule altogether has nothing to take from this one
+        if (atom->symbol() != style.symbol) {
+            return;
+        }
+        // Parsing the label is the slow part, and it's seldom changed
+        if (atom->label() != style.label) {
+            atom->setLabel(style.label);
+        }
+        atom->setColor(style.color);
+        atom->setScaleFactor(style.scaleFactor);
+        atom->setFontSizeStyle(style.fontSizeStyle);
+        atom->setLabelFontSize(style.fontSize);
+    }
+    if (styles.bonds.isEmpty()) {
+        return;
+    }
+    foreach (Bond *bond, bondsList) {
+        QHash<QPair<int, int>, BondStyle>::const_iterator style =
+            styles.bonds.constFind(bondKey(bond));
+        if (style == styles.bonds.constEnd()) {
+            continue;
+        }
+        if (bond->isDashed() != style->dashed) {
+            bond->toggleDashing();
+        }
+        bond->setThickness(style->thickness);
+    }
+}
+
 void DrawingCanvas::unselectAll()
 {
+    if (myMoleculeItem != 0) {
+        // Only the atoms and bonds that actually change need repainting
+        foreach (Atom *atom, myMoleculeItem->atoms()) {
+            if (atom->isSelected()) {
+                atom->setSelected(false);
+                myMoleculeItem->updateItem(atom);
+            }
+        }
+        foreach (Bond *bond, myMoleculeItem->bonds()) {
+            if (bond->isSelected()) {
+                bond->setSelected(false);
+                myMoleculeItem->updateItem(bond);
+            }
+        }
+        emit selectionChanged();
+    }
     foreach (QGraphicsItem *item, items()) {
         item->setSelected(false);
         if (ITEM_IS_LABEL) {
             Label *label = dynamic_cast<Label *>(item);
+            // Static labels have no document, and no cursor or focus to clear
+            if (label->isStatic()) {
+                continue;
+            }
             QTextCursor cursor = label->textCursor();
             cursor.clearSelection();
             label->setTextCursor(cursor);
@@ -117,15 +243,79 @@ void DrawingCanvas::unselectAll()
             label->clearFocus();
         }
     }
-    update();
 }
 
 void DrawingCanvas::selectAll()
 {
+    if (myMoleculeItem != 0) {
+        // Only the atoms and bonds that actually change need repainting, and deleted ones stay
+        // unselected
+        foreach (Atom *atom, myMoleculeItem->atoms()) {
+            if (!atom->isSelected()) {
+                atom->setSelected(true);
+                myMoleculeItem->updateItem(atom);
+            }
+        }
+        foreach (Bond *bond, myMoleculeItem->bonds()) {
+            if (!bond->isSelected()) {
+                bond->setSelected(true);
+                myMoleculeItem->updateItem(bond);
+            }
+        }
+        emit selectionChanged();
+    }
     foreach (QGraphicsItem *item, items()) {
         item->setSelected(true);
     }
-    update();
+}
+
+QList<QGraphicsItem *> DrawingCanvas::selection() const
+{
+    QList<QGraphicsItem *> selected = selectedItems();
+    if (myMoleculeItem != 0) {
+        foreach (Atom *atom, myMoleculeItem->atoms()) {
+            if (atom->isSelected()) {
+                selected.append(atom);
+            }
+        }
+        foreach (Bond *bond, myMoleculeItem->bonds()) {
+            if (bond->isSelected()) {
+                selected.append(bond);
+            }
+        }
+    }
+    return selected;
+}
+
+Atom *DrawingCanvas::atomAt(const QPointF &pos)
+{
+    foreach (QGraphicsItem *item, items(pos)) {
+        if (item->type() == Atom::Type) {
+            return qgraphicsitem_cast<Atom *>(item);
+        }
+        if (item == myMoleculeItem) {
+            Atom *atom = myMoleculeItem->atomAt(pos);
+            if (atom != 0) {
+                return atom;
+            }
+        }
+    }
+    return 0;
+}
+
+QGraphicsItem *DrawingCanvas::pickItem(const QPointF &pos)
+{
+    foreach (QGraphicsItem *item, items(pos)) {
+        if (item != myMoleculeItem) {
+            return item;
+        }
+        // The molecule item covers the whole molecule, so ask it what's really under the cursor
+        QGraphicsItem *picked = myMoleculeItem->itemAt(pos);
+        if (picked != 0) {
+            return picked;
+        }
+    }
+    return 0;
 }
 
 void DrawingCanvas::setBondLabelPrecision(int val)
@@ -136,7 +326,6 @@ void DrawingCanvas::setBondLabelPrecision(int val)
             bond->label()->updateLabel();
         }
     }
-    update();
 }
 
 void DrawingCanvas::setAngleLabelPrecision(int val)
@@ -145,7 +334,6 @@ void DrawingCanvas::setAngleLabelPrecision(int val)
     foreach (Angle *angle, anglesList) {
         angle->label()->updateLabel();
     }
-    update();
 }
 
 void DrawingCanvas::setAtomLabels(QString text)
@@ -155,7 +343,7 @@ void DrawingCanvas::setAtomLabels(QString text)
             atom->setLabel(text);
         }
     }
-    update();
+    updateLayout();
 }
 
 void DrawingCanvas::setAtomDrawingStyle(int style)
@@ -172,7 +360,7 @@ void DrawingCanvas::setAtomFontSizeStyle(int style)
     foreach (Atom *atom, atomsList) {
         atom->setFontSizeStyle(Atom::FontSizeStyle(style));
     }
-    update();
+    updateLayout();
 }
 
 double DrawingCanvas::bondLength(Atom *atom1, Atom *atom2)
@@ -205,16 +393,14 @@ void DrawingCanvas::loadFromParser()
     }
 
     Molecule *molecule = parser->molecule();
-    std::vector<AtomEntry *> atoms = molecule->atomsList();
-    int nAtoms = atoms.size();
+    int nAtoms = molecule->numAtoms();
     // First add the Atoms
     for (int i = 0; i < nAtoms; ++i) {
-        Atom *atom = new Atom(atoms[i]->Label, drawingInfo);
-        atom->setX(atoms[i]->x);
-        atom->setY(atoms[i]->y);
-        atom->setZ(atoms[i]->z);
+        Atom *atom = new Atom(molecule->label(i), drawingInfo);
+        atom->setX(molecule->x(i));
+        atom->setY(molecule->y(i));
+        atom->setZ(molecule->z(i));
         atom->setID(i + 1);
-        addItem(atom);
         atomsList.push_back(atom);
     }
 
@@ -224,40 +410,47 @@ void DrawingCanvas::loadFromParser()
     // Having determined the size and scale factor, update the radii and label sizes
     drawingInfo->setAtomLabelFont(DEFAULT_ATOM_LABEL_FONT);
     foreach (Atom *atom, atomsList) {
-        atom->computeRadius();
         atom->setLabelFontSize(DEFAULT_ATOM_LABEL_FONT_SIZE);
+        atom->updateGeometry();
     }
 
     // Now add the Bonds
     double cutoffScale = 1.2;
-    for (int atom1 = 0; atom1 < nAtoms; ++atom1) {
-        for (int atom2 = 0; atom2 < atom1; ++atom2) {
-            if (bondLength(atomsList[atom1], atomsList[atom2]) <
-                (atomsList[atom1]->radius() + atomsList[atom2]->radius()) * cutoffScale) {
-                Bond *bond = new Bond(atomsList[atom1], atomsList[atom2], drawingInfo);
-                addItem(bond);
-                bondsList.push_back(bond);
-            }
-        }
+    QVector<double> radii(nAtoms);
+    for (int i = 0; i < nAtoms; ++i) {
+        radii[i] = atomsList[i]->radius();
+    }
+    QVector<BondPerception::AtomPair> bondedAtoms =
+        BondPerception::findBonds(nAtoms, molecule->xData(), molecule->yData(), molecule->zData(),
+                                  radii.constData(), cutoffScale);
+    foreach (const BondPerception::AtomPair &pair, bondedAtoms) {
+        Bond *bond = new Bond(atomsList[pair.first], atomsList[pair.second], drawingInfo);
+        addBond(bond);
     }
+    showMolecule();
     refresh();
 }
 
-void DrawingCanvas::rotateFromInitialCoordinates()
+void DrawingCanvas::showMolecule()
 {
-    // This function just updates the coordinates back to the input orientation
-    // before rotating by the angles stored in drawinginfo
-    Molecule *molecule = parser->molecule();
-    std::vector<AtomEntry *> atoms = molecule->atomsList();
-    int nAtoms = atoms.size();
-    // Restore the input orientation
-    for (int i = 0; i < nAtoms; ++i) {
-        atomsList[i]->setX(atoms[i]->x);
-        atomsList[i]->setY(atoms[i]->y);
-        atomsList[i]->setZ(atoms[i]->z);
+    if (atomsList.size() > BATCHED_RENDERING_ATOMS) {
+        myMoleculeItem = new MoleculeItem(atomsList, bondsList);
+        addItem(myMoleculeItem);
+        return;
     }
-    // Once we've found the center of mass, we know the molecule extents
-    translateToCenterOfMass();
+    foreach (Atom *atom, atomsList) {
+        addItem(atom);
+    }
+    foreach (Bond *bond, bondsList) {
+        addItem(bond);
+    }
+}
+
+void DrawingCanvas::rotateFromInitialCoordinates()
+{
+    // The coordinates are never rotated, so getting back to the input orientation is just a matter
+    // of forgetting the view's rotation, before the angles stored in drawinginfo are applied
+    drawingInfo->resetOrientation();
     refresh();
 }
 
@@ -299,43 +492,44 @@ void DrawingCanvas::determineRotationAngles()
     }
 
     Molecule *molecule = parser->molecule();
-    std::vector<AtomEntry *> oldGeom = molecule->atomsList();
     QList<Atom *> newGeom = atomsList;
+    int nAtoms = molecule->numAtoms();
 
-    if (oldGeom.size() < 1) {
+    if (nAtoms < 1) {
         return;
     }
 
+    const double *oldX = molecule->xData();
+    const double *oldY = molecule->yData();
+    const double *oldZ = molecule->zData();
     double old_x = 0, old_y = 0, old_z = 0, new_x = 0, new_y = 0, new_z = 0;
-    for (unsigned int i = 0; i < oldGeom.size(); i++) {
-        old_x += oldGeom[i]->x;
-        old_y += oldGeom[i]->y;
-        old_z += oldGeom[i]->z;
+    for (int i = 0; i < nAtoms; i++) {
+        old_x += oldX[i];
+        old_y += oldY[i];
+        old_z += oldZ[i];
     }
     for (int i = 0; i < newGeom.size(); i++) {
         new_x += newGeom[i]->x();
         new_y += newGeom[i]->y();
         new_z += newGeom[i]->z();
     }
-    old_x /= oldGeom.size();
-    old_y /= oldGeom.size();
-    old_z /= oldGeom.size();
+    old_x /= nAtoms;
+    old_y /= nAtoms;
+    old_z /= nAtoms;
     new_x /= newGeom.size();
     new_y /= newGeom.size();
     new_z /= newGeom.size();
 
-    std::vector<AtomEntry *> oldTransformed;
-    std::vector<AtomEntry *> newTransformed;
+    std::vector<double> oldTransformedX(nAtoms), oldTransformedY(nAtoms), oldTransformedZ(nAtoms);
+    std::vector<double> newTransformedX(nAtoms), newTransformedY(nAtoms), newTransformedZ(nAtoms);
 
-    for (unsigned int i = 0; i < oldGeom.size(); i++) {
-        oldTransformed.push_back(new AtomEntry);
-        newTransformed.push_back(new AtomEntry);
-        oldTransformed[i]->x = oldGeom[i]->x - old_x;
-        oldTransformed[i]->y = oldGeom[i]->y - old_y;
-        oldTransformed[i]->z = oldGeom[i]->z - old_z;
-        newTransformed[i]->x = newGeom[i]->x() - new_x;
-        newTransformed[i]->y = newGeom[i]->y() - new_y;
-        newTransformed[i]->z = newGeom[i]->z() - new_z;
+    for (int i = 0; i < nAtoms; i++) {
+        oldTransformedX[i] = oldX[i] - old_x;
+        oldTransformedY[i] = oldY[i] - old_y;
+        oldTransformedZ[i] = oldZ[i] - old_z;
+        newTransformedX[i] = newGeom[i]->x() - new_x;
+        newTransformedY[i] = newGeom[i]->y() - new_y;
+        newTransformedZ[i] = newGeom[i]->z() - new_z;
     }
 
     int m = 3;
@@ -345,18 +539,18 @@ void DrawingCanvas::determineRotationAngles()
     double *vt = new double[ldvt * n];
     // Create correlation matrix with weighted coordinates
     for (int i = 0; i < newGeom.size(); i++) {
-        a[0] += oldTransformed[i]->x * newTransformed[i]->x;
-        a[1] += oldTransformed[i]->y * newTransformed[i]->x;
-        a[2] += oldTransformed[i]->z * newTransformed[i]->x;
-        a[3] += oldTransformed[i]->x * newTransformed[i]->y;
-        a[4] += oldTransformed[i]->y * newTransformed[i]->y;
-        a[5] += oldTransformed[i]->z * newTransformed[i]->y;
-        a[6] += oldTransformed[i]->x * newTransformed[i]->z;
-        a[7] += oldTransformed[i]->y * newTransformed[i]->z;
-        a[8] += oldTransformed[i]->z * newTransformed[i]->z;
+        a[0] += oldTransformedX[i] * newTransformedX[i];
+        a[1] += oldTransformedY[i] * newTransformedX[i];
+        a[2] += oldTransformedZ[i] * newTransformedX[i];
+        a[3] += oldTransformedX[i] * newTransformedY[i];
+        a[4] += oldTransformedY[i] * newTransformedY[i];
+        a[5] += oldTransformedZ[i] * newTransformedY[i];
+        a[6] += oldTransformedX[i] * newTransformedZ[i];
+        a[7] += oldTransformedY[i] * newTransformedZ[i];
+        a[8] += oldTransformedZ[i] * newTransformedZ[i];
     }
     for (int i = 0; i < 9; i++)
-        a[i] /= oldGeom.size();
+        a[i] /= nAtoms;
 
     double **rotationMatrix = new double *[3];
     for (int i = 0; i < 3; i++)
@@ -645,10 +839,61 @@ double DrawingCanvas::pythag(double a, double b)
     }
 }
 
+void DrawingCanvas::updateAtoms()
+{
+    // The bonds and angles are placed using the atoms' radii, so this has to come first
+    foreach (Atom *atom, atomsList) {
+        atom->updateGeometry();
+    }
+    // Now everything the bonds and angles need is collected into flat arrays, for
+    // updateBonds() and updateAngles() to work through
+    int nAtoms = atomsList.size();
+    myAtomGeometry.resize(4 * nAtoms);
+    double *x = myAtomGeometry.data();
+    double *y = x + nAtoms;
+    double *z = y + nAtoms;
+    double *radii = z + nAtoms;
+    for (int i = 0; i < nAtoms; ++i) {
+        Atom *atom = atomsList[i];
+        QPointF pos = atom->pos();
+        x[i] = pos.x();
+        y[i] = pos.y();
+        z[i] = atom->zValue();
+        radii[i] = atom->effectiveRadius();
+    }
+}
+
+int DrawingCanvas::atomIndex(Atom *atom) const
+{
+    // The IDs count from one in the order the atoms were read in, which is the list's order
+    int index = atom->ID() - 1;
+    if (index >= 0 && index < atomsList.size() && atomsList[index] == atom) {
+        return index;
+    }
+    return atomsList.indexOf(atom);
+}
+
 void DrawingCanvas::updateBonds()
 {
-    foreach (Bond *bond, bondsList) {
-        bond->updatePosition();
+    // Assumes updateAtoms() has just gathered up the atoms
+    int nAtoms = atomsList.size();
+    int nBonds = bondsList.size();
+    const double *x = myAtomGeometry.constData();
+    QVector<int> atom1(nBonds);
+    QVector<int> atom2(nBonds);
+    QVector<double> lengths(nBonds);
+    double scale = drawingInfo->scaleFactor();
+    for (int i = 0; i < nBonds; ++i) {
+        Bond *bond = bondsList[i];
+        atom1[i] = atomIndex(bond->startAtom());
+        atom2[i] = atomIndex(bond->endAtom());
+        lengths[i] = scale * bond->length();
+    }
+    myBondPlacements.resize(nBonds);
+    BondGeometry::placeBonds(nBonds, atom1.constData(), atom2.constData(), lengths.constData(), x,
+                             x + nAtoms, x + 2 * nAtoms, x + 3 * nAtoms, myBondPlacements.data());
+    for (int i = 0; i < nBonds; ++i) {
+        bondsList[i]->setPlacement(myBondPlacements[i]);
     }
 }
 
@@ -661,8 +906,26 @@ void DrawingCanvas::updateTextLabels()
 
 void DrawingCanvas::updateAngles()
 {
-    foreach (Angle *angle, anglesList) {
-        angle->updatePosition();
+    // Assumes updateAtoms() has just gathered up the atoms
+    int nAtoms = atomsList.size();
+    int nAngles = anglesList.size();
+    const double *x = myAtomGeometry.constData();
+    QVector<int> start(nAngles);
+    QVector<int> center(nAngles);
+    QVector<int> end(nAngles);
+    for (int i = 0; i < nAngles; ++i) {
+        Angle *angle = anglesList[i];
+        start[i] = atomIndex(angle->startAtom());
+        center[i] = atomIndex(angle->centerAtom());
+        end[i] = atomIndex(angle->endAtom());
+    }
+    myAnglePlacements.resize(nAngles);
+    BondGeometry::placeAngles(nAngles, start.constData(), center.constData(), end.constData(), x,
+                              x + nAtoms, x + 2 * nAtoms, x + 3 * nAtoms,
+                              ANGLE_MARKER_DISTANCE * drawingInfo->scaleFactor(),
+                              myAnglePlacements.data());
+    for (int i = 0; i < nAngles; ++i) {
+        anglesList[i]->setPlacement(myAnglePlacements[i]);
     }
 }
 
@@ -681,7 +944,7 @@ void DrawingCanvas::setMode(Mode mode)
 void DrawingCanvas::atomLabelFontChanged(const QFont &font)
 {
     drawingInfo->setAtomLabelFont(font.family());
-    update();
+    updateLayout();
 }
 
 void DrawingCanvas::toggleAtomNumberSubscripts()
@@ -706,7 +969,7 @@ void DrawingCanvas::toggleAtomNumberSubscripts()
             }
         }
     }
-    update();
+    updateLayout();
 }
 
 void DrawingCanvas::atomLabelFontSizeChanged(const QString &size)
@@ -716,7 +979,7 @@ void DrawingCanvas::atomLabelFontSizeChanged(const QString &size)
             atom->setLabelFontSize(size.toInt());
         }
     }
-    update();
+    updateLayout();
 }
 
 void DrawingCanvas::translateToCenterOfMass()
@@ -749,81 +1012,152 @@ void DrawingCanvas::translateToCenterOfMass()
     }
     drawingInfo->setMoleculeMaxDimension(rMax + EXTRA_DRAWING_SPACE);
     drawingInfo->determineScaleFactor();
+    gatherCoordinates();
 }
 
-bool DrawingCanvas::isBonded(Atom *atom1, Atom *atom2)
+void DrawingCanvas::addBond(Bond *bond)
 {
-    foreach (Bond *bond, bondsList) {
-        if ((bond->startAtom() == atom1 && bond->endAtom() == atom2) ||
-            (bond->startAtom() == atom2 && bond->endAtom() == atom1)) {
-            return true;
+    bondsList.push_back(bond);
+    indexBond(bond);
+}
+
+void DrawingCanvas::indexBond(Bond *bond)
+{
+    Atom *atom1 = bond->startAtom();
+    Atom *atom2 = bond->endAtom();
+    AtomPair key = bondKey(atom1, atom2);
+    // A pair of atoms may be joined by more than one bond, but they're only neighbours once
+    if (!myBondIndex.contains(key)) {
+        myNeighbours[atom1].append(atom2);
+        myNeighbours[atom2].append(atom1);
+    }
+    myBondIndex.insert(key, bond);
+}
+
+void DrawingCanvas::unindexBond(Bond *bond)
+{
+    Atom *atom1 = bond->startAtom();
+    Atom *atom2 = bond->endAtom();
+    AtomPair key = bondKey(atom1, atom2);
+    if (myBondIndex.remove(key, bond) && !myBondIndex.contains(key)) {
+        myNeighbours[atom1].removeOne(atom2);
+        myNeighbours[atom2].removeOne(atom1);
+    }
+}
+
+void DrawingCanvas::removeItems(const QList<QGraphicsItem *> &items)
+{
+    QList<QGraphicsItem *> drawn;
+    foreach (QGraphicsItem *item, items) {
+        if (item->type() == Bond::Type) {
+            unindexBond(qgraphicsitem_cast<Bond *>(item));
+        }
+        if (item->scene() == this) {
+            removeItem(item);
+        } else {
+            drawn.append(item);
         }
     }
-    return false;
+    if (myMoleculeItem != 0 && !drawn.isEmpty()) {
+        myMoleculeItem->removeItems(drawn);
+    }
 }
 
-QList<Angle *>::iterator DrawingCanvas::angleExists(Atom *atom1, Atom *atom2, Atom *atom3)
+void DrawingCanvas::restoreItems(const QList<QGraphicsItem *> &items)
 {
-    QList<Angle *>::iterator pos;
-    for (pos = anglesList.begin(); pos != anglesList.end(); ++pos) {
-        Angle *angle = *pos;
-        if ((angle->startAtom() == atom1 && angle->centerAtom() == atom2 &&
-             angle->endAtom() == atom3) ||
-            (angle->startAtom() == atom3 && angle->centerAtom() == atom2 &&
-             angle->endAtom() == atom1)) {
-            return pos;
+    QList<QGraphicsItem *> drawn;
+    foreach (QGraphicsItem *item, items) {
+        if (item->type() == Bond::Type) {
+            indexBond(qgraphicsitem_cast<Bond *>(item));
+        }
+        if (myMoleculeItem != 0 && (item->type() == Atom::Type || item->type() == Bond::Type)) {
+            drawn.append(item);
+        } else {
+            addItem(item);
         }
     }
-    pos = anglesList.end();
-    // Checking the bounds on the iterator later will reveal whether the angle exists in the list,
-    // as long as we return an iterator beyond the end of the list
-    return ++pos;
+    if (myMoleculeItem != 0 && !drawn.isEmpty()) {
+        myMoleculeItem->addItems(drawn);
+    }
+}
+
+void DrawingCanvas::addAngle(Angle *angle)
+{
+    anglesList.push_back(angle);
+    myAngleIndex.insert(angleKey(angle->startAtom(), angle->centerAtom(), angle->endAtom()), angle);
+}
+
+bool DrawingCanvas::isBonded(Atom *atom1, Atom *atom2)
+{
+    return myBondIndex.contains(bondKey(atom1, atom2));
+}
+
+// Returns the angle atom1-atom2-atom3 (or atom3-atom2-atom1), or null if there isn't one
+Angle *DrawingCanvas::angleExists(Atom *atom1, Atom *atom2, Atom *atom3)
+{
+    return myAngleIndex.value(angleKey(atom1, atom2, atom3), 0);
 }
 
 void DrawingCanvas::toggleAngleLabels()
 {
-    // This is quite cumbersome, which stems from my reluctance to use numbers to label the atoms
-    // so I can begin removing and inserting atoms more easily should I chose to in the future...
-    for (int a1 = 0; a1 < atomsList.size(); ++a1) {
-        Atom *atom1 = atomsList[a1];
-        if (!atom1->isSelected()) {
+    // Only atoms bonded to a selected center atom can form an angle with it, so the neighbour
+    // lists give the candidates directly.  The end atoms are paired up in their order in
+    // atomsList, which is how the angles have always been defined.
+    QHash<Atom *, int> selectedAtoms;
+    for (int a = 0; a < atomsList.size(); ++a) {
+        if (atomsList[a]->isSelected()) {
+            selectedAtoms.insert(atomsList[a], a);
+        }
+    }
+    QSet<Angle *> removedAngles;
+    for (int a2 = 0; a2 < atomsList.size(); ++a2) {
+        Atom *atom2 = atomsList[a2];
+        if (!atom2->isSelected()) {
             continue;
         }
-        for (int a2 = 0; a2 < atomsList.size(); ++a2) {
-            Atom *atom2 = atomsList[a2];
-            if (!atom2->isSelected()) {
-                continue;
+        QMap<int, Atom *> ends;
+        foreach (Atom *neighbour, myNeighbours.value(atom2)) {
+            QHash<Atom *, int>::const_iterator a = selectedAtoms.constFind(neighbour);
+            if (a != selectedAtoms.constEnd()) {
+                ends.insert(a.value(), neighbour);
             }
-            for (int a3 = 0; a3 != a1; ++a3) {
-                Atom *atom3 = atomsList[a3];
-                if (!atom3->isSelected()) {
-                    continue;
-                }
-                if (a1 == a2 || a2 == a3) {
-                    continue;
-                }
-                if (isBonded(atom1, atom2) && isBonded(atom2, atom3)) {
-                    QList<Angle *>::iterator anglePos = angleExists(atom1, atom2, atom3);
-                    if (anglePos <= anglesList.end()) {
-                        // Remove angle
-                        Angle *angle = *anglePos;
-                        removeItem(angle->label());
-                        removeItem(angle->marker1());
-                        removeItem(angle->marker2());
-                        anglesList.erase(anglePos);
-                        delete angle;
-                    } else {
-                        // add angle
-                        Angle *angle = new Angle(atom1, atom2, atom3, drawingInfo);
-                        addItem(angle->label());
-                        addItem(angle->marker1());
-                        addItem(angle->marker2());
-                        anglesList.push_back(angle);
-                    }
+        }
+        QList<Atom *> endAtoms = ends.values();
+        for (int e1 = 0; e1 < endAtoms.size(); ++e1) {
+            Atom *atom1 = endAtoms[e1];
+            for (int e3 = 0; e3 < e1; ++e3) {
+                Atom *atom3 = endAtoms[e3];
+                Angle *angle = angleExists(atom1, atom2, atom3);
+                if (angle) {
+                    // Remove angle
+                    removeItem(angle->label());
+                    removeItem(angle->marker1());
+                    removeItem(angle->marker2());
+                    myAngleIndex.remove(angleKey(atom1, atom2, atom3));
+                    removedAngles.insert(angle);
+                } else {
+                    // add angle
+                    angle = new Angle(atom1, atom2, atom3, drawingInfo);
+                    addItem(angle->label());
+                    addItem(angle->marker1());
+                    addItem(angle->marker2());
+                    addAngle(angle);
                 }
             }
         }
     }
+    if (!removedAngles.isEmpty()) {
+        QList<Angle *> remainingAngles;
+        foreach (Angle *angle, anglesList) {
+            if (!removedAngles.contains(angle)) {
+                remainingAngles.push_back(angle);
+            }
+        }
+        anglesList = remainingAngles;
+        foreach (Angle *angle, removedAngles) {
+            delete angle;
+        }
+    }
 }
 
 void DrawingCanvas::toggleBondDashing()
@@ -834,7 +1168,7 @@ void DrawingCanvas::toggleBondDashing()
             bond->toggleDashing();
         }
     }
-    refresh();
+    updateLayout();
 }
 
 void DrawingCanvas::toggleBondLabels()
@@ -861,56 +1195,62 @@ void DrawingCanvas::addBondLabel(int i)
     }
 }
 
+// Rotates the coordinates and projects them onto the scene.  There are no function calls or
+// branches in the loop, and the arrays can't overlap, so the compiler is free to vectorize it.
+static void rotateAndProject(int n, const double r[3][3], double perspective, double scale,
+                             double dX, double dY, const double *__restrict x,
+                             const double *__restrict y, const double *__restrict z,
+                             double *__restrict posX, double *__restrict posY,
+                             double *__restrict depth)
+{
+    for (int i = 0; i < n; ++i) {
+        double xVal = r[0][0] * x[i] + r[0][1] * y[i] + r[0][2] * z[i];
+        double yVal = r[1][0] * x[i] + r[1][1] * y[i] + r[1][2] * z[i];
+        double zVal = r[2][0] * x[i] + r[2][1] * y[i] + r[2][2] * z[i];
+        double factor = (1.0 + zVal * perspective) * scale;
+        posX[i] = factor * xVal + dX;
+        posY[i] = factor * yVal + dY;
+        depth[i] = zVal;
+    }
+}
+
 void DrawingCanvas::performRotation()
 {
     // Assumes the cartesians are centered at the center of mass
     double zMin = 0.0;
     double zMax = 0.0;
-    //   int nAtoms = atomsList.size(); // unused variable
-
-    double phiX = drawingInfo->xRot() * DEG_TO_RAD;
-    double phiY = drawingInfo->yRot() * DEG_TO_RAD;
-    double phiZ = drawingInfo->zRot() * DEG_TO_RAD;
-
-    double cx = cos(phiX);
-    double sx = sin(phiX);
-    double cy = cos(phiY);
-    double sy = sin(phiY);
-    double cz = cos(phiZ);
-    double sz = sin(phiZ);
-
-    foreach (Atom *atom, atomsList) {
-        double x = atom->x();
-        double y = atom->y();
-        double z = atom->z();
-
-        // RX RY RZ
-        double xVal = (cy * cz * x - cy * sz * y + sy * z);
-        double yVal = (cx * sz * x + cz * (sx * sy * x + cx * y) - sx * (sy * sz * y + cy * z));
-        double zVal =
-            (-(cx * cz * sy * x) + sx * sz * x + cz * sx * y + cx * sy * sz * y + cx * cy * z);
-
-        atom->setX(xVal);
-        atom->setY(yVal);
-        atom->setZ(zVal);
-        drawingInfo->setXRot(0);
-        drawingInfo->setYRot(0);
-        drawingInfo->setZRot(0);
-
-        double perspective = 1.0;
-        if (drawingInfo->getUsePerspective()) {
-            perspective += zVal * drawingInfo->scaleFactor() * drawingInfo->perspective();
-        }
-        atom->setPos(perspective * xVal * drawingInfo->scaleFactor() + drawingInfo->dX(),
-                     perspective * yVal * drawingInfo->scaleFactor() + drawingInfo->dY());
-        atom->setZValue(zVal * drawingInfo->scaleFactor());
-
-        if (atom->z() > zMax) {
-            zMax = atom->z();
-        }
-        if (atom->z() < zMin) {
-            zMin = atom->z();
-        }
+    int nAtoms = atomsList.size();
+
+    // The atoms' coordinates are never touched: the view's orientation is kept separately, and
+    // the screen positions are worked out from scratch each time
+    drawingInfo->applyRotation();
+    double r[3][3];
+    drawingInfo->rotationMatrix(r);
+    double scale = drawingInfo->scaleFactor();
+    double perspective =
+        drawingInfo->getUsePerspective() ? scale * drawingInfo->perspective() : 0.0;
+
+    if (myCoordinates.size() != 3 * nAtoms) {
+        gatherCoordinates();
+    }
+    const double *x = myCoordinates.constData();
+    const double *y = x + nAtoms;
+    const double *z = y + nAtoms;
+    myRotationBuffer.resize(3 * nAtoms);
+    double *posX = myRotationBuffer.data();
+    double *posY = posX + nAtoms;
+    double *depth = posY + nAtoms;
+    rotateAndProject(nAtoms, r, perspective, scale, drawingInfo->dX(), drawingInfo->dY(), x, y, z,
+                     posX, posY, depth);
+    for (int i = 0; i < nAtoms; ++i) {
+        zMax = std::max(zMax, depth[i]);
+        zMin = std::min(zMin, depth[i]);
+    }
+    for (int i = 0; i < nAtoms; ++i) {
+        Atom *atom = atomsList[i];
+        atom->setDepth(depth[i]);
+        atom->setPos(posX[i], posY[i]);
+        atom->setZValue(depth[i] * scale);
     }
     drawingInfo->setMaxZ(zMax);
     drawingInfo->setMinZ(zMin);
@@ -930,14 +1270,85 @@ void DrawingCanvas::performRotation()
     drawingInfo->setMinBondZ(zMin);
 }
 
+void DrawingCanvas::gatherCoordinates()
+{
+    int nAtoms = atomsList.size();
+    myCoordinates.resize(3 * nAtoms);
+    for (int i = 0; i < nAtoms; ++i) {
+        myCoordinates[i] = atomsList[i]->x();
+        myCoordinates[nAtoms + i] = atomsList[i]->y();
+        myCoordinates[2 * nAtoms + i] = atomsList[i]->z();
+    }
+}
+
+void DrawingCanvas::scheduleRefresh()
+{
+    ++myRefreshStats.requests;
+    if (myRefreshTimer->isActive()) {
+        return;
+    }
+    // Leave a frame between refreshes, without holding up the first one after a pause
+    qint64 sinceLast = myFrameClock.isValid() ? myFrameClock.elapsed() : REFRESH_INTERVAL_MS;
+    myRefreshTimer->start(std::max<qint64>(REFRESH_INTERVAL_MS - sinceLast, 0));
+}
+
+void DrawingCanvas::beginInteraction()
+{
+    if (atomsList.size() < drawingInfo->lodAtoms()) {
+        return;
+    }
+    drawingInfo->setLowDetail(true);
+    myDetailTimer->start(drawingInfo->lodIdleMs());
+}
+
+void DrawingCanvas::restoreDetail()
+{
+    myDetailTimer->stop();
+    if (drawingInfo->lowDetail()) {
+        drawingInfo->setLowDetail(false);
+        update();
+    }
+}
+
 void DrawingCanvas::refresh()
 {
+    updateLayout();
+    // After a rotation or a zoom nearly everything has moved, and one big repaint is cheaper than
+    // working out the many small ones
+    update();
+}
+
+void DrawingCanvas::updateLayout()
+{
+    // Anything scheduled is taken care of by this refresh
+    myRefreshTimer->stop();
+    QElapsedTimer timer;
+    timer.start();
+
     performRotation();
+    updateAtoms();
     updateBonds();
     updateAngles();
     updateArrows();
     updateTextLabels();
-    update();
+    if (myMoleculeItem != 0) {
+        myMoleculeItem->updateLayout();
+    }
+
+    double elapsed = timer.nsecsElapsed() / 1.0e6;
+    RefreshStats &stats = myRefreshStats;
+    stats.intervalMs = myFrameClock.isValid() ? myFrameClock.nsecsElapsed() / 1.0e6 : 0.0;
+    stats.lastMs = elapsed;
+    stats.maxMs = std::max(stats.maxMs, elapsed);
+    stats.averageMs = (stats.averageMs * stats.frames + elapsed) / (stats.frames + 1);
+    ++stats.frames;
+    myFrameClock.start();
+    if (myLogRefreshes) {
+        qDebug("Refresh %d of %d requested: %.2fms (average %.2fms, worst %.2fms), %.1fms since "
+               "the last",
+               stats.frames, stats.requests, stats.lastMs, stats.averageMs, stats.maxMs,
+               stats.intervalMs);
+    }
 }
 
 void DrawingCanvas::setBackgroundColor()
@@ -946,7 +1357,7 @@ void DrawingCanvas::setBackgroundColor()
     if (color.isValid()) {
         color.setAlpha(myBackgroundAlpha);
         myBackgroundColor = color;
-        update();
+        setBackgroundBrush(QBrush(myBackgroundColor));
     }
 }
 
@@ -954,7 +1365,7 @@ void DrawingCanvas::setBackgroundOpacity(int val)
 {
     myBackgroundAlpha = (int)(255 * val / 100);
     myBackgroundColor.setAlpha(myBackgroundAlpha);
-    update();
+    setBackgroundBrush(QBrush(myBackgroundColor));
 }
 
 void DrawingCanvas::setAtomColors()
@@ -973,6 +1384,10 @@ void DrawingCanvas::setAtomColors()
             foreach (Atom *atom, atomsList) {
                 if (atom->isSelected()) {
                     atom->setColor(color);
+                    // The molecule item's atoms aren't in the scene to repaint themselves
+                    if (myMoleculeItem != 0) {
+                        myMoleculeItem->updateItem(atom);
+                    }
                 }
             }
         }
@@ -993,7 +1408,11 @@ void DrawingCanvas::serialize(QXmlStreamWriter *writer)
     // count
     // This should be updated and fixed before release for efficiency.
     int visibleItems = 0;
-    QList<QGraphicsItem *> itemsList = items();
+    QSet<QGraphicsItem *> itemsList = items().toSet();
+    // The molecule item's atoms and bonds aren't in the scene themselves
+    if (myMoleculeItem != 0) {
+        itemsList += myMoleculeItem->drawOrder().toSet();
+    }
     foreach (Atom *a, atomsList)
         if (itemsList.contains(a)) {
             visibleItems++;
@@ -1041,20 +1460,19 @@ DrawingCanvas::deserialize(QXmlStreamReader *reader, DrawingInfo *drawingInfo, F
     canvas->myBackgroundColor =
         QColor(color[0].toInt(), color[1].toInt(), color[2].toInt(), color[3].toInt());
     canvas->myBackgroundAlpha = color[3].toInt();
+    canvas->setBackgroundBrush(QBrush(canvas->myBackgroundColor));
     int items = reader->attributes().value("items").toString().toInt();
     for (int i = 0; i < items; i++) {
         reader->readNextStartElement();
         if (reader->name() == "Atom") {
             Atom *a = Atom::deserialize(reader, drawingInfo);
-            canvas->addItem(a);
             canvas->atomsList.push_back(a);
         } else if (reader->name() == "Bond") {
             Bond *b = Bond::deserialize(reader, drawingInfo, canvas->atomsList);
-            canvas->addItem(b);
             if (b->hasLabel()) {
                 canvas->addItem(b->label());
             }
-            canvas->bondsList.push_back(b);
+            canvas->addBond(b);
         } else if (reader->name() == "Label") {
             Label *l = Label::deserialize(reader, drawingInfo, canvas);
             canvas->textLabelsList.push_back(l);
@@ -1062,7 +1480,7 @@ DrawingCanvas::deserialize(QXmlStreamReader *reader, DrawingInfo *drawingInfo, F
             Angle *a = Angle::deserialize(reader, drawingInfo, canvas->atomsList, canvas);
             canvas->addItem(a->marker1());
             canvas->addItem(a->marker2());
-            canvas->anglesList.push_back(a);
+            canvas->addAngle(a);
         } else if (reader->name() == "Arrow") {
             Arrow *a = Arrow::deserialize(reader, drawingInfo);
             canvas->addItem(a);
@@ -1073,5 +1491,6 @@ DrawingCanvas::deserialize(QXmlStreamReader *reader, DrawingInfo *drawingInfo, F
         reader->skipCurrentElement();
     }
     reader->skipCurrentElement();
+    canvas->showMolecule();
     return canvas;
 }
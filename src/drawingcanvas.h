@@ -1,10 +1,14 @@
 #ifndef DrawingCanvas_H
 #define DrawingCanvas_H
 
+#include <QElapsedTimer>
 #include <QGraphicsScene>
+#include <QHash>
 #include <QList>
 #include <QMenu>
 #include <QMessageBox>
+#include <QPair>
+#include <QTimer>
 #include <QXmlStreamReader>
 #include <QXmlStreamWriter>
 #include <QtGui>
@@ -13,10 +17,13 @@
 #include "arrow.h"
 #include "atom.h"
 #include "bond.h"
+#include "bondgeometry.h"
+#include "bondperception.h"
 #include "defines.h"
 #include "drawinginfo.h"
 #include "fileparser.h"
 #include "molecule.h"
+#include "moleculeitem.h"
 #include <math.h>
 
 class Angle;
@@ -51,9 +58,33 @@ class DrawingCanvas : public QGraphicsScene
     void clearAll();
     void storeLabeledBonds();
     void restoreLabeledBonds();
+    // The indices of the bonds that are showing their lengths
+    QList<int> labeledBonds() const;
+    // The changes made to the atoms and bonds, for carrying over to the other steps of a
+    // trajectory, whose atoms come in the same order
+    struct AtomStyle {
+        QString symbol;
+        QString label;
+        QColor color;
+        double scaleFactor;
+        int fontSize;
+        Atom::FontSizeStyle fontSizeStyle;
+    };
+    struct BondStyle {
+        double thickness;
+        bool dashed;
+    };
+    struct ItemStyles {
+        QVector<AtomStyle> atoms;
+        // Only the bonds that have been changed, by the ids of the atoms at either end
+        QHash<QPair<int, int>, BondStyle> bonds;
+    };
+    ItemStyles itemStyles() const;
+    void applyItemStyles(const ItemStyles &styles);
     void performRotation();
     void updateBonds();
     void updateAngles();
+    void updateAtoms();
     void updateArrows();
     void updateTextLabels();
     void setAcceptsHovers(bool arg);
@@ -76,15 +107,40 @@ class DrawingCanvas : public QGraphicsScene
     {
         return atomsList;
     }
+    // The selected items, including any atoms and bonds drawn by the molecule item
+    QList<QGraphicsItem *> selection() const;
     void addBondLabel(int i);
     void updateAtomColors(QMap<QString, QVariant> n);
+    // Keep the adjacency index in step with bonds leaving and rejoining the scene
+    void indexBond(Bond *bond);
+    void unindexBond(Bond *bond);
+    // Deletes items, and brings them back again, whether they're in the scene or drawn by the
+    // molecule item
+    void removeItems(const QList<QGraphicsItem *> &items);
+    void restoreItems(const QList<QGraphicsItem *> &items);
     int getBackgroundOpacity()
     {
         return myBackgroundAlpha;
     }
 
+    // How the refreshes are keeping up: requests is how many were asked for, frames how many ran
+    struct RefreshStats {
+        int requests;
+        int frames;
+        double lastMs;
+        double averageMs;
+        double maxMs;
+        double intervalMs;
+    };
+    const RefreshStats &refreshStats() const
+    {
+        return myRefreshStats;
+    }
+
   public slots:
     void refresh();
+    // Asks for a refresh at the next frame; any number of requests before then share it
+    void scheduleRefresh();
     void unselectAll();
     void selectAll();
     void setBackgroundOpacity(int val);
@@ -106,13 +162,25 @@ class DrawingCanvas : public QGraphicsScene
         emit updateTextToolbars();
     };
 
+  private slots:
+    void restoreDetail();
+
   protected:
     void determineRotationAngles();
     void mousePressEvent(QGraphicsSceneMouseEvent *mouseEvent);
     void mouseMoveEvent(QGraphicsSceneMouseEvent *mouseEvent);
     void mouseReleaseEvent(QGraphicsSceneMouseEvent *mouseEvent);
     void translateToCenterOfMass();
+    void gatherCoordinates();
     void focusOutEvent(QFocusEvent *event);
+    void showMolecule();
+    int atomIndex(Atom *atom) const;
+    // Redoes the positions and sizes like refresh(), but leaves the items to repaint themselves
+    // if they changed
+    void updateLayout();
+    void beginInteraction();
+    Atom *atomAt(const QPointF &pos);
+    QGraphicsItem *pickItem(const QPointF &pos);
 
   signals:
     void xRotChanged(int phi);
@@ -122,13 +190,36 @@ class DrawingCanvas : public QGraphicsScene
     void updateTextToolbars();
 
   private:
+    typedef QPair<Atom *, Atom *> AtomPair;
+    // An angle's center atom, then its two end atoms in order of address
+    typedef QPair<Atom *, AtomPair> AtomTriple;
+
+    static AtomPair bondKey(Atom *atom1, Atom *atom2)
+    {
+        return atom1 < atom2 ? AtomPair(atom1, atom2) : AtomPair(atom2, atom1);
+    }
+    static AtomTriple angleKey(Atom *atom1, Atom *atom2, Atom *atom3)
+    {
+        return AtomTriple(atom2, bondKey(atom1, atom3));
+    }
+
     double bondLength(Atom *atom1, Atom *atom2);
+    void addBond(Bond *bond);
+    void addAngle(Angle *angle);
     bool isBonded(Atom *atom1, Atom *atom2);
     void svdcmp(double **a, int m, int n, double w[], double **v);
     double pythag(double a, double b);
-    QList<Angle *>::iterator angleExists(Atom *atom1, Atom *atom2, Atom *atom3);
+    Angle *angleExists(Atom *atom1, Atom *atom2, Atom *atom3);
 
     double rotationMatrix[3][3];
+    // The atoms' (unchanging) coordinates, all the x values then the y and then z, and the scratch
+    // space performRotation() projects them into, kept to save reallocating it on every mouse move
+    QVector<double> myCoordinates;
+    QVector<double> myRotationBuffer;
+    // The atoms' screen positions, depths and radii, for placing the bonds and angles
+    QVector<double> myAtomGeometry;
+    QVector<BondGeometry::BondPlacement> myBondPlacements;
+    QVector<BondGeometry::AnglePlacement> myAnglePlacements;
     double xRot;
     double yRot;
     double zRot;
@@ -143,17 +234,32 @@ class DrawingCanvas : public QGraphicsScene
     QPointF mouseOrigin;
     QGraphicsLineItem *bondline;
     QGraphicsRectItem *selectionRectangle;
+    // Draws the atoms and bonds of large molecules, which are then not scene items themselves
+    MoleculeItem *myMoleculeItem;
     QColor myBackgroundColor;
     QCursor myMoveCursor;
     QCursor myRotateCursor;
     int myBackgroundAlpha;
     int numMouseMoves;
+    QTimer *myRefreshTimer;
+    // Puts the full detail back when a drag pauses
+    QTimer *myDetailTimer;
+    // Started at the end of each refresh, to pace the scheduled ones
+    QElapsedTimer myFrameClock;
+    RefreshStats myRefreshStats;
+    // Whether each refresh's timing goes to the debug output
+    bool myLogRefreshes;
     QList<Atom *> atomsList;
     QList<Bond *> bondsList;
     QList<Angle *> anglesList;
     QList<Arrow *> arrowsList;
     QList<Label *> textLabelsList;
     QList<int> persistantBonds;
+    // The adjacency index: each atom's bonded neighbours, and the bonds and angles by the atoms
+    // involved.  Bonds removed from the scene are left out, although they stay in bondsList.
+    QHash<Atom *, QList<Atom *> > myNeighbours;
+    QMultiHash<AtomPair, Bond *> myBondIndex;
+    QHash<AtomTriple, Angle *> myAngleIndex;
 };
 
 #endif
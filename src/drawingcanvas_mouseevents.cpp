@@ -28,13 +28,13 @@ void DrawingCanvas::mousePressEvent(QGraphicsSceneMouseEvent *mouseEvent)
         break;
     case Select:
         // Is there an item under the cursor?
-        if (items(mouseEvent->scenePos()).size()) {
+        if (QGraphicsItem *item = pickItem(mouseEvent->scenePos())) {
             QApplication::setOverrideCursor(myMoveCursor);
-            if (items(mouseEvent->scenePos())[0]->type() == Atom::Type) {
+            if (item->type() == Atom::Type) {
                 setMode(TempMoveAll);
             } else {
                 setMode(TempMove);
-                myTempMoveItem = items(mouseEvent->scenePos())[0];
+                myTempMoveItem = item;
                 // This is essential for getting the double click events
                 QGraphicsScene::mousePressEvent(mouseEvent);
             }
@@ -83,7 +83,7 @@ void DrawingCanvas::mouseMoveEvent(QGraphicsSceneMouseEvent *mouseEvent)
                     mouseOrigin = mouseEvent->scenePos();
                 }
                 ++numMouseMoves;
-                refresh();
+                scheduleRefresh();
             } else if (item->type() == DragBox::Type) {
                 DragBox *dragBox = dynamic_cast<DragBox *>(item);
                 dragBox->setDX(dragBox->dX() + mouseEvent->scenePos().x() - mouseOrigin.x());
@@ -94,7 +94,6 @@ void DrawingCanvas::mouseMoveEvent(QGraphicsSceneMouseEvent *mouseEvent)
                 }
                 ++numMouseMoves;
                 updateArrows();
-                update();
             } else if (item->type() == Arrow::Type) {
                 Arrow *arrow = dynamic_cast<Arrow *>(item);
                 arrow->incDX(mouseEvent->scenePos().x() - mouseOrigin.x());
@@ -105,16 +104,15 @@ void DrawingCanvas::mouseMoveEvent(QGraphicsSceneMouseEvent *mouseEvent)
                 }
                 ++numMouseMoves;
                 updateArrows();
-                update();
             } else if ((myTempMoveItem->flags() & QGraphicsItem::ItemIsMovable)) {
                 myTempMoveItem->setPos(mouseEvent->scenePos());
                 updateArrows();
-                update();
             }
         }
         break;
     case TempMoveAll:
         QGraphicsScene::mouseMoveEvent(mouseEvent);
+        beginInteraction();
         drawingInfo->incDX(mouseEvent->scenePos().x() - mouseOrigin.x());
         drawingInfo->incDY(mouseEvent->scenePos().y() - mouseOrigin.y());
         if (numMouseMoves == 1) {
@@ -122,7 +120,7 @@ void DrawingCanvas::mouseMoveEvent(QGraphicsSceneMouseEvent *mouseEvent)
             mouseOrigin = mouseEvent->scenePos();
         }
         ++numMouseMoves;
-        refresh();
+        scheduleRefresh();
         break;
     case Select:
         if (selectionRectangle != 0) {
@@ -142,15 +140,17 @@ void DrawingCanvas::mouseMoveEvent(QGraphicsSceneMouseEvent *mouseEvent)
         dx = (int)(mouseEvent->scenePos().x() - mouseOrigin.x());
         dy = (int)(mouseEvent->scenePos().y() - mouseOrigin.y());
         dz = dy;
+        // The rotations add up until the next refresh comes round to apply them
         if (mouseEvent->buttons() & Qt::LeftButton) {
+            beginInteraction();
             if (mouseEvent->modifiers() & Qt::ShiftModifier) {
                 if (mouseEvent->scenePos().x() < drawingInfo->midX())
-                    drawingInfo->setZRot(-dz);
+                    drawingInfo->setZRot(drawingInfo->zRot() - dz);
                 else
-                    drawingInfo->setZRot(dz);
+                    drawingInfo->setZRot(drawingInfo->zRot() + dz);
             } else {
-                drawingInfo->setXRot(-dy);
-                drawingInfo->setYRot(dx);
+                drawingInfo->setXRot(drawingInfo->xRot() - dy);
+                drawingInfo->setYRot(drawingInfo->yRot() + dx);
             }
             ++numMouseMoves;
             if (numMouseMoves == 1) {
@@ -158,7 +158,7 @@ void DrawingCanvas::mouseMoveEvent(QGraphicsSceneMouseEvent *mouseEvent)
                 mouseOrigin = mouseEvent->scenePos();
             }
         }
-        refresh();
+        scheduleRefresh();
         break;
     default:;
     }
@@ -166,6 +166,8 @@ void DrawingCanvas::mouseMoveEvent(QGraphicsSceneMouseEvent *mouseEvent)
 
 void DrawingCanvas::mouseReleaseEvent(QGraphicsSceneMouseEvent *mouseEvent)
 {
+    // Whatever was being dragged has stopped, so it's time for the full detail again
+    restoreDetail();
     if (items().size() == 0) {
         unselectAll();
         return;
@@ -173,30 +175,17 @@ void DrawingCanvas::mouseReleaseEvent(QGraphicsSceneMouseEvent *mouseEvent)
     switch (myMode) {
     case AddBond:
         if (bondline != 0 && myMode == AddBond) {
-            QList<QGraphicsItem *>::iterator iter;
-            QList<QGraphicsItem *> startItems = items(bondline->line().p1());
-            QList<QGraphicsItem *> endItems = items(bondline->line().p2());
-            Atom *atom1 = 0;
-            Atom *atom2 = 0;
-            int nstartItems = startItems.size();
-            int nendItems = endItems.size();
-            for (int item = 0; item < nstartItems; ++item) {
-                if (startItems[item]->type() == Atom::Type) {
-                    atom1 = qgraphicsitem_cast<Atom *>(startItems[item]);
-                    break;
-                }
-            }
-            for (int item = 0; item < nendItems; ++item) {
-                if (endItems[item]->type() == Atom::Type) {
-                    atom2 = qgraphicsitem_cast<Atom *>(endItems[item]);
-                    break;
-                }
-            }
+            Atom *atom1 = atomAt(bondline->line().p1());
+            Atom *atom2 = atomAt(bondline->line().p2());
 
             if (atom1 != 0 && atom2 != 0 && atom1 != atom2) {
                 Bond *bond = new Bond(atom1, atom2, drawingInfo);
-                bondsList.push_back(bond);
-                addItem(bond);
+                addBond(bond);
+                if (myMoleculeItem != 0) {
+                    myMoleculeItem->addBond(bond);
+                } else {
+                    addItem(bond);
+                }
             }
             removeItem(bondline);
             delete bondline;
@@ -211,6 +200,18 @@ void DrawingCanvas::mouseReleaseEvent(QGraphicsSceneMouseEvent *mouseEvent)
                     item->setSelected(true);
                 }
             }
+            if (myMoleculeItem != 0) {
+                QRectF rect = selectionRectangle->rect().normalized();
+                foreach (Atom *atom, myMoleculeItem->atomsIn(rect)) {
+                    atom->setSelected(true);
+                    myMoleculeItem->updateItem(atom);
+                }
+                foreach (Bond *bond, myMoleculeItem->bondsIn(rect)) {
+                    bond->setSelected(true);
+                    myMoleculeItem->updateItem(bond);
+                }
+                emit selectionChanged();
+            }
             removeItem(selectionRectangle);
             delete selectionRectangle;
         }
@@ -222,6 +223,11 @@ void DrawingCanvas::mouseReleaseEvent(QGraphicsSceneMouseEvent *mouseEvent)
         // If the mouse didn't move, we just want to to toggle selections
         if (!numMouseMoves) {
             myTempMoveItem->setSelected((myTempMoveItem->isSelected() ? false : true));
+            // Bonds drawn by the molecule item aren't in the scene to repaint or report themselves
+            if (myTempMoveItem->scene() == 0) {
+                emit selectionChanged();
+                myMoleculeItem->updateItem(myTempMoveItem);
+            }
         } else {
         }
         myTempMoveItem = 0;
@@ -231,12 +237,15 @@ void DrawingCanvas::mouseReleaseEvent(QGraphicsSceneMouseEvent *mouseEvent)
         QApplication::restoreOverrideCursor();
         // If the mouse didn't move, we just want to to toggle selections
         if (!numMouseMoves) {
-            QGraphicsItem *item;
-            if (!items(mouseEvent->scenePos()).size()) {
+            QGraphicsItem *item = pickItem(mouseEvent->scenePos());
+            if (item == 0) {
                 return;
             }
-            item = items(mouseEvent->scenePos())[0];
             item->setSelected((item->isSelected() ? false : true));
+            if (item->scene() == 0) {
+                emit selectionChanged();
+                myMoleculeItem->updateItem(item);
+            }
         }
         setMode(Select);
         break;
@@ -11,7 +11,7 @@ void DrawingDisplay::resizeEvent(QResizeEvent *event)
     drawingInfo->setWidth(event->size().width());
     drawingInfo->determineScaleFactor();
     canvas->setSceneRect(0, 0, event->size().width(), event->size().height());
-    canvas->refresh();
+    canvas->scheduleRefresh();
 }
 
 void DrawingDisplay::focusOutEvent(QFocusEvent *event)
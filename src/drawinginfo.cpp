@@ -1,8 +1,10 @@
 #include "drawinginfo.h"
+#include <cmath>
 
 DrawingInfo::DrawingInfo()
     : myXRot(0), myYRot(0), myZRot(0), _useFogging(false), _foggingScale(DEFAULT_FOGGING_SCALE),
       _usePerspective(true), _perspectiveScale(DEFAULT_PERSPECTIVE_SCALE),
+      _lodAtoms(DEFAULT_LOD_ATOMS), _lodIdleMs(DEFAULT_LOD_IDLE_MS), _lowDetail(false),
       myDX((int)(DEFAULT_SCENE_SIZE_X / 2.0)), myDY((int)(DEFAULT_SCENE_SIZE_Y / 2.0)), myUserDX(0),
       myUserDY(0), myMidX((int)(DEFAULT_SCENE_SIZE_X / 2.0)),
       myMidY((int)(DEFAULT_SCENE_SIZE_Y / 2.0)), myWidth((int)(DEFAULT_SCENE_SIZE_X)),
@@ -14,6 +16,7 @@ DrawingInfo::DrawingInfo()
       _atomLabelFont(DEFAULT_ATOM_LABEL_FONT), _atomLineColor(Qt::black), _atomTextColor(Qt::black),
       style(SimpleColored)
 {
+    resetOrientation();
 }
 
 DrawingInfo::~DrawingInfo()
@@ -30,6 +33,108 @@ void DrawingInfo::determineScaleFactor()
     emit scaleFactorChanged();
 }
 
+// Quaternion product a * b, which rotates by b and then by a
+static void multiplyQuaternions(const double a[4], const double b[4], double product[4])
+{
+    product[0] = a[0] * b[0] - a[1] * b[1] - a[2] * b[2] - a[3] * b[3];
+    product[1] = a[0] * b[1] + a[1] * b[0] + a[2] * b[3] - a[3] * b[2];
+    product[2] = a[0] * b[2] - a[1] * b[3] + a[2] * b[0] + a[3] * b[1];
+    product[3] = a[0] * b[3] + a[1] * b[2] - a[2] * b[1] + a[3] * b[0];
+}
+
+void DrawingInfo::applyRotation()
+{
+    if (myXRot == 0 && myYRot == 0 && myZRot == 0) {
+        return;
+    }
+    // The same RX RY RZ order as the Euler angles have always been applied in
+    double hX = 0.5 * myXRot * DEG_TO_RAD;
+    double hY = 0.5 * myYRot * DEG_TO_RAD;
+    double hZ = 0.5 * myZRot * DEG_TO_RAD;
+    double qX[4] = {cos(hX), sin(hX), 0.0, 0.0};
+    double qY[4] = {cos(hY), 0.0, sin(hY), 0.0};
+    double qZ[4] = {cos(hZ), 0.0, 0.0, sin(hZ)};
+    double qXY[4], increment[4], orientation[4];
+    multiplyQuaternions(qX, qY, qXY);
+    multiplyQuaternions(qXY, qZ, increment);
+    multiplyQuaternions(increment, myOrientation, orientation);
+
+    // Renormalizing stops the rounding errors from building up over a long session
+    double norm = sqrt(orientation[0] * orientation[0] + orientation[1] * orientation[1] +
+                       orientation[2] * orientation[2] + orientation[3] * orientation[3]);
+    for (int i = 0; i < 4; ++i) {
+        myOrientation[i] = orientation[i] / norm;
+    }
+    myXRot = myYRot = myZRot = 0;
+}
+
+void DrawingInfo::resetOrientation()
+{
+    myOrientation[0] = 1.0;
+    myOrientation[1] = myOrientation[2] = myOrientation[3] = 0.0;
+}
+
+void DrawingInfo::copySettings(const DrawingInfo *other)
+{
+    _useFogging = other->_useFogging;
+    _foggingScale = other->_foggingScale;
+    _usePerspective = other->_usePerspective;
+    _perspectiveScale = other->_perspectiveScale;
+    _lodAtoms = other->_lodAtoms;
+    _lodIdleMs = other->_lodIdleMs;
+    // The copy is never dragged, so it's always drawn in full
+    _lowDetail = false;
+    myXRot = other->myXRot;
+    myYRot = other->myYRot;
+    myZRot = other->myZRot;
+    for (int i = 0; i < 4; ++i) {
+        myOrientation[i] = other->myOrientation[i];
+    }
+    myDX = other->myDX;
+    myDY = other->myDY;
+    myUserDX = other->myUserDX;
+    myUserDY = other->myUserDY;
+    myMidX = other->myMidX;
+    myMidY = other->myMidY;
+    myWidth = other->myWidth;
+    myHeight = other->myHeight;
+    myUserScaleFactor = other->myUserScaleFactor;
+    myMoleculeMaxDimension = other->myMoleculeMaxDimension;
+    myAngToSceneScale = other->myAngToSceneScale;
+    _maxZ = other->_maxZ;
+    _minZ = other->_minZ;
+    _maxBondZ = other->_maxBondZ;
+    _minBondZ = other->_minBondZ;
+    _anglePenWidth = other->_anglePenWidth;
+    _angleColor = other->_angleColor;
+    _anglePen = other->_anglePen;
+    _anglePrecision = other->_anglePrecision;
+    _bondColor = other->_bondColor;
+    _bondPrecision = other->_bondPrecision;
+    _labelColor = other->_labelColor;
+    _atomLabelFont = other->_atomLabelFont;
+    _atomLineColor = other->_atomLineColor;
+    _atomTextColor = other->_atomTextColor;
+    style = other->style;
+}
+
+void DrawingInfo::rotationMatrix(double r[3][3]) const
+{
+    double w = myOrientation[0];
+    double x = myOrientation[1];
+    double y = myOrientation[2];
+    double z = myOrientation[3];
+    r[0][0] = 1.0 - 2.0 * (y * y + z * z);
+    r[0][1] = 2.0 * (x * y - w * z);
+    r[0][2] = 2.0 * (x * z + w * y);
+    r[1][0] = 2.0 * (x * y + w * z);
+    r[1][1] = 1.0 - 2.0 * (x * x + z * z);
+    r[1][2] = 2.0 * (y * z - w * x);
+    r[2][0] = 2.0 * (x * z - w * y);
+    r[2][1] = 2.0 * (y * z + w * x);
+    r[2][2] = 1.0 - 2.0 * (x * x + y * y);
+}
+
 void DrawingInfo::serialize(QXmlStreamWriter *writer)
 {
     writer->writeStartElement("DrawingInfo");
@@ -51,6 +156,12 @@ void DrawingInfo::serialize(QXmlStreamWriter *writer)
     writer->writeAttribute("fogging", QString("%1").arg(_useFogging));
     writer->writeAttribute("fogScale", QString("%1").arg(_foggingScale));
     writer->writeAttribute("perspective", QString("%1").arg(_usePerspective));
+    writer->writeAttribute("orientation",
+                           QString("%1 %2 %3 %4")
+                               .arg(myOrientation[0], 0, 'g', 17)
+                               .arg(myOrientation[1], 0, 'g', 17)
+                               .arg(myOrientation[2], 0, 'g', 17)
+                               .arg(myOrientation[3], 0, 'g', 17));
     writer->writeAttribute("angleWidth", QString("%1").arg(_anglePenWidth));
     writer->writeAttribute("angleColor",
                            QString("%1 %2 %3 %4")
@@ -116,6 +227,13 @@ DrawingInfo *DrawingInfo::deserialize(QXmlStreamReader *reader)
     d->_useFogging = (attr.value("fogging").toString().toInt() == 1);
     d->_foggingScale = attr.value("fogScale").toString().toInt();
     d->_usePerspective = (attr.value("perspective").toString().toInt() == 1);
+    // Older projects have no orientation, but their atoms were saved already rotated
+    QStringList orientation = attr.value("orientation").toString().split(" ");
+    if (orientation.size() == 4) {
+        for (int i = 0; i < 4; ++i) {
+            d->myOrientation[i] = orientation[i].toDouble();
+        }
+    }
     d->_anglePenWidth = attr.value("anglePenWidth").toString().toInt();
     QString angleColor = attr.value("angleColor").toString();
     d->_anglePrecision = attr.value("anglePrecision").toString().toInt();
@@ -56,6 +56,13 @@ class DrawingInfo : public QObject
     {
         myZRot = val;
     }
+    // Folds the pending X, Y and Z rotations into the view's orientation, and clears them
+    void applyRotation();
+    void resetOrientation();
+    // Takes on all of another view's settings, so that a copy of it can be drawn on another thread
+    void copySettings(const DrawingInfo *other);
+    // The view's orientation as a matrix, to be applied to the atoms' input coordinates
+    void rotationMatrix(double r[3][3]) const;
     void setWidth(double val)
     {
         myWidth = val;
@@ -154,6 +161,20 @@ class DrawingInfo : public QObject
     {
         return _usePerspective;
     }
+    // The level of detail: while dragging, molecules with at least lodAtoms() atoms are drawn
+    // simply, until the mouse is released or has been still for lodIdleMs()
+    int lodAtoms() const
+    {
+        return _lodAtoms;
+    }
+    int lodIdleMs() const
+    {
+        return _lodIdleMs;
+    }
+    bool lowDetail() const
+    {
+        return _lowDetail;
+    }
 
     void setAnglePenWidth(double v)
     {
@@ -261,6 +282,18 @@ class DrawingInfo : public QObject
     {
         _usePerspective = v;
     }
+    void setLodAtoms(int v)
+    {
+        _lodAtoms = v;
+    }
+    void setLodIdleMs(int v)
+    {
+        _lodIdleMs = v;
+    }
+    void setLowDetail(bool v)
+    {
+        _lowDetail = v;
+    }
     void setMinZ(double v)
     {
         _minZ = v;
@@ -283,10 +316,15 @@ class DrawingInfo : public QObject
     int _foggingScale;
     bool _usePerspective;
     int _perspectiveScale;
+    int _lodAtoms;
+    int _lodIdleMs;
+    bool _lowDetail;
     // The rotation about the axes
     int myXRot;
     int myYRot;
     int myZRot;
+    // The orientation of the view, accumulated as a unit quaternion (w, x, y, z)
+    double myOrientation[4];
 
     // The overall translation from the origin of all objects in the scene
     int myDX;
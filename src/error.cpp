@@ -1,7 +1,21 @@
 #include "error.h"
 
+#include <iostream>
+
+// With no one to click on a message box, errors are just printed
+static bool errorsOnConsole = false;
+
+void setErrorsOnConsole(bool onConsole)
+{
+    errorsOnConsole = onConsole;
+}
+
 void error(QString message)
 {
+    if (errorsOnConsole) {
+        std::cerr << message.toStdString() << std::endl;
+        return;
+    }
     QMessageBox msgBox(QMessageBox::Warning,
                        QDialog::tr("QMessageBox::warning()"),
                        QDialog::tr(message.toLatin1()),
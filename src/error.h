@@ -6,5 +6,7 @@
 
 void error(QString message);
 void error(QString message, const char *filename, int line);
+// For running without a display: errors go to stderr instead of a message box
+void setErrorsOnConsole(bool onConsole);
 
 #endif /*ERROR_H_*/
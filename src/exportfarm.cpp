@@ -0,0 +1,145 @@
+#include "exportfarm.h"
+
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <QRegExp>
+#include <QRunnable>
+#include <QThread>
+#include <QThreadPool>
+#include <QVector>
+
+#include "defines.h"
+#include "drawingcanvas.h"
+#include "fileparser.h"
+#include "imagewriter.h"
+
+class ExportTask : public QRunnable
+{
+  public:
+    ExportTask(const ExportFarm::Job &job, const ExportFarm::Options &options,
+               ExportFarm::Result *result)
+        : myJob(job), myOptions(options), myResult(result)
+    {
+    }
+
+    void run()
+    {
+        // Each task has its own slot in the results, so there's nothing to lock
+        *myResult = ExportFarm::render(myJob, myOptions);
+    }
+
+  private:
+    ExportFarm::Job myJob;
+    const ExportFarm::Options &myOptions;
+    ExportFarm::Result *myResult;
+};
+
+ExportFarm::Options::Options()
+    : xRot(0), yRot(0), zRot(0), zoom(100), style(DrawingInfo::SimpleColored), frame(0),
+      useFogging(false), foggingScale(DEFAULT_FOGGING_SCALE), usePerspective(true),
+      size(DEFAULT_SCENE_SIZE_X, DEFAULT_SCENE_SIZE_Y), dotsPerInch(DEFAULT_IMAGE_DPI)
+{
+}
+
+ExportFarm::ExportFarm(const Options &options, int numThreads)
+    : myOptions(options), myNumThreads(numThreads > 0 ? numThreads : QThread::idealThreadCount())
+{
+}
+
+QList<ExportFarm::Result> ExportFarm::run(const QList<Job> &jobs) const
+{
+    QVector<Result> results(jobs.size());
+    if (myNumThreads < 2 || jobs.size() < 2) {
+        for (int i = 0; i < jobs.size(); ++i) {
+            results[i] = render(jobs[i], myOptions);
+        }
+        return results.toList();
+    }
+
+    QThreadPool pool;
+    pool.setMaxThreadCount(myNumThreads);
+    Result *slot = results.data();
+    for (int i = 0; i < jobs.size(); ++i) {
+        pool.start(new ExportTask(jobs[i], myOptions, slot + i));
+    }
+    pool.waitForDone();
+    return results.toList();
+}
+
+ExportFarm::Result ExportFarm::render(const Job &job, const Options &options)
+{
+    Result result;
+    result.input = job.input;
+    result.output = job.output;
+    result.succeeded = false;
+    result.parseMsecs = 0;
+    result.renderMsecs = 0;
+
+    QElapsedTimer timer;
+    timer.start();
+    FileParser parser(job.input);
+    parser.readFile();
+    result.parseMsecs = timer.restart();
+    if (parser.numMolecules() == 0) {
+        result.message = "No coordinates were read";
+        return result;
+    }
+    if (options.frame > parser.numMolecules()) {
+        result.message = QString("There are only %1 geometries").arg(parser.numMolecules());
+        return result;
+    }
+    if (options.frame) {
+        parser.setCurrent(options.frame - 1);
+    }
+
+    // The canvas sizes the molecule to fit the drawing info's dimensions as it loads
+    DrawingInfo info;
+    info.setWidth(options.size.width());
+    info.setHeight(options.size.height());
+    info.setDrawingStyle(options.style);
+    info.setUseFogging(options.useFogging);
+    info.setFoggingScale(options.foggingScale);
+    info.setUsePerspective(options.usePerspective);
+    info.setZoom(options.zoom);
+
+    DrawingCanvas canvas(&info, &parser);
+    canvas.setSceneRect(0, 0, options.size.width(), options.size.height());
+    info.determineScaleFactor();
+    info.setXRot(options.xRot);
+    info.setYRot(options.yRot);
+    info.setZRot(options.zRot);
+    canvas.refresh();
+
+    result.succeeded = ImageWriter::write(&canvas, job.output, options.dotsPerInch);
+    if (!result.succeeded) {
+        if (ImageWriter::determineFileType(job.output) == ImageWriter::Unknown) {
+            result.message =
+                "Unsupported format; the supported ones are png, tiff, svg, pdf and ps";
+        } else {
+            result.message = "Unable to write the image";
+        }
+    }
+    result.renderMsecs = timer.elapsed();
+    return result;
+}
+
+QStringList ExportFarm::expandInputs(const QStringList &patterns)
+{
+    QStringList files;
+    foreach (const QString &pattern, patterns) {
+        if (!pattern.contains(QRegExp("[*?\\[]"))) {
+            files << pattern;
+            continue;
+        }
+        // Only the file name may have wildcards in it
+        QFileInfo info(pattern);
+        QDir dir(info.path());
+        QStringList matches =
+            dir.entryList(QStringList(info.fileName()), QDir::Files | QDir::Readable, QDir::Name);
+        foreach (const QString &match, matches) {
+            files << dir.filePath(match);
+        }
+    }
+    return files;
+}
@@ -0,0 +1,73 @@
+#ifndef EXPORTFARM_H_
+#define EXPORTFARM_H_
+
+#include <QList>
+#include <QSize>
+#include <QString>
+#include <QStringList>
+
+#include "drawinginfo.h"
+
+/*
+ * Renders many coordinate files to images at once, across a thread pool.  Neither the canvas nor
+ * the drawing info can be shared between threads, so each file gets its own pair, built on
+ * whichever thread renders it; the only thing the workers share is the table of atom colors,
+ * which they just read.  Each file is timed, and failures are reported back rather than stopping
+ * the rest.
+ */
+class ExportFarm
+{
+  public:
+    struct Options {
+        Options();
+        int xRot;
+        int yRot;
+        int zRot;
+        int zoom;
+        DrawingInfo::DrawingStyle style;
+        // Counting from one; zero means the last one, as the main window would show
+        int frame;
+        bool useFogging;
+        int foggingScale;
+        bool usePerspective;
+        QSize size;
+        // Only PNGs and TIFFs have a resolution; it scales them up from five times the size above
+        int dotsPerInch;
+    };
+
+    struct Job {
+        QString input;
+        QString output;
+    };
+
+    struct Result {
+        QString input;
+        QString output;
+        bool succeeded;
+        // Why it failed, if it did
+        QString message;
+        qint64 parseMsecs;
+        qint64 renderMsecs;
+    };
+
+    // Zero threads means one for each core
+    ExportFarm(const Options &options, int numThreads = 0);
+
+    int numThreads() const
+    {
+        return myNumThreads;
+    }
+    // The results come back in the same order as the jobs
+    QList<Result> run(const QList<Job> &jobs) const;
+
+    // Renders a single file on the calling thread
+    static Result render(const Job &job, const Options &options);
+    // Replaces any patterns with wildcards by the files they match, in order of name
+    static QStringList expandInputs(const QStringList &patterns);
+
+  protected:
+    Options myOptions;
+    int myNumThreads;
+};
+
+#endif /*EXPORTFARM_H_*/
@@ -2,16 +2,22 @@
 
 using namespace std;
 
-FileParser::FileParser(QString instring) : myUnits(Angstrom), currentGeometry(0)
+FileParser::FileParser(QString instring)
+    : fileType(UNKNOWN), myFileTypeConfidence(0), myUnits(Angstrom), currentGeometry(0),
+      myFinalFrame(false), myMappedFile(0), myFramesCached(false), myIndexComplete(false),
+      myIndexingProgress(0), myCancelRequested(0), myParseErrorFile(0), myParseErrorLine(0),
+      myParseErrorOffset(0)
 {
     if (instring != 0) {
         QDir *dir = new QDir(instring);
         myFileName = dir->absolutePath();
     }
+    myFrameCache.setMaxCost(FRAME_CACHE_ATOMS);
 }
 
 FileParser::~FileParser()
 {
+    clearFrames();
 }
 
 void FileParser::setFileName(const QString name)
@@ -20,148 +26,392 @@ void FileParser::setFileName(const QString name)
     myFileName = dir->absolutePath();
 }
 
-void FileParser::determineFileType()
+/*
+ * The signatures that identify each program's output.  The weights say how sure a match makes
+ * us; the Molpro one in particular is only a guess, as its log files don't produce a header.
+ */
+FormatDetector FileParser::outputDetector()
+{
+    struct Signature {
+        const char *text;
+        int format;
+        int weight;
+    };
+    static const Signature signatures[] = {
+        {"optking", PSI3, 80},
+        {"psi 3", PSI3, 90},
+        {"gamess", GAMESS, 90},
+        {"PROGRAM SYSTEM MOLPRO", MOLPRO, 100},
+        {"Running default procedure", MOLPRO, 50},
+        {"aces2", ACES2, 90},
+        {"cfour", ACES2, 90},
+        {"Northwest Computational Chemistry Package", NWCHEM, 100},
+        {"O   R   C   A", ORCA, 100},
+        {"Q-Chem, Version 3.0", QCHEM3_1, 100},
+        {"Q-Chem, Version 3.1", QCHEM3_1, 100},
+    };
+    FormatDetector detector;
+    for (size_t i = 0; i < sizeof(signatures) / sizeof(signatures[0]); ++i) {
+        detector.addSignature(signatures[i].text, signatures[i].format, signatures[i].weight);
+    }
+    detector.build();
+    return detector;
+}
+
+// Works out which program wrote the file from its name or, failing that, the prefix given
+void FileParser::determineFileType(const QByteArray &prefix)
 {
     if (myFileName.endsWith(".chmvp")) {
         return;
     }
 
     fileType = UNKNOWN;
+    myFileTypeConfidence = 0;
 
     if (myFileName.contains("file11", Qt::CaseInsensitive)) {
         fileType = FILE11;
+        myFileTypeConfidence = 100;
     } else if (myFileName.contains("xyz", Qt::CaseInsensitive)) {
         fileType = XYZ;
+        myFileTypeConfidence = 100;
     } else {
-        // Go through the file and determine which program the output is from.
-        std::string tempS;
-        QString tempString;
-        while (1) {
-            getline(infile, tempS);
-            tempString = tempS.c_str();
-            if (infile.eof()) {
-                break;
-            }
-            if (tempString.contains("optking", Qt::CaseInsensitive) ||
-                tempString.contains("psi 3", Qt::CaseInsensitive)) {
-                fileType = PSI3;
-                break;
-            } else if (tempString.contains("gamess", Qt::CaseInsensitive)) {
-                fileType = GAMESS;
-                break;
-            } else if (tempString.contains("PROGRAM SYSTEM MOLPRO", Qt::CaseInsensitive) ||
-                       tempString.contains("Running default procedure", Qt::CaseInsensitive)) {
-                // The log file doesn't produce a header, so I'll assume that this is always
-                // present..
-                fileType = MOLPRO;
-                break;
-            } else if (tempString.contains("aces2", Qt::CaseInsensitive) ||
-                       tempString.contains("cfour", Qt::CaseInsensitive)) {
-                fileType = ACES2;
-                break;
-            } else if (tempString.contains("Northwest Computational Chemistry Package",
-                                           Qt::CaseInsensitive)) {
-                fileType = NWCHEM;
-                break;
-            } else if (tempString.contains("O   R   C   A", Qt::CaseInsensitive)) {
-                fileType = ORCA;
-                break;
-            } else if (tempString.contains("Q-Chem, Version 3.0", Qt::CaseInsensitive) ||
-                       tempString.contains("Q-Chem, Version 3.1", Qt::CaseInsensitive)) {
-                fileType = QCHEM3_1;
-                break;
-            }
-        }
+        // Go through the start of the file and determine which program the output is from.
+        static const FormatDetector detector = outputDetector();
+        fileType = FileType(detector.detect(prefix.constData(), prefix.constData() + prefix.size(),
+                                            UNKNOWN, &myFileTypeConfidence));
     }
-
-    infile.seekg(ios_base::beg);
+#ifdef QT_DEBUG
+    std::cout << "File type " << fileType << " detected with confidence " << myFileTypeConfidence
+              << std::endl;
+#endif
 }
 
 void FileParser::readFile()
 {
-    if (myFileName.isEmpty() || myFileName.endsWith(".chmvp")) {
+    if (!openFile()) {
         return;
     }
+    indexFrames();
+    showParseError();
+    if (numMolecules()) {
+        currentGeometry = numMolecules() - 1;
+    }
+}
 
-    infile.open(myFileName.toLatin1());
-    if (!infile) {
+bool FileParser::openFile()
+{
+    if (myFileName.isEmpty() || myFileName.endsWith(".chmvp")) {
+        return false;
+    }
+
+    // The current frames are kept until the new file is known to be readable, so a failed open
+    // leaves the last file on display
+    MappedFile *source = new MappedFile(myFileName);
+    if (!source->open()) {
+        delete source;
         QString errorMessage = "Unable to open " + myFileName + " for reading";
         error(errorMessage, __FILE__, __LINE__);
+        return false;
     }
+    // Only the start of the file is examined, so unrecognized files are rejected quickly
+    FileType oldFileType = fileType;
+    int oldConfidence = myFileTypeConfidence;
+    QSettings settings;
+    int prefixKB = settings.value("File Type Detection KB", DEFAULT_FILE_TYPE_DETECTION_KB).toInt();
+    qint64 prefixSize = qMin(qint64(qMax(prefixKB, 1)) * 1024, source->size());
+    determineFileType(QByteArray::fromRawData(source->begin(), int(prefixSize)));
+
+    if (fileType == UNKNOWN) {
+        fileType = oldFileType;
+        myFileTypeConfidence = oldConfidence;
+        delete source;
+        QString errorMessage = "Unknown file type for " + myFileName;
+        error(errorMessage, __FILE__, __LINE__);
+#ifdef QT_DEBUG
+        std::cout << "Unknown file type." << std::endl;
+#endif
+        return false;
+    }
+
+    clearFrames();
+    currentGeometry = 0;
+    myIndexingProgress = 0;
+    myCancelRequested = 0;
+    myParseError.clear();
+    if (openCache()) {
+        delete source;
+        return true;
+    }
+    myMappedFile = source;
+    return true;
+}
 
-    determineFileType();
+void FileParser::clearFrames()
+{
     foreach (Molecule *molecule, myMoleculeList) {
         delete molecule;
     }
     myMoleculeList.clear();
+    myFrameCache.clear();
+    myFramesCached = false;
+    myLabels.clear();
+    mySymbols.store(0);
+    qDeleteAll(mySymbolTables);
+    mySymbolTables.clear();
+    QMutexLocker locker(&myFrameLock);
+    myFrames.clear();
+    locker.unlock();
+    delete myMappedFile;
+    myMappedFile = 0;
+}
 
-    switch (fileType) {
-    case XYZ:
+/*
+ * Finds the frames in the file opened by openFile().  Only the frame boundaries are found here;
+ * the coordinates are read as they're needed, or by writeCache() afterwards.  This may run on a
+ * worker thread, so frames are published as they're found and any problem is kept for
+ * showParseError() to report.
+ */
+void FileParser::indexFrames()
+{
+    myFinalFrame = false;
+    myIndexComplete = false;
+    if (myFramesCached) {
+        // openFile() found every frame in the cache
+        myIndexingProgress = 100;
+        return;
+    }
+    if (canIndexInParallel()) {
+        indexFramesInParallel();
+    } else {
+        TextScanner scanner(myMappedFile->begin(), myMappedFile->end());
+        qint64 size = qMax(myMappedFile->size(), qint64(1));
+        while (!myCancelRequested && findFrame(scanner)) {
+            FrameEntry frame;
+            frame.offset = scanner.position() - myMappedFile->begin();
+            frame.numAtoms = readFrame(scanner, 0);
+            if (frame.numAtoms < 0) {
+                // Keep whatever was read before the bad frame
+                break;
+            }
+            if (frame.numAtoms) {
+                QMutexLocker locker(&myFrameLock);
+                myFrames.append(frame);
+            }
+            myIndexingProgress = int(100 * (scanner.position() - myMappedFile->begin()) / size);
+            if (myFinalFrame) {
+                break;
+            }
+        }
+    }
+    QMutexLocker locker(&myFrameLock);
+    myIndexComplete = !myCancelRequested && myParseError.isEmpty() && !myFrames.isEmpty();
+    locker.unlock();
+    myIndexingProgress = 100;
 #ifdef QT_DEBUG
-        std::cout << "Reading in XYZ." << std::endl;
+    std::cout << "Found " << numMolecules() << " frames in " << myFileName.toStdString()
+              << std::endl;
 #endif
-        readXYZ();
-        break;
+}
+
+// Keeps the problem nearest the start of the file, as that's where the frames stop
+void FileParser::parseError(const TextScanner &scanner, const QString &message, const char *file,
+                            int line)
+{
+    qint64 offset = scanner.lineBegin() - myMappedFile->begin();
+    QMutexLocker locker(&myFrameLock);
+    if (myParseError.isEmpty() || offset < myParseErrorOffset) {
+        myParseError = message;
+        myParseErrorFile = file;
+        myParseErrorLine = line;
+        myParseErrorOffset = offset;
+    }
+}
+
+void FileParser::showParseError()
+{
+    QMutexLocker locker(&myFrameLock);
+    if (myParseError.isEmpty()) {
+        return;
+    }
+    QString message = myParseError;
+    myParseError.clear();
+    locker.unlock();
+    error(message, myParseErrorFile, myParseErrorLine);
+}
+
+Molecule *FileParser::decodeFrame(int frame)
+{
+    QMutexLocker locker(&myFrameLock);
+    qint64 offset = myFrames[frame].offset;
+    int numAtoms = myFrames[frame].numAtoms;
+    locker.unlock();
+
+    if (myFramesCached) {
+        return decodeCachedFrame(offset);
+    }
+    Molecule *molecule = new Molecule(&myLabels);
+    molecule->reserve(numAtoms);
+    TextScanner scanner(myMappedFile->begin() + offset, myMappedFile->end());
+    readFrame(scanner, molecule);
+    return molecule;
+}
+
+int FileParser::numMolecules() const
+{
+    QMutexLocker locker(&myFrameLock);
+    return myFrames.isEmpty() ? myMoleculeList.size() : myFrames.size();
+}
+
+Molecule *FileParser::molecule()
+{
+    if (myMappedFile == 0) {
+        return myMoleculeList[currentGeometry];
+    }
+    Molecule *molecule = myFrameCache.object(currentGeometry);
+    if (molecule == 0) {
+        molecule = decodeFrame(currentGeometry);
+        // A frame bigger than the whole cache still has to be kept while it's on display
+        int cost = qBound(1, molecule->numAtoms(), myFrameCache.maxCost());
+        myFrameCache.insert(currentGeometry, molecule, cost);
+    }
+    return molecule;
+}
+
+FileParser *FileParser::frameParser(int frame)
+{
+    // Decoded afresh rather than through molecule(), which would swap the frame on display about
+    // and could push it out of the frame cache
+    Molecule *decoded = (myMappedFile == 0 ? 0 : decodeFrame(frame));
+    const Molecule *source = (decoded == 0 ? myMoleculeList[frame] : decoded);
+
+    // Everything is copied, labels included, so nothing is shared with this parser
+    FileParser *parser = new FileParser(NULL);
+    parser->myFileName = myFileName;
+    parser->myUnits = myUnits;
+    Molecule *copy = new Molecule(&parser->myLabels);
+    int numAtoms = source->numAtoms();
+    copy->reserve(numAtoms);
+    for (int i = 0; i < numAtoms; ++i) {
+        copy->addAtom(source->label(i), source->x(i), source->y(i), source->z(i));
+    }
+    copy->setComment(source->comment());
+    parser->myMoleculeList.append(copy);
+    delete decoded;
+    return parser;
+}
+
+bool FileParser::findFrame(TextScanner &scanner)
+{
+    switch (fileType) {
+    case XYZ:
+        return findXYZFrame(scanner);
     case FILE11:
-#ifdef QT_DEBUG
-        std::cout << "Reading in File11." << std::endl;
-#endif
-        readFile11();
-        break;
+        return findFile11Frame(scanner);
     case ACES2:
-#ifdef QT_DEBUG
-        std::cout << "Reading in ACES2." << std::endl;
-#endif
-        readACES2();
-        break;
+        return findACES2Frame(scanner);
     case PSI3:
-#ifdef QT_DEBUG
-        std::cout << "Reading in Psi3." << std::endl;
-#endif
-        readPsi3();
-        break;
+        return findPsi3Frame(scanner);
     case ORCA:
-#ifdef QT_DEBUG
-        std::cout << "Reading in ORCA." << std::endl;
-#endif
-        readORCA();
-        break;
+        return findORCAFrame(scanner);
     case NWCHEM:
-#ifdef QT_DEBUG
-        std::cout << "Reading in NWChem." << std::endl;
-#endif
-        readNWChem();
-        break;
+        return findNWChemFrame(scanner);
     case MOLPRO:
-#ifdef QT_DEBUG
-        std::cout << "Reading in Molpro." << std::endl;
-#endif
-        readMolpro();
-        break;
+        return findMolproFrame(scanner);
     case GAMESS:
-        readGamess();
-        break;
-    // case ACES2:
-    //     readACES2();
-    //     break;
+        return findGamessFrame(scanner);
     case QCHEM3_1:
-#ifdef QT_DEBUG
-        std::cout << "Reading in Qchem3.1." << std::endl;
-#endif
-        readQchem31();
-        break;
+        return findQchem31Frame(scanner);
     default:
-        QString errorMessage = "Unknown file type for " + myFileName;
-        error(errorMessage, __FILE__, __LINE__);
-#ifdef QT_DEBUG
-        std::cout << "Unknown file type." << std::endl;
-#endif
-        ;
+        return false;
     }
-    if (myMoleculeList.size()) {
-        currentGeometry = myMoleculeList.size() - 1;
+}
+
+int FileParser::readFrame(TextScanner &scanner, Molecule *molecule)
+{
+    switch (fileType) {
+    case XYZ:
+        return readXYZFrame(scanner, molecule);
+    case FILE11:
+        return readFile11Frame(scanner, molecule);
+    case ACES2:
+        return readACES2Frame(scanner, molecule);
+    case PSI3:
+        return readPsi3Frame(scanner, molecule);
+    case ORCA:
+        return readORCAFrame(scanner, molecule);
+    case NWCHEM:
+        return readNWChemFrame(scanner, molecule);
+    case MOLPRO:
+        return readMolproFrame(scanner, molecule);
+    case GAMESS:
+        return readGamessFrame(scanner, molecule);
+    case QCHEM3_1:
+        return readQchem31Frame(scanner, molecule);
+    default:
+        return -1;
+    }
+}
+
+/*
+ * Returns the id, in myLabels, of the atom symbol in [begin, end).  Trajectories repeat the same
+ * few symbols over and over, so short ones are looked up straight from their bytes without
+ * building a string.  Some programs capitalize everything, so fixCase lowercases the second
+ * character.
+ */
+quint32 FileParser::symbol(const char *begin, const char *end, bool fixCase)
+{
+    int length = end - begin;
+    if (length > 3) {
+        QString label = QString::fromLatin1(begin, length);
+        if (fixCase) {
+            label[1] = label[1].toLower();
+        }
+        return myLabels.id(label);
+    }
+    quint32 key = length;
+    for (int i = 0; i < length; ++i) {
+        char c = begin[i];
+        if (fixCase && i == 1 && c >= 'A' && c <= 'Z') {
+            c += 'a' - 'A';
+        }
+        key |= quint32(static_cast<unsigned char>(c)) << (8 * (i + 1));
+    }
+    const QHash<quint32, quint32> *symbols = mySymbols.loadAcquire();
+    if (symbols) {
+        QHash<quint32, quint32>::const_iterator id = symbols->constFind(key);
+        if (id != symbols->constEnd()) {
+            return id.value();
+        }
     }
-    infile.close();
+
+    // Another thread may have added the symbol in the meantime
+    QMutexLocker locker(&mySymbolLock);
+    symbols = mySymbols.load();
+    if (symbols && symbols->contains(key)) {
+        return symbols->value(key);
+    }
+    char text[3];
+    for (int i = 0; i < length; ++i) {
+        text[i] = static_cast<char>(key >> (8 * (i + 1)));
+    }
+    quint32 id = myLabels.id(QString::fromLatin1(text, length));
+    QHash<quint32, quint32> *grown =
+        (symbols ? new QHash<quint32, quint32>(*symbols) : new QHash<quint32, quint32>);
+    grown->insert(key, id);
+    mySymbolTables.append(grown);
+    mySymbols.storeRelease(grown);
+    return id;
+}
+
+void FileParser::addAtom(Molecule *molecule, quint32 element, double x, double y, double z)
+{
+    molecule->addAtom(element, x, y, z);
+#ifdef QT_DEBUG
+    std::cout << std::setw(5) << molecule->label(molecule->numAtoms() - 1).toStdString() << " "
+              << std::setw(16) << std::setprecision(10) << x << " " << std::setw(16)
+              << std::setprecision(10) << y << " " << std::setw(16) << std::setprecision(10) << z
+              << std::endl;
+#endif
 }
 
 void FileParser::serialize(QXmlStreamWriter *writer)
@@ -169,9 +419,23 @@ void FileParser::serialize(QXmlStreamWriter *writer)
     writer->writeStartElement("FileParser");
     writer->writeAttribute("units", QString("%1").arg(myUnits));
     writer->writeAttribute("step", QString("%1").arg(currentGeometry));
-    writer->writeAttribute("items", QString("%1").arg(myMoleculeList.size()));
-    foreach (Molecule *m, myMoleculeList)
-        m->serialize(writer);
+    int items = numMolecules();
+    writer->writeAttribute("items", QString("%1").arg(items));
+    if (myMappedFile == 0) {
+        foreach (Molecule *m, myMoleculeList)
+            m->serialize(writer);
+    } else {
+        for (int frame = 0; frame < items; ++frame) {
+            Molecule *m = myFrameCache.object(frame);
+            if (m) {
+                m->serialize(writer);
+            } else {
+                m = decodeFrame(frame);
+                m->serialize(writer);
+                delete m;
+            }
+        }
+    }
     writer->writeEndElement();
 }
 
@@ -187,7 +451,7 @@ FileParser *FileParser::deserialize(QXmlStreamReader *reader)
     parser->currentGeometry = reader->attributes().value("step").toString().toInt();
     int size = reader->attributes().value("items").toString().toInt();
     for (int i = 0; i < size; i++)
-        parser->myMoleculeList.append(Molecule::deserialize(reader));
+        parser->myMoleculeList.append(Molecule::deserialize(reader, &parser->myLabels));
     reader->skipCurrentElement();
     return parser;
 }
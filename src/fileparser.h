@@ -1,21 +1,31 @@
 #ifndef FILEPARSER_H_
 #define FILEPARSER_H_
 
+#include <QAtomicInt>
+#include <QAtomicPointer>
+#include <QCache>
 #include <QDir>
+#include <QFile>
+#include <QHash>
+#include <QMutex>
 #include <QRegExp>
+#include <QSettings>
 #include <QString>
+#include <QVector>
 #include <QXmlStreamReader>
 #include <QXmlStreamWriter>
 
-#include <fstream>
-#include <ios>
 #include <limits>
 #include <string>
 #include <vector>
 
 #include "defines.h"
 #include "error.h"
+#include "formatdetector.h"
+#include "mappedfile.h"
 #include "molecule.h"
+#include "periodictable.h"
+#include "textscanner.h"
 
 #ifdef QT_DEBUG
 #include <iomanip>
@@ -31,14 +41,14 @@ class FileParser
     FileParser(QString infile);
     ~FileParser();
 
-    Molecule *molecule()
+    Molecule *molecule();
+    int numMolecules() const;
+    // A new parser holding a copy of just the given frame, which can be used on another thread
+    FileParser *frameParser(int frame);
+    // Every label the frames' atoms have
+    const AtomLabels *labels() const
     {
-        return myMoleculeList[currentGeometry];
-    }
-
-    int numMolecules()
-    {
-        return myMoleculeList.size();
+        return &myLabels;
     }
     int current() const
     {
@@ -53,28 +63,137 @@ class FileParser
         return myFileName;
     }
     void setFileName(const QString name);
+    // How sure openFile() was of the type of file, from 0 to 100
+    int fileTypeConfidence() const
+    {
+        return myFileTypeConfidence;
+    }
     void readFile();
+    // readFile() in two steps, so that indexFrames() can be run on a worker thread
+    bool openFile();
+    void indexFrames();
+    void cancelIndexing()
+    {
+        myCancelRequested = 1;
+    }
+    // Saves the frames that indexFrames() found to a cache, if the file's big enough to need one.
+    // Every frame is decoded for it, so this is for a worker thread to do once the frames are
+    // showing; cancelIndexing() stops it too.
+    void writeCache();
+    // The percentage of the file that indexFrames() has been through
+    int indexingProgress() const
+    {
+        return myIndexingProgress;
+    }
+    void showParseError();
     void serialize(QXmlStreamWriter *writer);
     static FileParser *deserialize(QXmlStreamReader *reader);
 
   protected:
-    void determineFileType();
-    void readXYZ();
-    void readFile11();
-    void readPsi3();
-    void readGamess();
-    void readACES2();
-    void readORCA();
-    void readNWChem();
-    void readQchem31();
-    void readMolpro();
+    // Where a frame starts in the file, and how many atoms it holds
+    struct FrameEntry {
+        qint64 offset;
+        int numAtoms;
+    };
+    static FormatDetector outputDetector();
+    void determineFileType(const QByteArray &prefix);
+    void clearFrames();
+    void parseError(const TextScanner &scanner, const QString &message, const char *file,
+                    int line);
+    Molecule *decodeFrame(int frame);
+    quint32 symbol(const char *begin, const char *end, bool fixCase = false);
+    static void addAtom(Molecule *molecule, quint32 element, double x, double y, double z);
+
+    // A range of bytes in the file that's indexed alongside the others, holding the frames whose
+    // markers start there.  XYZ files have no markers, so a chunk has to find the first header
+    // that frames can be chained on from, which is checked against where the chunk before it
+    // left off once both are done.
+    struct FrameChunk {
+        const char *begin;
+        const char *end;
+        QVector<FrameEntry> frames;
+        // Where the last frame read by this chunk ended; for XYZ files, where the next one starts
+        qint64 lastEnd;
+        // The first XYZ header in the chunk that frames could be chained on from, or -1
+        qint64 firstHeader;
+        // The marker of a frame that ran into the end of the chunk, or -1 if none did
+        qint64 unfinished;
+        bool failed;
+        bool done;
+    };
+    friend class FrameChunkTask;
+
+    bool canIndexInParallel() const;
+    void indexFramesInParallel();
+    void indexChunk(FrameChunk *chunk);
+    void finishChunk(FrameChunk *chunk);
+    const char *findXYZChunkStart(FrameChunk *chunk);
+    void indexXYZChunk(FrameChunk *chunk, const char *start);
+    void publishChunk(FrameChunk *chunk, qint64 &lastEnd);
+
+    QString cacheFileName() const;
+    bool openCache();
+    Molecule *decodeCachedFrame(qint64 offset);
+    static void pruneCaches(const QString &keep);
+
+    // Each format provides a pair of functions.  The first moves the scanner past the marker
+    // that introduces the next frame, returning false if there are no more.  The second reads
+    // the frame that follows, adding its atoms to molecule (if not null) and returning the
+    // number of atoms found, or -1 if the frame is malformed.
+    bool findFrame(TextScanner &scanner);
+    int readFrame(TextScanner &scanner, Molecule *molecule);
+    bool findXYZFrame(TextScanner &scanner);
+    // A quiet read reports nothing if the frame's malformed, as it may not really be a frame
+    int readXYZFrame(TextScanner &scanner, Molecule *molecule, bool quiet = false);
+    bool findFile11Frame(TextScanner &scanner);
+    int readFile11Frame(TextScanner &scanner, Molecule *molecule);
+    bool findPsi3Frame(TextScanner &scanner);
+    int readPsi3Frame(TextScanner &scanner, Molecule *molecule);
+    bool findGamessFrame(TextScanner &scanner);
+    int readGamessFrame(TextScanner &scanner, Molecule *molecule);
+    bool findACES2Frame(TextScanner &scanner);
+    int readACES2Frame(TextScanner &scanner, Molecule *molecule);
+    bool findORCAFrame(TextScanner &scanner);
+    int readORCAFrame(TextScanner &scanner, Molecule *molecule);
+    bool findNWChemFrame(TextScanner &scanner);
+    int readNWChemFrame(TextScanner &scanner, Molecule *molecule);
+    bool findQchem31Frame(TextScanner &scanner);
+    int readQchem31Frame(TextScanner &scanner, Molecule *molecule);
+    bool findMolproFrame(TextScanner &scanner);
+    int readMolproFrame(TextScanner &scanner, Molecule *molecule);
 
-    std::ifstream infile;
     FileType fileType;
+    int myFileTypeConfidence;
     UnitsType myUnits;
     QString myFileName;
     int currentGeometry;
+    // Set by a format that knows the frame it just found is the last one worth reading
+    bool myFinalFrame;
+    // Molecules that came from a project file, rather than being decoded on demand
     QList<Molecule *> myMoleculeList;
+    // The file being read, or its cache if myFramesCached is set
+    MappedFile *myMappedFile;
+    bool myFramesCached;
+    QVector<FrameEntry> myFrames;
+    QCache<int, Molecule> myFrameCache;
+    // The labels shared by every frame, and a shortcut to them from the bytes of short symbols.
+    // Frames are decoded on several threads at once, so the shortcuts are never changed once
+    // they're in use: a new symbol replaces the whole table, and the old ones are kept until
+    // the file is closed.
+    AtomLabels myLabels;
+    QAtomicPointer<const QHash<quint32, quint32> > mySymbols;
+    QList<const QHash<quint32, quint32> *> mySymbolTables;
+    QMutex mySymbolLock;
+    // Whether indexFrames() got through the whole file, and so whether it's worth caching
+    bool myIndexComplete;
+    // Guards the frame list and error message, which are written during indexing
+    mutable QMutex myFrameLock;
+    QAtomicInt myIndexingProgress;
+    QAtomicInt myCancelRequested;
+    QString myParseError;
+    const char *myParseErrorFile;
+    int myParseErrorLine;
+    qint64 myParseErrorOffset;
 };
 
 #endif /*FILEPARSER_H_*/
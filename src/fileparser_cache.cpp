@@ -0,0 +1,296 @@
+#include "fileparser.h"
+
+#include <QCryptographicHash>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QStandardPaths>
+
+#include <algorithm>
+#include <cstring>
+
+/*
+ * The frames of a large file are saved to a cache once it's first been read, so that opening it
+ * again only has to map the cache.  The cache is a flat file, in the machine's own byte order:
+ *
+ *   CacheHeader
+ *   the path of the file it was made from
+ *   each frame's x[numAtoms], y[numAtoms], z[numAtoms], elements[numAtoms] and comment
+ *   the labels the element ids refer to, each a quint16 length followed by the text
+ *   a CacheFrame for each frame
+ *
+ * Every section starts on an 8 byte boundary, so the coordinates can be copied straight out of
+ * the mapped file.  The cache is only used if the size and modification time recorded in it
+ * still match the file, and everything in it is where it should be, down to each atom's label;
+ * otherwise it's rebuilt the next time the file is read.
+ */
+static const char cacheMagic[8] = {'c', 'h', 'M', 'V', 'P', 't', 'r', 'j'};
+static const quint32 cacheVersion = 4;
+static const quint32 cacheByteOrder = 0x01020304;
+
+struct CacheHeader {
+    char magic[8];
+    quint32 version;
+    quint32 byteOrder;
+    quint32 fileType;
+    quint32 pathLength;
+    qint64 sourceSize;
+    qint64 sourceModified;
+    qint64 labelsOffset;
+    qint64 framesOffset;
+    quint32 numLabels;
+    quint32 numFrames;
+};
+
+// Where a frame's atoms were saved in the cache, followed by its comment
+struct CacheFrame {
+    qint64 offset;
+    qint32 numAtoms;
+    qint32 commentLength;
+};
+
+// Each atom takes three coordinates and an element id
+static const qint64 cacheBytesPerAtom = 3 * sizeof(double) + sizeof(quint32);
+
+static void alignCache(QSaveFile &cache)
+{
+    static const char padding[8] = {0};
+    qint64 remainder = cache.pos() % 8;
+    if (remainder) {
+        cache.write(padding, 8 - remainder);
+    }
+}
+
+// The cache lives in the user's cache directory, named after a hash of the file's path
+QString FileParser::cacheFileName() const
+{
+    QByteArray hash = QCryptographicHash::hash(myFileName.toUtf8(), QCryptographicHash::Sha1);
+    return QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/trajectories/" +
+           QString::fromLatin1(hash.toHex()) + ".cache";
+}
+
+/*
+ * Loads the frame list and labels from the cache for myFileName, returning false if there's no
+ * usable cache.  On success the cache, rather than the file, is what myMappedFile maps.
+ */
+bool FileParser::openCache()
+{
+    QFileInfo source(myFileName);
+    if (source.size() < TRAJECTORY_CACHE_SIZE) {
+        return false;
+    }
+    QString cacheName = cacheFileName();
+    if (!QFileInfo(cacheName).isFile()) {
+        return false;
+    }
+    MappedFile *cache = new MappedFile(cacheName);
+    if (!cache->open() || cache->size() < qint64(sizeof(CacheHeader))) {
+        delete cache;
+        return false;
+    }
+
+    const char *data = cache->begin();
+    qint64 size = cache->size();
+    const CacheHeader *header = reinterpret_cast<const CacheHeader *>(data);
+    QByteArray path = myFileName.toUtf8();
+    qint64 pathEnd = sizeof(CacheHeader) + qint64(header->pathLength);
+    qint64 framesEnd = header->framesOffset + qint64(header->numFrames) * sizeof(CacheFrame);
+    bool valid = memcmp(header->magic, cacheMagic, sizeof(cacheMagic)) == 0 &&
+                 header->version == cacheVersion && header->byteOrder == cacheByteOrder &&
+                 header->fileType > UNKNOWN && header->fileType <= MOLPRO &&
+                 header->sourceSize == source.size() &&
+                 header->sourceModified == source.lastModified().toMSecsSinceEpoch() &&
+                 pathEnd <= size && header->pathLength == quint32(path.size()) &&
+                 memcmp(data + sizeof(CacheHeader), path.constData(), path.size()) == 0 &&
+                 header->labelsOffset >= pathEnd && header->labelsOffset <= size &&
+                 header->framesOffset >= header->labelsOffset && header->framesOffset % 8 == 0 &&
+                 framesEnd <= size && header->numLabels > 0;
+
+    // The labels are added in the order they were saved, so the element ids still match
+    const char *label = data + header->labelsOffset;
+    const char *labelsEnd = data + header->framesOffset;
+    for (quint32 i = 0; valid && i < header->numLabels; ++i) {
+        quint16 length;
+        if (labelsEnd - label < qint64(sizeof(length))) {
+            valid = false;
+            break;
+        }
+        memcpy(&length, label, sizeof(length));
+        label += sizeof(length);
+        if (labelsEnd - label < length) {
+            valid = false;
+            break;
+        }
+        myLabels.id(QString::fromUtf8(label, length));
+        label += length;
+    }
+    // A label saved twice would shift the ids of the ones after it
+    valid = valid && quint32(myLabels.size()) == header->numLabels;
+
+    QVector<FrameEntry> frames;
+    frames.reserve(valid ? header->numFrames : 0);
+    const CacheFrame *cacheFrame = reinterpret_cast<const CacheFrame *>(data + header->framesOffset);
+    for (quint32 i = 0; valid && i < header->numFrames; ++i, ++cacheFrame) {
+        if (cacheFrame->numAtoms <= 0 || cacheFrame->commentLength < 0 ||
+            cacheFrame->offset < pathEnd || cacheFrame->offset % 8 != 0 ||
+            cacheFrame->offset + cacheFrame->numAtoms * cacheBytesPerAtom +
+                    cacheFrame->commentLength >
+                header->labelsOffset) {
+            valid = false;
+            break;
+        }
+        // Every atom has to refer to one of the labels, or decoding the frame would read past them
+        const quint32 *elements = reinterpret_cast<const quint32 *>(
+            data + cacheFrame->offset + 3 * cacheFrame->numAtoms * sizeof(double));
+        quint32 maxElement = 0;
+        for (int j = 0; j < cacheFrame->numAtoms; ++j) {
+            maxElement = std::max(maxElement, elements[j]);
+        }
+        if (maxElement >= header->numLabels) {
+            valid = false;
+            break;
+        }
+        FrameEntry frame;
+        frame.offset = reinterpret_cast<const char *>(cacheFrame) - data;
+        frame.numAtoms = cacheFrame->numAtoms;
+        frames.append(frame);
+    }
+
+    if (!valid) {
+#ifdef QT_DEBUG
+        std::cout << "Ignoring the stale cache " << cacheName.toStdString() << std::endl;
+#endif
+        myLabels.clear();
+        delete cache;
+        return false;
+    }
+#ifdef QT_DEBUG
+    std::cout << "Read " << frames.size() << " frames from the cache " << cacheName.toStdString()
+              << std::endl;
+#endif
+    fileType = FileType(header->fileType);
+    myFileTypeConfidence = 100;
+    myMappedFile = cache;
+    myFramesCached = true;
+    QMutexLocker locker(&myFrameLock);
+    myFrames = frames;
+    return true;
+}
+
+// Builds a molecule from the frame whose CacheFrame is at offset in the cache
+Molecule *FileParser::decodeCachedFrame(qint64 offset)
+{
+    const char *data = myMappedFile->begin();
+    const CacheFrame *cacheFrame = reinterpret_cast<const CacheFrame *>(data + offset);
+    int numAtoms = cacheFrame->numAtoms;
+    const double *x = reinterpret_cast<const double *>(data + cacheFrame->offset);
+    const quint32 *elements = reinterpret_cast<const quint32 *>(x + 3 * numAtoms);
+
+    Molecule *molecule = new Molecule(&myLabels);
+    molecule->setAtoms(numAtoms, elements, x, x + numAtoms, x + 2 * numAtoms);
+    molecule->setComment(
+        QString::fromUtf8(reinterpret_cast<const char *>(elements + numAtoms),
+                          cacheFrame->commentLength));
+    return molecule;
+}
+
+/*
+ * Decodes every frame in turn and saves it to the cache, then the labels and the frame table,
+ * and lastly the header.  The viewer may be decoding frames on the GUI thread all the while, but
+ * they only share the labels and symbol tables, which are safe to use from both.
+ */
+void FileParser::writeCache()
+{
+    QFileInfo source(myFileName);
+    if (!myIndexComplete || myFramesCached || myMappedFile == 0 ||
+        source.size() < TRAJECTORY_CACHE_SIZE || source.size() != myMappedFile->size()) {
+        return;
+    }
+    QString cacheName = cacheFileName();
+    if (!QDir().mkpath(QFileInfo(cacheName).absolutePath())) {
+        return;
+    }
+    QSaveFile cache(cacheName);
+    if (!cache.open(QIODevice::WriteOnly)) {
+        return;
+    }
+    // The header's written properly once everything else is
+    CacheHeader header;
+    memset(&header, 0, sizeof(header));
+    cache.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    cache.write(myFileName.toUtf8());
+    alignCache(cache);
+
+    int numFrames = numMolecules();
+    QVector<CacheFrame> frames;
+    frames.reserve(numFrames);
+    for (int i = 0; i < numFrames; ++i) {
+        if (myCancelRequested) {
+            cache.cancelWriting();
+            return;
+        }
+        Molecule *molecule = decodeFrame(i);
+        int numAtoms = molecule->numAtoms();
+        QByteArray comment = molecule->comment().toUtf8();
+        CacheFrame frame;
+        frame.offset = cache.pos();
+        frame.numAtoms = numAtoms;
+        frame.commentLength = comment.size();
+        cache.write(reinterpret_cast<const char *>(molecule->xData()), numAtoms * sizeof(double));
+        cache.write(reinterpret_cast<const char *>(molecule->yData()), numAtoms * sizeof(double));
+        cache.write(reinterpret_cast<const char *>(molecule->zData()), numAtoms * sizeof(double));
+        cache.write(reinterpret_cast<const char *>(molecule->elementData()),
+                    numAtoms * sizeof(quint32));
+        cache.write(comment);
+        alignCache(cache);
+        frames.append(frame);
+        delete molecule;
+    }
+
+    memcpy(header.magic, cacheMagic, sizeof(cacheMagic));
+    header.version = cacheVersion;
+    header.byteOrder = cacheByteOrder;
+    header.fileType = fileType;
+    header.pathLength = myFileName.toUtf8().size();
+    header.sourceSize = source.size();
+    header.sourceModified = source.lastModified().toMSecsSinceEpoch();
+    header.numFrames = frames.size();
+
+    header.labelsOffset = cache.pos();
+    header.numLabels = myLabels.size();
+    for (quint32 id = 0; id < header.numLabels; ++id) {
+        QByteArray label = myLabels.label(id).toUtf8();
+        quint16 length = label.size();
+        cache.write(reinterpret_cast<const char *>(&length), sizeof(length));
+        cache.write(label);
+    }
+    alignCache(cache);
+
+    header.framesOffset = cache.pos();
+    cache.write(reinterpret_cast<const char *>(frames.constData()),
+                frames.size() * sizeof(CacheFrame));
+    cache.seek(0);
+    cache.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    if (cache.commit()) {
+        pruneCaches(cacheName);
+    } else {
+#ifdef QT_DEBUG
+        std::cout << "Unable to write the cache " << cacheName.toStdString() << std::endl;
+#endif
+    }
+}
+
+// Deletes the least recently written caches until they all fit in TRAJECTORY_CACHE_LIMIT
+void FileParser::pruneCaches(const QString &keep)
+{
+    QFileInfo kept(keep);
+    QFileInfoList caches =
+        kept.absoluteDir().entryInfoList(QStringList("*.cache"), QDir::Files, QDir::Time);
+    qint64 total = 0;
+    foreach (const QFileInfo &cache, caches) {
+        if (cache.fileName() != kept.fileName() && total + cache.size() > TRAJECTORY_CACHE_LIMIT) {
+            QFile::remove(cache.absoluteFilePath());
+            continue;
+        }
+        total += cache.size();
+    }
+}
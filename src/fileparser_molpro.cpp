@@ -1,12 +1,7 @@
 #include "fileparser.h"
 
-using namespace std;
-
-void FileParser::readMolpro()
+bool FileParser::findMolproFrame(TextScanner &scanner)
 {
-    std::string tempString;
-    QRegExp rx("", Qt::CaseInsensitive, QRegExp::RegExp2);
-    QRegExp rx_done("\\s+Bond lengths.*", Qt::CaseInsensitive, QRegExp::RegExp2);
     //        GOAL TO MATCH -
     //        Convergence:                0.00000000  (line search)     0.44148917     0.14465594
     //        (total)
@@ -35,48 +30,41 @@ void FileParser::readMolpro()
     //         23  FE     26.00    0.198822354    0.010404544   -0.122326318
     //
     //        Bond lengths in Bohr (Angstrom)
-
-    // Molpro geometries are reported in Bohr
-    myUnits = Bohr;
-
-    while (infile.eof() == false) {
-        getline(infile, tempString);
-        if (tempString.find("Convergence:") != string::npos) {
-            Molecule *molecule = new Molecule();
+    while (scanner.nextLine()) {
+        if (scanner.lineContains("Convergence:")) {
+            scanner.markFrame();
 #ifdef QT_DEBUG
             std::cout << "readMolpro: Convergence:' found.\n";
 #endif
-            if (infile.eof()) {
-                break;
-            }
-            // Read in atom information
-            rx.setPattern("(?:\\s*)(?:\\d+)(?:\\s+)(\\w+)(?:\\s+)(?:\\d+.\\d+)(?:\\s+)(-?\\d+\\."
-                          "\\d+)(?:\\s+)(-?\\d+\\.\\d+)(?:\\s+)(-?\\d+\\.\\d+)");
-            while (1) {
-                getline(infile, tempString);
-                if (rx.exactMatch(tempString.c_str()) == true) {
-                    AtomEntry *atom = new AtomEntry;
-                    QString symbol = rx.cap(1);
-                    // Molpro capitalizes atom labels, make sure the symbol is correct
-                    if (symbol.size() > 1) {
-                        symbol[1] = symbol[1].toLower();
-                    }
-                    atom->Label = symbol;
-                    atom->x = BOHR_TO_ANG * rx.cap(2).toDouble();
-                    atom->y = BOHR_TO_ANG * rx.cap(3).toDouble();
-                    atom->z = BOHR_TO_ANG * rx.cap(4).toDouble();
-                    molecule->addAtom(atom);
-#ifdef QT_DEBUG
-                    std::cout << std::setw(5) << atom->Label.toStdString() << " " << std::setw(16)
-                              << std::setprecision(10) << atom->x << " " << std::setw(16)
-                              << std::setprecision(10) << atom->y << " " << std::setw(16)
-                              << std::setprecision(10) << atom->z << std::endl;
-#endif
-                } else if (rx_done.exactMatch(tempString.c_str())) {
-                    myMoleculeList.push_back(molecule);
-                    break;
-                }
+            return true;
+        }
+    }
+    return false;
+}
+
+int FileParser::readMolproFrame(TextScanner &scanner, Molecule *molecule)
+{
+    // Read in atom information, in Bohr, which is followed by an indented "Bond lengths" line
+    int numAtoms = 0;
+    while (scanner.nextLine()) {
+        int number;
+        const char *symbolBegin;
+        const char *symbolEnd;
+        double charge, x, y, z;
+        if (scanner.readInt(number) && scanner.readWord(symbolBegin, symbolEnd) &&
+            scanner.readDouble(charge) && scanner.readDouble(x) && scanner.readDouble(y) &&
+            scanner.readDouble(z) && scanner.atEndOfLine()) {
+            if (molecule) {
+                // Molpro capitalizes atom labels, make sure the symbol is correct
+                addAtom(molecule, symbol(symbolBegin, symbolEnd, true), BOHR_TO_ANG * x,
+                        BOHR_TO_ANG * y, BOHR_TO_ANG * z);
             }
+            ++numAtoms;
+        } else if (scanner.lineBegin() < scanner.lineEnd() &&
+                   TextScanner::isBlank(*scanner.lineBegin()) &&
+                   scanner.lineContains("Bond lengths")) {
+            break;
         }
     }
+    return numAtoms;
 }
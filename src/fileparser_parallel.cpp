@@ -0,0 +1,248 @@
+#include "fileparser.h"
+
+#include <QRunnable>
+#include <QThread>
+#include <QThreadPool>
+#include <QWaitCondition>
+
+#include <cstring>
+
+// Each thread gets several chunks, so that one slow chunk doesn't hold up the rest
+#define CHUNKS_PER_THREAD 4
+
+class FrameChunkTask : public QRunnable
+{
+  public:
+    FrameChunkTask(FileParser *parser, FileParser::FrameChunk *chunk, QMutex *lock,
+                   QWaitCondition *chunkDone)
+        : myParser(parser), myChunk(chunk), myLock(lock), myChunkDone(chunkDone)
+    {
+    }
+
+    void run()
+    {
+        myParser->indexChunk(myChunk);
+        QMutexLocker locker(myLock);
+        myChunk->done = true;
+        myChunkDone->wakeAll();
+    }
+
+  private:
+    FileParser *myParser;
+    FileParser::FrameChunk *myChunk;
+    QMutex *myLock;
+    QWaitCondition *myChunkDone;
+};
+
+bool FileParser::canIndexInParallel() const
+{
+    if (myMappedFile->size() < PARALLEL_PARSE_SIZE || QThread::idealThreadCount() < 2) {
+        return false;
+    }
+    // File11 has no frame markers, and ACES2 only wants the first frame in some cases, so both
+    // have to be read from the beginning
+    switch (fileType) {
+    case XYZ:
+    case PSI3:
+    case GAMESS:
+    case ORCA:
+    case NWCHEM:
+    case MOLPRO:
+    case QCHEM3_1:
+        return true;
+    default:
+        return false;
+    }
+}
+
+/*
+ * Splits the file into chunks that are indexed on a thread pool, then merges the frames back
+ * in order.  Chunks are published as soon as all of those before them are done, so the first
+ * frames are available long before the whole file has been read.  No chunk reads further than
+ * the start of the next, so a frame that never ends can't send every chunk to the end of the
+ * file; the one frame that runs over the end of a chunk is finished off here instead, unless
+ * the chunk before swallowed it.
+ */
+void FileParser::indexFramesInParallel()
+{
+    const char *begin = myMappedFile->begin();
+    const char *end = myMappedFile->end();
+    int numThreads = QThread::idealThreadCount();
+    qint64 chunkSize = qMax(myMappedFile->size() / (numThreads * CHUNKS_PER_THREAD), qint64(1));
+
+    QThreadPool pool;
+    pool.setMaxThreadCount(numThreads);
+    QMutex lock;
+    QWaitCondition chunkDone;
+    QList<FrameChunk *> chunks;
+
+    // Snap each chunk to the start of a line; the frames belong to the chunk their marker line
+    // starts in
+    const char *chunkBegin = begin;
+    while (chunkBegin < end) {
+        const char *chunkEnd = chunkBegin + qMin(chunkSize, qint64(end - chunkBegin));
+        if (chunkEnd < end) {
+            const char *newline = static_cast<const char *>(
+                memchr(chunkEnd, '\n', static_cast<size_t>(end - chunkEnd)));
+            chunkEnd = newline ? newline + 1 : end;
+        }
+        FrameChunk *chunk = new FrameChunk;
+        chunk->begin = chunkBegin;
+        chunk->end = chunkEnd;
+        chunk->lastEnd = 0;
+        chunk->firstHeader = -1;
+        chunk->unfinished = -1;
+        chunk->failed = false;
+        chunk->done = false;
+        chunks.append(chunk);
+        pool.start(new FrameChunkTask(this, chunk, &lock, &chunkDone));
+        chunkBegin = chunkEnd;
+    }
+
+    qint64 lastEnd = 0;
+    bool failed = false;
+    for (int i = 0; i < chunks.size(); ++i) {
+        FrameChunk *chunk = chunks[i];
+        QMutexLocker locker(&lock);
+        while (!chunk->done) {
+            chunkDone.wait(&lock);
+        }
+        locker.unlock();
+        if (failed || myCancelRequested) {
+            continue;
+        }
+        if (fileType == XYZ && i > 0) {
+            if (lastEnd >= chunk->end - begin) {
+                // The last frame read runs right through this chunk
+                continue;
+            }
+            if (chunk->firstHeader != lastEnd) {
+                // The chunk took something else for a header, so follow the frames on from
+                // where the last chunk left off
+                indexXYZChunk(chunk, begin + lastEnd);
+            }
+        } else if (chunk->unfinished >= 0 && chunk->unfinished >= lastEnd) {
+            finishChunk(chunk);
+        }
+        if (fileType == XYZ && chunk->failed) {
+            // Read the bad frame again, this time to report what's wrong with it
+            TextScanner scanner(begin + chunk->lastEnd, end);
+            readXYZFrame(scanner, 0);
+        }
+        publishChunk(chunk, lastEnd);
+        myIndexingProgress = int(100 * (chunk->end - begin) / myMappedFile->size());
+        failed = chunk->failed;
+    }
+    pool.waitForDone();
+    qDeleteAll(chunks);
+}
+
+void FileParser::indexChunk(FrameChunk *chunk)
+{
+    const char *begin = myMappedFile->begin();
+    if (fileType == XYZ) {
+        // The first chunk needn't guess where the frames start
+        const char *start = (chunk->begin == begin ? begin : findXYZChunkStart(chunk));
+        if (start) {
+            chunk->firstHeader = start - begin;
+            indexXYZChunk(chunk, start);
+        }
+        return;
+    }
+
+    bool lastChunk = (chunk->end == myMappedFile->end());
+    TextScanner scanner(chunk->begin, chunk->end);
+    while (!myCancelRequested) {
+        const char *marker = scanner.frameBegin();
+        if (!findFrame(scanner)) {
+            if (!lastChunk && scanner.frameBegin() != marker) {
+                chunk->unfinished = scanner.frameBegin() - begin;
+            }
+            break;
+        }
+        FrameEntry frame;
+        frame.offset = scanner.position() - begin;
+        frame.numAtoms = readFrame(scanner, 0);
+        if (!lastChunk && scanner.atEnd()) {
+            // The frame may well go on into the next chunk
+            chunk->unfinished = scanner.frameBegin() - begin;
+            break;
+        }
+        chunk->lastEnd = scanner.position() - begin;
+        if (frame.numAtoms) {
+            chunk->frames.append(frame);
+        }
+    }
+}
+
+// Reads the frame that ran into the end of its chunk again, as far as it really goes
+void FileParser::finishChunk(FrameChunk *chunk)
+{
+    const char *begin = myMappedFile->begin();
+    TextScanner scanner(begin + chunk->unfinished, myMappedFile->end());
+    if (findFrame(scanner)) {
+        FrameEntry frame;
+        frame.offset = scanner.position() - begin;
+        frame.numAtoms = readFrame(scanner, 0);
+        chunk->lastEnd = scanner.position() - begin;
+        if (frame.numAtoms) {
+            chunk->frames.append(frame);
+        }
+    }
+    chunk->unfinished = -1;
+}
+
+/*
+ * Finds the first line in the chunk that the frames can be followed on from.  An atom count in
+ * a comment can pass for a header, and so can a frame's own header, read part way through its
+ * atoms, but not for two frames in a row.
+ */
+const char *FileParser::findXYZChunkStart(FrameChunk *chunk)
+{
+    TextScanner lines(chunk->begin, chunk->end);
+    while (!myCancelRequested && lines.nextLine()) {
+        TextScanner scanner(lines.lineBegin(), myMappedFile->end());
+        if (readXYZFrame(scanner, 0, true) >= 0 &&
+            (!findXYZFrame(scanner) || readXYZFrame(scanner, 0, true) >= 0)) {
+            return lines.lineBegin();
+        }
+    }
+    return 0;
+}
+
+// Follows the frames on from start, for as long as their headers are in the chunk
+void FileParser::indexXYZChunk(FrameChunk *chunk, const char *start)
+{
+    const char *begin = myMappedFile->begin();
+    chunk->frames.clear();
+    chunk->failed = false;
+    TextScanner scanner(start, myMappedFile->end());
+    while (!myCancelRequested && findXYZFrame(scanner) && scanner.position() < chunk->end) {
+        FrameEntry frame;
+        frame.offset = scanner.position() - begin;
+        frame.numAtoms = readXYZFrame(scanner, 0, true);
+        if (frame.numAtoms < 0) {
+            // Nothing's reported until it's certain that this really is a frame
+            chunk->failed = true;
+            chunk->lastEnd = frame.offset;
+            return;
+        }
+        if (frame.numAtoms) {
+            chunk->frames.append(frame);
+        }
+    }
+    chunk->lastEnd = scanner.position() - begin;
+}
+
+void FileParser::publishChunk(FrameChunk *chunk, qint64 &lastEnd)
+{
+    QMutexLocker locker(&myFrameLock);
+    for (int i = 0; i < chunk->frames.size(); ++i) {
+        // A marker that turned up inside the previous chunk's last frame wouldn't have been
+        // seen by reading the file from the start
+        if (chunk->frames[i].offset >= lastEnd) {
+            myFrames.append(chunk->frames[i]);
+        }
+    }
+    lastEnd = qMax(lastEnd, chunk->lastEnd);
+}
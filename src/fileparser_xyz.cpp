@@ -1,85 +1,128 @@
 #include "fileparser.h"
 
-void FileParser::readXYZ()
+// The word must be all of the lower case text
+static bool equalsNoCase(const char *begin, const char *end, const char *text)
 {
-    std::string tempString;
-    int numAtoms;
+    for (; *text; ++text, ++begin) {
+        if (begin >= end || (*begin | 0x20) != *text) {
+            return false;
+        }
+    }
+    return begin == end;
+}
 
-    QRegExp rx("(\\d+)(?:\\s*)(bohr|au)?", Qt::CaseInsensitive, QRegExp::RegExp2);
+// The atom symbol must be the exact symbol used in the periodic table
+static bool isElementSymbol(const char *begin, const char *end)
+{
+    int length = end - begin;
+    if (length < 1 || length > 2 || begin[0] < 'A' || begin[0] > 'Z') {
+        return false;
+    }
+    return length == 1 || (begin[1] >= 'a' && begin[1] <= 'z');
+}
 
-    while (!infile.eof()) {
-        Molecule *molecule = new Molecule();
-        numAtoms = 0;
-        getline(infile, tempString);
-        // The first line - number of atoms, then optionally units, e.g
-        // 8   bohr
-        rx.setPattern("(\\d+)(?:\\s*)(bohr|au)?");
-        if (rx.indexIn(tempString.c_str()) != -1) {
-            numAtoms = rx.cap(1).toInt();
-            if (!rx.cap(2).isEmpty()) {
-                myUnits = Bohr;
-            } else {
-                myUnits = Angstrom;
-            }
-#ifdef QT_DEBUG
-            std::cout << "Found a molecule with " << numAtoms << " atoms, expressed in "
-                      << (myUnits == Angstrom ? "Angstrom" : "Bohr") << std::endl;
-#endif
-            // Blank lines are acceptable
-        } else if (tempString.size()) {
-            QString errorMessage = "Unrecognized XYZ format in " + myFileName;
-            errorMessage += "\nI don't understand \n\n";
-            errorMessage += tempString.c_str();
-            errorMessage += "\nThe format should be \n num_atoms [(bohr|au)]";
-            error(errorMessage, __FILE__, __LINE__);
-            return;
+static QString currentLine(const TextScanner &scanner)
+{
+    return QString::fromUtf8(scanner.lineBegin(), scanner.lineEnd() - scanner.lineBegin());
+}
+
+bool FileParser::findXYZFrame(TextScanner &scanner)
+{
+    // Blank lines are acceptable between frames
+    while (scanner.nextLine()) {
+        if (!scanner.lineIsBlank()) {
+            // The header belongs to the frame, so leave it to be read again
+            scanner.markFrame();
+            scanner.setPosition(scanner.lineBegin());
+            return true;
         }
-        // This should be a comment line. Grab it and store it.
-        getline(infile, tempString);
-        molecule->setComment(QString(tempString.c_str()));
-        // Look for something like
-        // atom_symbol double double double
-        // with the constraint that atom_symbol is the exact symbol used in the periodic table
-        rx.setPattern("(?:\\s*)([A-Z](?:[a-z])?)(?:\\s+)(-?\\d+\\.\\d+)(?:\\s+)(-?\\d+\\.\\d+)(?:"
-                      "\\s+)(-?\\d+\\.\\d+)(?:\\s*)");
-        for (int i = 0; i < numAtoms; ++i) {
-            AtomEntry *atom = new AtomEntry;
-            getline(infile, tempString);
-            if (rx.exactMatch(tempString.c_str())) {
-                atom->Label = rx.cap(1);
-                atom->x = rx.cap(2).toDouble();
-                atom->y = rx.cap(3).toDouble();
-                atom->z = rx.cap(4).toDouble();
-                if (myUnits == Bohr) {
-                    atom->x *= BOHR_TO_ANG;
-                    atom->y *= BOHR_TO_ANG;
-                    atom->z *= BOHR_TO_ANG;
-                }
+    }
+    return false;
+}
+
+// The first line - number of atoms, then optionally units, e.g
+// 8   bohr
+// The units must be a whole word. The regular expression this replaced looked for "bohr" or "au"
+// anywhere after the number, so it took "8 auto" to be in Bohr; that's now read as Angstrom.
+static bool readXYZHeader(TextScanner &scanner, int &numAtoms, bool &inBohr)
+{
+    const char *unitsBegin;
+    const char *unitsEnd;
+    inBohr = false;
+    if (!scanner.readInt(numAtoms) || numAtoms < 0) {
+        return false;
+    }
+    if (scanner.readWord(unitsBegin, unitsEnd) &&
+        (equalsNoCase(unitsBegin, unitsEnd, "bohr") ||
+         equalsNoCase(unitsBegin, unitsEnd, "au"))) {
+        inBohr = true;
+    }
+    return true;
+}
+
+// Something like
+// atom_symbol double double double
+// The coordinates may be anything TextScanner::readDouble() understands, so integers, a leading
+// plus sign, no digits on one side of the point and exponents (with E or Fortran's D) are accepted
+// too. The regular expression this replaced only allowed -?digits.digits, and rejected the whole
+// file otherwise.
+static bool readXYZAtom(TextScanner &scanner, const char *&symbolBegin, const char *&symbolEnd,
+                        double &x, double &y, double &z)
+{
+    return scanner.nextLine() && scanner.readWord(symbolBegin, symbolEnd) &&
+           isElementSymbol(symbolBegin, symbolEnd) && scanner.readDouble(x) &&
+           scanner.readDouble(y) && scanner.readDouble(z) && scanner.atEndOfLine();
+}
+
+int FileParser::readXYZFrame(TextScanner &scanner, Molecule *molecule, bool quiet)
+{
+    scanner.nextLine();
+    int numAtoms = 0;
+    bool inBohr;
+    if (!readXYZHeader(scanner, numAtoms, inBohr)) {
+        if (quiet) {
+            return -1;
+        }
+        QString errorMessage = "Unrecognized XYZ format in " + myFileName;
+        errorMessage += "\nI don't understand \n\n";
+        errorMessage += currentLine(scanner);
+        errorMessage += "\nThe format should be \n num_atoms [(bohr|au)]";
+        parseError(scanner, errorMessage, __FILE__, __LINE__);
+        return -1;
+    }
+    double unitConversion = (inBohr ? BOHR_TO_ANG : 1.0);
+
+    // This should be a comment line. Grab it and store it.
+    scanner.nextLine();
+    if (molecule) {
 #ifdef QT_DEBUG
-                std::cout << std::setw(5) << atom->Label.toStdString() << " " << std::setw(16)
-                          << std::setprecision(10) << atom->x << " " << std::setw(16)
-                          << std::setprecision(10) << atom->y << " " << std::setw(16)
-                          << std::setprecision(10) << atom->z << std::endl;
+        std::cout << "Found a molecule with " << numAtoms << " atoms, expressed in "
+                  << (inBohr ? "Bohr" : "Angstrom") << std::endl;
 #endif
-                molecule->addAtom(atom);
-            } else {
-                QString errorMessage = "Unrecognized XYZ format in " + myFileName;
-                errorMessage += "\nI don't understand \n\n";
-                errorMessage += tempString.c_str();
-                errorMessage += "\nThe format should be \n atom_symbol x y z";
-                errorMessage += "\n where atom_label is the atom_symbol is the symbol used in the "
-                                "periodic table ";
-                errorMessage += "and x, y and z are floating point numbers";
-                error(errorMessage, __FILE__, __LINE__);
-                myMoleculeList.clear();
-                return;
+        molecule->setComment(currentLine(scanner));
+    }
+    for (int i = 0; i < numAtoms; ++i) {
+        const char *symbolBegin;
+        const char *symbolEnd;
+        double x, y, z;
+        if (!readXYZAtom(scanner, symbolBegin, symbolEnd, x, y, z)) {
+            if (quiet) {
+                return -1;
             }
+            QString errorMessage = "Unrecognized XYZ format in " + myFileName;
+            errorMessage += "\nI don't understand \n\n";
+            errorMessage += currentLine(scanner);
+            errorMessage += "\nThe format should be \n atom_symbol x y z";
+            errorMessage += "\n where atom_label is the atom_symbol is the symbol used in the "
+                            "periodic table ";
+            errorMessage += "and x, y and z are floating point numbers";
+            parseError(scanner, errorMessage, __FILE__, __LINE__);
+            return -1;
         }
-        if (numAtoms) {
-            myMoleculeList.push_back(molecule);
-#ifdef QT_DEBUG
-            std::cout << "Adding molecule to the list" << std::endl;
-#endif
+        if (molecule) {
+            addAtom(molecule, symbol(symbolBegin, symbolEnd), x * unitConversion,
+                    y * unitConversion, z * unitConversion);
         }
     }
+    return numAtoms;
 }
@@ -0,0 +1,145 @@
+#include "formatdetector.h"
+
+static char foldCase(char c)
+{
+    return (c >= 'A' && c <= 'Z') ? c + ('a' - 'A') : c;
+}
+
+FormatDetector::FormatDetector() : myNumSymbols(1), myBuilt(false)
+{
+    for (int c = 0; c < 256; ++c) {
+        mySymbols[c] = 0;
+    }
+    // The root state
+    myTransitions.fill(-1, myNumSymbols);
+    myMatches.append(-1);
+    myMatchLinks.append(-1);
+}
+
+void FormatDetector::addSignature(const char *text, int format, int weight)
+{
+    Q_ASSERT(!myBuilt);
+    Signature signature;
+    signature.format = format;
+    signature.weight = qBound(1, weight, 100);
+    mySignatures.append(signature);
+
+    // Each new character gets a symbol of its own, which widens every state's transitions
+    for (const char *c = text; *c; ++c) {
+        unsigned char folded = foldCase(*c);
+        if (mySymbols[folded] == 0) {
+            Q_ASSERT(myNumSymbols < 256);
+            int numStates = myMatches.size();
+            QVector<int> transitions(numStates * (myNumSymbols + 1));
+            for (int state = 0; state < numStates; ++state) {
+                for (int symbol = 0; symbol < myNumSymbols; ++symbol) {
+                    transitions[state * (myNumSymbols + 1) + symbol] = transition(state, symbol);
+                }
+                transitions[state * (myNumSymbols + 1) + myNumSymbols] = -1;
+            }
+            myTransitions = transitions;
+            mySymbols[folded] = myNumSymbols;
+            if (folded >= 'a' && folded <= 'z') {
+                mySymbols[folded - ('a' - 'A')] = myNumSymbols;
+            }
+            ++myNumSymbols;
+        }
+    }
+
+    int state = 0;
+    for (const char *c = text; *c; ++c) {
+        int symbol = mySymbols[static_cast<unsigned char>(*c)];
+        int next = transition(state, symbol);
+        if (next < 0) {
+            next = myMatches.size();
+            myTransitions[state * myNumSymbols + symbol] = next;
+            for (int s = 0; s < myNumSymbols; ++s) {
+                myTransitions.append(-1);
+            }
+            myMatches.append(-1);
+            myMatchLinks.append(-1);
+        }
+        state = next;
+    }
+    myMatches[state] = mySignatures.size() - 1;
+}
+
+/*
+ * Fills in the missing transitions of the trie, breadth first, so that every state knows where
+ * to go on every symbol; a state's failure state is the longest proper suffix of it that's also
+ * in the trie, and that's where a mismatch would have fallen back to.
+ */
+void FormatDetector::build()
+{
+    int numStates = myMatches.size();
+    QVector<int> failure(numStates, 0);
+    QVector<int> queue;
+    queue.reserve(numStates);
+    for (int symbol = 0; symbol < myNumSymbols; ++symbol) {
+        int next = transition(0, symbol);
+        if (next < 0) {
+            myTransitions[symbol] = 0;
+        } else {
+            failure[next] = 0;
+            queue.append(next);
+        }
+    }
+    for (int head = 0; head < queue.size(); ++head) {
+        int state = queue[head];
+        int fallback = failure[state];
+        myMatchLinks[state] = myMatches[fallback] >= 0 ? fallback : myMatchLinks[fallback];
+        for (int symbol = 0; symbol < myNumSymbols; ++symbol) {
+            int next = transition(state, symbol);
+            if (next < 0) {
+                myTransitions[state * myNumSymbols + symbol] = transition(fallback, symbol);
+            } else {
+                failure[next] = transition(fallback, symbol);
+                queue.append(next);
+            }
+        }
+    }
+    myBuilt = true;
+}
+
+int FormatDetector::detect(const char *begin, const char *end, int unknown, int *confidence) const
+{
+    Q_ASSERT(myBuilt);
+    int first = -1;
+    // Each signature only counts once, however often it appears
+    QVector<bool> seen(mySignatures.size(), false);
+    int state = 0;
+    for (const char *c = begin; c < end; ++c) {
+        state = transition(state, mySymbols[static_cast<unsigned char>(*c)]);
+        for (int match = state; match > 0; match = myMatchLinks[match]) {
+            int signature = myMatches[match];
+            if (signature >= 0 && !seen[signature]) {
+                seen[signature] = true;
+                if (first < 0) {
+                    first = signature;
+                }
+            }
+        }
+    }
+
+    if (first < 0) {
+        if (confidence) {
+            *confidence = 0;
+        }
+        return unknown;
+    }
+    if (confidence) {
+        int format = mySignatures[first].format;
+        int agreeing = 0;
+        int total = 0;
+        for (int signature = 0; signature < mySignatures.size(); ++signature) {
+            if (seen[signature]) {
+                total += mySignatures[signature].weight;
+                if (mySignatures[signature].format == format) {
+                    agreeing += mySignatures[signature].weight;
+                }
+            }
+        }
+        *confidence = mySignatures[first].weight * agreeing / total;
+    }
+    return mySignatures[first].format;
+}
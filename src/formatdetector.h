@@ -0,0 +1,55 @@
+#ifndef FORMATDETECTOR_H_
+#define FORMATDETECTOR_H_
+
+#include <QVector>
+#include <QtGlobal>
+
+/*
+ * Works out what wrote a file from signatures, such as a program's banner, found near its start.
+ * The signatures are compiled into an Aho-Corasick automaton, so every one of them is looked for
+ * in a single pass over the text, without regard to case, and the cost depends only on how much
+ * text is examined.  Formats are just numbers, chosen by whoever adds the signatures.
+ */
+class FormatDetector
+{
+  public:
+    FormatDetector();
+
+    // How sure a match of text makes us that the file is of the format given, from 1 to 100
+    void addSignature(const char *text, int format, int weight);
+    // Compiles the signatures, which must all have been added by now
+    void build();
+
+    /*
+     * Returns the format of the signature that ends first in [begin, end), or unknown if there
+     * isn't one.  The confidence, from 0 to 100, is that signature's weight, reduced in
+     * proportion to the weight of any other formats' signatures that also turn up.
+     */
+    int detect(const char *begin, const char *end, int unknown, int *confidence = 0) const;
+
+  private:
+    struct Signature {
+        int format;
+        int weight;
+    };
+
+    int transition(int state, int symbol) const
+    {
+        return myTransitions[state * myNumSymbols + symbol];
+    }
+
+    // Case is ignored by mapping both cases of a letter to the same symbol; every character
+    // that's in none of the signatures shares symbol 0
+    quint8 mySymbols[256];
+    int myNumSymbols;
+    QVector<Signature> mySignatures;
+    // The trie of signatures, which build() turns into the full automaton
+    QVector<int> myTransitions;
+    // For each state, the signature that ends there, and the next state along the chain of
+    // suffixes that also ends a signature (or -1 for either)
+    QVector<int> myMatches;
+    QVector<int> myMatchLinks;
+    bool myBuilt;
+};
+
+#endif /*FORMATDETECTOR_H_*/
@@ -0,0 +1,219 @@
+#include "headlessrenderer.h"
+
+#include <QApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <QSettings>
+#include <cstring>
+#include <iostream>
+
+#include "atom.h"
+#include "defines.h"
+#include "error.h"
+#include "exportfarm.h"
+
+bool HeadlessRenderer::requested(int argc, char *argv[])
+{
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--render") == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+int HeadlessRenderer::main(int &argc, char *argv[])
+{
+    // Nothing is ever shown, so there's no need for a display unless the user asks for a platform
+    if (qgetenv("QT_QPA_PLATFORM").isEmpty()) {
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    }
+
+    QApplication app(argc, argv);
+    QCoreApplication::setOrganizationName(COMPANY_NAME);
+    QCoreApplication::setOrganizationDomain(COMPANY_DOMAIN);
+    QCoreApplication::setApplicationName(PROGRAM_NAME);
+
+    // There's no one to dismiss a message box
+    setErrorsOnConsole(true);
+
+    return run(app.arguments());
+}
+
+int HeadlessRenderer::run(const QStringList &arguments)
+{
+    QCommandLineParser cmdLine;
+    cmdLine.setApplicationDescription("Renders coordinate files to images without a display.");
+    cmdLine.addHelpOption();
+    cmdLine.addPositionalArgument("input", "The coordinate file to render.");
+    cmdLine.addPositionalArgument("output",
+                                  "The image to write; its extension gives the format.  Omitted "
+                                  "when --format is given, and then any number of inputs, or "
+                                  "wildcard patterns, may be.");
+    QCommandLineOption renderOption("render", "Render without a display.");
+    QCommandLineOption rotateOption(
+        "rotate", "Rotate by X, Y and Z degrees from the input orientation.", "X,Y,Z", "0,0,0");
+    QCommandLineOption zoomOption("zoom", "Zoom to this percentage.", "percent", "100");
+    QCommandLineOption styleOption(
+        "style", "One of gradient, simple, colored or houkmol.", "style", "colored");
+    QCommandLineOption frameOption(
+        "frame", "The geometry to draw, counting from 1; the default is the last.", "n", "0");
+    QCommandLineOption fogOption("fog", "Fog the atoms at the back, by this amount.", "scale");
+    QCommandLineOption noPerspectiveOption("no-perspective", "Draw without perspective.");
+    QCommandLineOption sizeOption("size", "The size of the image.", "WxH",
+                                  QString("%1x%2").arg(DEFAULT_SCENE_SIZE_X).arg(
+                                      DEFAULT_SCENE_SIZE_Y));
+    QCommandLineOption dpiOption("dpi", "The resolution of PNGs and TIFFs, in dots per inch.",
+                                 "n", QString::number(DEFAULT_IMAGE_DPI));
+    QCommandLineOption formatOption(
+        "format", "Write each input alongside itself, with this extension.", "extension");
+    QCommandLineOption jobsOption(
+        "jobs", "How many files to render at once; the default is one per core.", "n", "0");
+    cmdLine.addOption(renderOption);
+    cmdLine.addOption(rotateOption);
+    cmdLine.addOption(zoomOption);
+    cmdLine.addOption(styleOption);
+    cmdLine.addOption(frameOption);
+    cmdLine.addOption(fogOption);
+    cmdLine.addOption(noPerspectiveOption);
+    cmdLine.addOption(sizeOption);
+    cmdLine.addOption(dpiOption);
+    cmdLine.addOption(formatOption);
+    cmdLine.addOption(jobsOption);
+    cmdLine.process(arguments);
+
+    ExportFarm::Options options;
+    bool ok = true;
+    QStringList angles = cmdLine.value(rotateOption).split(',');
+    if (angles.size() == 3) {
+        bool okX, okY, okZ;
+        options.xRot = angles[0].toInt(&okX);
+        options.yRot = angles[1].toInt(&okY);
+        options.zRot = angles[2].toInt(&okZ);
+        ok = okX && okY && okZ;
+    } else {
+        ok = false;
+    }
+    if (!ok) {
+        std::cerr << "The rotation must be given as X,Y,Z in degrees" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    options.zoom = cmdLine.value(zoomOption).toInt(&ok);
+    if (!ok || options.zoom <= 0) {
+        std::cerr << "The zoom must be a positive percentage" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    QString style = cmdLine.value(styleOption).toLower();
+    if (style == "gradient") {
+        options.style = DrawingInfo::Gradient;
+    } else if (style == "simple") {
+        options.style = DrawingInfo::Simple;
+    } else if (style == "colored") {
+        options.style = DrawingInfo::SimpleColored;
+    } else if (style == "houkmol") {
+        options.style = DrawingInfo::HoukMol;
+    } else {
+        std::cerr << "Unknown style " << style.toStdString() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    options.frame = cmdLine.value(frameOption).toInt(&ok);
+    if (!ok || options.frame < 0) {
+        std::cerr << "The frame must be a number, counting from 1" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    options.useFogging = cmdLine.isSet(fogOption);
+    if (options.useFogging) {
+        options.foggingScale = cmdLine.value(fogOption).toInt(&ok);
+        if (!ok) {
+            std::cerr << "The fogging scale must be a number" << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+    options.usePerspective = !cmdLine.isSet(noPerspectiveOption);
+
+    QStringList dimensions = cmdLine.value(sizeOption).toLower().split('x');
+    ok = dimensions.size() == 2;
+    if (ok) {
+        bool okW, okH;
+        options.size = QSize(dimensions[0].toInt(&okW), dimensions[1].toInt(&okH));
+        ok = okW && okH && !options.size.isEmpty();
+    }
+    if (!ok) {
+        std::cerr << "The size must be given as WxH in pixels" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    options.dotsPerInch = cmdLine.value(dpiOption).toInt(&ok);
+    if (!ok || options.dotsPerInch <= 0) {
+        std::cerr << "The resolution must be a positive number of dots per inch" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    int numThreads = cmdLine.value(jobsOption).toInt(&ok);
+    if (!ok || numThreads < 0) {
+        std::cerr << "The number of jobs must be a positive number" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    // The user's choice of colors are applied on top of the periodic table's, as in the GUI
+    QSettings settings;
+    Atom::colorOverrides =
+        settings.value("Default Atom Colors", QVariant(QMap<QString, QVariant>())).toMap();
+
+    QStringList files = cmdLine.positionalArguments();
+    QList<ExportFarm::Job> jobs;
+    if (cmdLine.isSet(formatOption)) {
+        QString extension = cmdLine.value(formatOption);
+        if (extension.startsWith('.')) {
+            extension.remove(0, 1);
+        }
+        files = ExportFarm::expandInputs(files);
+        if (files.isEmpty()) {
+            std::cerr << "There are no files to render" << std::endl;
+            return EXIT_FAILURE;
+        }
+        foreach (const QString &input, files) {
+            QFileInfo info(input);
+            ExportFarm::Job job;
+            job.input = input;
+            job.output = info.path() + "/" + info.completeBaseName() + "." + extension;
+            jobs << job;
+        }
+    } else {
+        if (files.size() != 2) {
+            cmdLine.showHelp(EXIT_FAILURE);
+        }
+        ExportFarm::Job job;
+        job.input = files[0];
+        job.output = files[1];
+        jobs << job;
+    }
+
+    ExportFarm farm(options, numThreads);
+    QElapsedTimer timer;
+    timer.start();
+    QList<ExportFarm::Result> results = farm.run(jobs);
+    qint64 elapsed = timer.elapsed();
+
+    int failures = 0;
+    foreach (const ExportFarm::Result &result, results) {
+        if (result.succeeded) {
+            std::cout << result.output.toStdString() << ": read in " << result.parseMsecs
+                      << " ms, rendered in " << result.renderMsecs << " ms" << std::endl;
+        } else {
+            ++failures;
+            std::cerr << result.input.toStdString() << ": " << result.message.toStdString()
+                      << std::endl;
+        }
+    }
+    if (results.size() > 1) {
+        std::cout << results.size() - failures << " of " << results.size() << " files rendered in "
+                  << elapsed << " ms on " << farm.numThreads() << " threads" << std::endl;
+    }
+    return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
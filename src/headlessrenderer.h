@@ -0,0 +1,30 @@
+#ifndef HEADLESSRENDERER_H_
+#define HEADLESSRENDERER_H_
+
+#include <QString>
+#include <QStringList>
+
+/*
+ * Renders coordinate files straight to images, with no main window, on Qt's offscreen platform
+ * so that no display is needed.  Only the parser, the drawing info and the canvas are built for
+ * each file, and the image is written just as the main window's save would write it.  Run as
+ *
+ *   chemvp --render [options] input output
+ *   chemvp --render [options] --format png input...
+ *
+ * where the second form writes each input alongside itself with the new extension, rendering
+ * them all at once on an ExportFarm.
+ */
+class HeadlessRenderer
+{
+  public:
+    // Whether the command line asks for headless rendering; checked before any application exists
+    static bool requested(int argc, char *argv[]);
+    // Sets up the offscreen application and renders everything asked for
+    static int main(int &argc, char *argv[]);
+
+  protected:
+    static int run(const QStringList &arguments);
+};
+
+#endif /*HEADLESSRENDERER_H_*/
@@ -0,0 +1,103 @@
+#include "imagewriter.h"
+
+#include <QImage>
+#include <QPageSize>
+#include <QPainter>
+#include <QPdfWriter>
+#include <QRegExp>
+
+#include "svgwriter.h"
+#include "tiledimagewriter.h"
+
+bool ImageWriter::write(QGraphicsScene *scene, const QString &fileName, int dotsPerInch)
+{
+    FileType fileType = determineFileType(fileName);
+    QSize imageDimension = outputSize(scene->sceneRect());
+
+    if (fileType == SVG) {
+        SvgWriter svgWriter(scene, imageDimension);
+        return svgWriter.write(fileName);
+    } else if (fileType == PNG || fileType == TIFF) {
+        // Big images are written a band at a time, rather than drawn whole first
+        QSize size = outputSize(scene->sceneRect(), dotsPerInch);
+        if (4 * qint64(size.width()) * size.height() > TILED_IMAGE_MIN_BYTES) {
+            TiledImageWriter writer(scene, size, dotsPerInch);
+            return writer.write(fileName, fileType == PNG ? TiledImageWriter::PNG
+                                                          : TiledImageWriter::TIFF);
+        }
+        return renderImage(scene, dotsPerInch).save(fileName);
+    } else if (fileType == PDF || fileType == PostScript) {
+        // Qt 5 has no PostScript output, so those are PDF too. They're written directly rather
+        // than through a QPrinter, which looks up the system's printers; that's slow enough to
+        // notice when rendering a lot of files, and it isn't safe to do off the GUI thread
+        QPdfWriter pdfWriter(fileName);
+        pdfWriter.setPageSize(QPageSize(imageDimension, QPageSize::Point));
+        pdfWriter.setPageMargins(QMarginsF(0.0, 0.0, 0.0, 0.0));
+        render(scene, &pdfWriter);
+    } else {
+        return false;
+    }
+    return true;
+}
+
+QSize ImageWriter::outputSize(const QRectF &sceneRect, int dotsPerInch)
+{
+    double scale = 5.0 * dotsPerInch / DEFAULT_IMAGE_DPI;
+    return QSize(qRound(scale * int(sceneRect.width())), qRound(scale * int(sceneRect.height())));
+}
+
+// The vector graphics formats still seem to rasterize radial gradients, so I use antialiasing to
+// keep them looking pretty
+void ImageWriter::render(QGraphicsScene *scene, QPaintDevice *device, const QRectF &target)
+{
+    QPainter painter(device);
+    painter.setRenderHint(QPainter::SmoothPixmapTransform, true);
+    painter.setRenderHint(QPainter::Antialiasing, true);
+    painter.setRenderHint(QPainter::HighQualityAntialiasing, true);
+    scene->render(&painter, target);
+}
+
+QImage ImageWriter::renderImage(QGraphicsScene *scene, int dotsPerInch)
+{
+    QImage image(outputSize(scene->sceneRect(), dotsPerInch), QImage::Format_ARGB32);
+    image.fill(Qt::transparent);
+    render(scene, &image);
+    // Only once it's drawn, as the text would be sized for the new resolution too
+    image.setDotsPerMeterX(qRound(dotsPerInch / 0.0254));
+    image.setDotsPerMeterY(qRound(dotsPerInch / 0.0254));
+    return image;
+}
+
+ImageWriter::FileType ImageWriter::determineFileType(const QString &fileName)
+{
+    QRegExp re(".*\\.pdf", Qt::CaseInsensitive, QRegExp::RegExp2);
+    if (re.exactMatch(fileName)) {
+        return PDF;
+    }
+    re.setPattern(".*\\.svg");
+    if (re.exactMatch(fileName)) {
+        return SVG;
+    }
+    re.setPattern(".*\\.ps");
+    if (re.exactMatch(fileName)) {
+        return PostScript;
+    }
+    re.setPattern(".*\\.eps");
+    if (re.exactMatch(fileName)) {
+        return PostScript;
+    }
+    re.setPattern(".*\\.tif");
+    if (re.exactMatch(fileName)) {
+        return TIFF;
+    }
+    re.setPattern(".*\\.tiff");
+    if (re.exactMatch(fileName)) {
+        return TIFF;
+    }
+    re.setPattern(".*\\.png");
+    if (re.exactMatch(fileName)) {
+        return PNG;
+    }
+
+    return Unknown;
+}
@@ -0,0 +1,36 @@
+#ifndef IMAGEWRITER_H_
+#define IMAGEWRITER_H_
+
+#include <QGraphicsScene>
+#include <QImage>
+#include <QRectF>
+#include <QSize>
+#include <QString>
+
+#include "defines.h"
+
+/*
+ * Renders a scene to an image file, in whichever format the file's extension asks for.  It needs
+ * nothing but the scene, so it's shared by the main window's save and the headless renderer.
+ */
+class ImageWriter
+{
+  public:
+    enum FileType { TIFF, PNG, PDF, PostScript, SVG, Unknown };
+
+    static FileType determineFileType(const QString &fileName);
+    // Returns false if the file type isn't one of the above, or the file couldn't be written.  The
+    // resolution only changes the size of PNGs and TIFFs; PDFs and the like are always the same
+    static bool write(QGraphicsScene *scene, const QString &fileName,
+                      int dotsPerInch = DEFAULT_IMAGE_DPI);
+
+    // At the default resolution, images are five times the size of the scene, in pixels or points
+    static QSize outputSize(const QRectF &sceneRect, int dotsPerInch = DEFAULT_IMAGE_DPI);
+    // Draws the scene into the target, or across the whole device if there isn't one
+    static void render(QGraphicsScene *scene, QPaintDevice *device,
+                       const QRectF &target = QRectF());
+    // The scene as it would be written to a PNG or TIFF
+    static QImage renderImage(QGraphicsScene *scene, int dotsPerInch = DEFAULT_IMAGE_DPI);
+};
+
+#endif /*IMAGEWRITER_H_*/
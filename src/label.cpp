@@ -1,5 +1,40 @@
 #include "label.h"
 #include "drawingcanvas.h"
+#include "svgwriter.h"
+
+#include <QAbstractTextDocumentLayout>
+#include <QCache>
+#include <QCoreApplication>
+#include <QTextBlock>
+#include <QTextDocument>
+#include <QTextLayout>
+#include <QThread>
+
+// The space a QTextDocument leaves around its text, so that nothing moves when a label is made
+// editable
+#define DOCUMENT_MARGIN 4.0
+
+// Labels showing the same value share one laid out copy of the text.  Drawing a QStaticText can
+// lay it out again, so canvases being rendered on other threads get copies of their own.
+static QStaticText cachedText(const QString &text, const QFont &font)
+{
+    if (QThread::currentThread() != QCoreApplication::instance()->thread()) {
+        QStaticText staticText(text);
+        staticText.setTextFormat(Qt::PlainText);
+        staticText.prepare(QTransform(), font);
+        return staticText;
+    }
+    static QCache<QString, QStaticText> cache(LABEL_TEXT_CACHE_SIZE);
+    QString key = font.key() + QLatin1Char(':') + text;
+    QStaticText *staticText = cache.object(key);
+    if (staticText == 0) {
+        staticText = new QStaticText(text);
+        staticText->setTextFormat(Qt::PlainText);
+        staticText->prepare(QTransform(), font);
+        cache.insert(key, staticText);
+    }
+    return *staticText;
+}
 
 Label::Label(LabelType type,
              double value,
@@ -7,26 +42,140 @@ Label::Label(LabelType type,
              QGraphicsItem *parent,
              QGraphicsScene *scene)
     //:QGraphicsTextItem(parent, scene),
-    : QGraphicsTextItem(parent), myType(type), myDX(0.0), myDY(0.0), myValue(value), _info(info)
+    : QGraphicsTextItem(parent), myType(type), myIsStatic(type != TextLabelType),
+      myFont(DEFAULT_LABEL_FONT, DEFAULT_LABEL_FONT_SIZE), myDX(0.0), myDY(0.0), myValue(value),
+      _info(info)
 {
     setFlag(QGraphicsItem::ItemIsMovable);
     setFlag(QGraphicsItem::ItemIsSelectable);
-    setTextInteractionFlags(Qt::NoTextInteraction);
     setZValue(1000.0);
-    setFont(QFont(DEFAULT_LABEL_FONT, DEFAULT_LABEL_FONT_SIZE));
+    // Touching the text interaction or the font would create the document, which static labels
+    // put off until they're edited
+    if (!myIsStatic) {
+        setTextInteractionFlags(Qt::NoTextInteraction);
+        setFont(myFont);
+    }
     if (myType != TextLabelType) {
         updateLabel();
     }
-    this->currentFormat = new QTextCharFormat();
-    this->currentFormat->setFont(QFont(DEFAULT_LABEL_FONT));
+    currentFormat.setFont(QFont(DEFAULT_LABEL_FONT));
     setToolTip(tr("Double click to edit"));
 }
 
+QRectF Label::boundingRect() const
+{
+    if (myIsStatic) {
+        return myStaticRect;
+    }
+    return QGraphicsTextItem::boundingRect();
+}
+
+QPainterPath Label::shape() const
+{
+    if (myIsStatic) {
+        QPainterPath path;
+        path.addRect(myStaticRect);
+        return path;
+    }
+    return QGraphicsTextItem::shape();
+}
+
+bool Label::contains(const QPointF &point) const
+{
+    if (myIsStatic) {
+        return myStaticRect.contains(point);
+    }
+    return QGraphicsTextItem::contains(point);
+}
+
+void Label::paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget)
+{
+    // While the view is being dragged the text is left out, as the atoms' symbols are
+    if (_info->lowDetail()) {
+        return;
+    }
+    if (!myIsStatic) {
+        QGraphicsTextItem::paint(painter, option, widget);
+        return;
+    }
+    painter->setPen(Qt::black);
+    painter->setFont(myFont);
+    painter->drawStaticText(QPointF(DOCUMENT_MARGIN, DOCUMENT_MARGIN), myStaticText);
+    // The same dashed outline the text item draws around a selected label
+    if (option->state & QStyle::State_Selected) {
+        painter->setPen(QPen(option->palette.windowText(), 0, Qt::DashLine));
+        painter->setBrush(Qt::NoBrush);
+        painter->drawRect(myStaticRect);
+    }
+}
+
+void Label::writeSvg(SvgWriter *svg)
+{
+    if (myIsStatic) {
+        QFontMetricsF metrics(myFont);
+        svg->writeText(QPointF(DOCUMENT_MARGIN, DOCUMENT_MARGIN + metrics.ascent()), myString,
+                       myFont, Qt::black);
+        return;
+    }
+    // Each run of text with the same format goes in as it's been laid out, a line at a time
+    QTextDocument *doc = document();
+    for (QTextBlock block = doc->begin(); block.isValid(); block = block.next()) {
+        QTextLayout *layout = block.layout();
+        QPointF origin = doc->documentLayout()->blockBoundingRect(block).topLeft();
+        for (QTextBlock::iterator it = block.begin(); !it.atEnd(); ++it) {
+            QTextFragment fragment = it.fragment();
+            QTextCharFormat format = fragment.charFormat();
+            QColor color = (format.foreground().style() == Qt::NoBrush
+                                ? defaultTextColor()
+                                : format.foreground().color());
+            int start = fragment.position() - block.position();
+            int end = start + fragment.length();
+            for (int i = 0; i < layout->lineCount(); ++i) {
+                QTextLine line = layout->lineAt(i);
+                int from = qMax(start, line.textStart());
+                int to = qMin(end, line.textStart() + line.textLength());
+                if (from >= to) {
+                    continue;
+                }
+                QPointF position(line.cursorToX(from), line.y() + line.ascent());
+                svg->writeText(origin + position, block.text().mid(from, to - from),
+                               format.font().resolve(doc->defaultFont()), color);
+            }
+        }
+    }
+}
+
+void Label::updateStaticText()
+{
+    myStaticText = cachedText(myString, myFont);
+    QSizeF size = myStaticText.size();
+    QRectF rect(
+        0.0, 0.0, size.width() + 2.0 * DOCUMENT_MARGIN, size.height() + 2.0 * DOCUMENT_MARGIN);
+    if (rect != myStaticRect) {
+        prepareGeometryChange();
+        myStaticRect = rect;
+    }
+    update();
+}
+
+void Label::makeEditable()
+{
+    if (!myIsStatic) {
+        return;
+    }
+    prepareGeometryChange();
+    myIsStatic = false;
+    myStaticText = QStaticText();
+    setTextInteractionFlags(Qt::NoTextInteraction);
+    setFont(myFont);
+    setPlainText(myString);
+}
+
 void Label::keyPressEvent(QKeyEvent *event)
 {
     QTextCursor cursor = textCursor();
     if (event->key() == Qt::Key_Tab) {
-        cursor.insertText("\t", *(this->currentFormat));
+        cursor.insertText("\t", currentFormat);
         setTextCursor(cursor);
         setTextInteractionFlags(Qt::TextEditorInteraction);
     } else if (event->key() == Qt::Key_Up) {
@@ -53,11 +202,11 @@ void Label::keyPressEvent(QKeyEvent *event)
             if (length < toPlainText().length()) {
                 QString c = toPlainText().left(cursor.position()).right(1);
                 cursor.deletePreviousChar();
-                cursor.insertText(c, *(this->currentFormat));
+                cursor.insertText(c, currentFormat);
             }
         }
     }
-    this->currentFormat = new QTextCharFormat(cursor.charFormat());
+    currentFormat = cursor.charFormat();
     emit characterEntered();
 }
 
@@ -87,11 +236,16 @@ void Label::updateLabel()
     } else if (myType == AngleLabelType) {
         myString.setNum(myValue, 'f', _info->getAnglePrecision());
     }
-    setPlainText(myString);
+    if (myIsStatic) {
+        updateStaticText();
+    } else {
+        setPlainText(myString);
+    }
 }
 
 void Label::mouseDoubleClickEvent(QGraphicsSceneMouseEvent *event)
 {
+    makeEditable();
     if (textInteractionFlags() == Qt::NoTextInteraction) {
         setTextInteractionFlags(Qt::TextEditorInteraction);
     }
@@ -112,10 +266,11 @@ void Label::mousePressEvent(QGraphicsSceneMouseEvent *event)
 
 void Label::setBold(bool bold)
 {
-    this->currentFormat->setFontWeight(bold ? QFont::Bold : QFont::Normal);
+    makeEditable();
+    currentFormat.setFontWeight(bold ? QFont::Bold : QFont::Normal);
     QTextCursor cursor = this->textCursor();
     if (textInteractionFlags() & Qt::TextEditorInteraction)
-        cursor.setCharFormat(*currentFormat);
+        cursor.setCharFormat(currentFormat);
     else {
         int length = toPlainText().length();
         cursor.setPosition(0);
@@ -134,10 +289,11 @@ void Label::setBold(bool bold)
 
 void Label::setItalic(bool italic)
 {
-    this->currentFormat->setFontItalic(italic);
+    makeEditable();
+    currentFormat.setFontItalic(italic);
     QTextCursor cursor = this->textCursor();
     if (textInteractionFlags() & Qt::TextEditorInteraction)
-        cursor.setCharFormat(*currentFormat);
+        cursor.setCharFormat(currentFormat);
     else {
         int length = toPlainText().length();
         cursor.setPosition(0);
@@ -156,11 +312,12 @@ void Label::setItalic(bool italic)
 
 void Label::setUnderline(bool underline)
 {
-    this->currentFormat->setFontUnderline(underline ? QTextCharFormat::SingleUnderline
+    makeEditable();
+    currentFormat.setFontUnderline(underline ? QTextCharFormat::SingleUnderline
                                                     : QTextCharFormat::NoUnderline);
     QTextCursor cursor = this->textCursor();
     if (textInteractionFlags() & Qt::TextEditorInteraction)
-        cursor.setCharFormat(*currentFormat);
+        cursor.setCharFormat(currentFormat);
     else {
         int length = toPlainText().length();
         cursor.setPosition(0);
@@ -180,10 +337,11 @@ void Label::setUnderline(bool underline)
 
 void Label::setCurrentFont(QFont font)
 {
-    this->currentFormat->setFontFamily(font.family());
+    makeEditable();
+    currentFormat.setFontFamily(font.family());
     QTextCursor cursor = this->textCursor();
     if (textInteractionFlags() & Qt::TextEditorInteraction)
-        cursor.setCharFormat(*currentFormat);
+        cursor.setCharFormat(currentFormat);
     else {
         int length = toPlainText().length();
         cursor.setPosition(0);
@@ -202,10 +360,11 @@ void Label::setCurrentFont(QFont font)
 
 void Label::setCurrentFontSize(int size)
 {
-    this->currentFormat->setFontPointSize(size);
+    makeEditable();
+    currentFormat.setFontPointSize(size);
     QTextCursor cursor = this->textCursor();
     if (textInteractionFlags() & Qt::TextEditorInteraction)
-        cursor.setCharFormat(*currentFormat);
+        cursor.setCharFormat(currentFormat);
     else {
         int length = toPlainText().length();
         cursor.setPosition(0);
@@ -242,7 +401,7 @@ QFont Label::getCurrentFont()
         }
         return cursor.charFormat().font();
     } else
-        return currentFormat->font();
+        return currentFormat.font();
 }
 
 void Label::serialize(QXmlStreamWriter *writer)
@@ -250,11 +409,21 @@ void Label::serialize(QXmlStreamWriter *writer)
     writer->writeStartElement("Label");
     writer->writeAttribute("type", QString("%1").arg(myType));
     writer->writeAttribute("string", myString);
-    writer->writeAttribute("text", toPlainText());
+    writer->writeAttribute("text", myIsStatic ? myString : toPlainText());
     writer->writeAttribute("dx", QString("%1").arg(myDX));
     writer->writeAttribute("dy", QString("%1").arg(myDY));
     writer->writeAttribute("value", QString("%1").arg(myValue));
 
+    // A static label is all in one font, which is what its document would have said
+    if (myIsStatic) {
+        writer->writeAttribute("formats", QString("%1").arg(myString.isEmpty() ? 0 : 1));
+        if (!myString.isEmpty()) {
+            FontFormatTuple(myFont.toString(), 0, myString.length() - 1).serialize(writer);
+        }
+        writer->writeEndElement();
+        return;
+    }
+
     // Determine and write all the font formats used throughout the label
     // Credit: Jesse Yates
     QTextCursor *cursor = new QTextCursor(this->document());
@@ -314,12 +483,21 @@ Label *Label::deserialize(QXmlStreamReader *reader, DrawingInfo *drawingInfo, QG
     Label *l = new Label(type, attr.value("value").toString().toDouble(), drawingInfo, NULL, scene);
     QString text = attr.value("text").toString();
     l->myString = attr.value("string").toString();
-    l->setPlainText("");
     l->myDX = attr.value("dx").toString().toInt();
     l->myDY = attr.value("dy").toString().toInt();
     l->myValue = attr.value("value").toString().toDouble();
 
     int formats = attr.value("formats").toString().toInt();
+    // An unedited value in a single font can stay static
+    if (l->myIsStatic && formats == 1 && text == l->myString) {
+        FontFormatTuple *s = FontFormatTuple::deserialize(reader);
+        l->myFont.fromString(s->format);
+        delete s;
+        l->updateStaticText();
+        return l;
+    }
+    l->makeEditable();
+    l->setPlainText("");
     QTextCursor cursor(l->document());
     QTextCharFormat textFormat;
     QFont textFont;
@@ -6,6 +6,7 @@
 #include <QFont>
 #include <QGraphicsTextItem>
 #include <QPen>
+#include <QStaticText>
 #include <QTextCharFormat>
 #include <QTextCursor>
 #include <iostream>
@@ -14,6 +15,7 @@ class QFocusEvent;
 class QGraphicsItem;
 class QGraphicsScene;
 class QGraphicsSceneMouseEvent;
+class SvgWriter;
 
 class Label : public QGraphicsTextItem
 {
@@ -37,6 +39,17 @@ class Label : public QGraphicsTextItem
     {
         return myType;
     }
+    QRectF boundingRect() const;
+    QPainterPath shape() const;
+    bool contains(const QPointF &point) const;
+    void paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget = 0);
+    // Bond and angle values start out as plain text, with no document behind them, until they
+    // need editing or formatting
+    bool isStatic() const
+    {
+        return myIsStatic;
+    }
+    void makeEditable();
     double dX()
     {
         return myDX;
@@ -62,6 +75,7 @@ class Label : public QGraphicsTextItem
     QFont getCurrentFont();
     void updateLabel();
 
+    void writeSvg(SvgWriter *svg);
     void serialize(QXmlStreamWriter *writer);
     static Label *
     deserialize(QXmlStreamReader *reader, DrawingInfo *drawingInfo, QGraphicsScene *scene);
@@ -77,9 +91,15 @@ class Label : public QGraphicsTextItem
     void mousePressEvent(QGraphicsSceneMouseEvent *event);
 
   private:
+    void updateStaticText();
+
     LabelType myType;
     QString myString;
-    QTextCharFormat *currentFormat;
+    QTextCharFormat currentFormat;
+    bool myIsStatic;
+    QFont myFont;
+    QStaticText myStaticText;
+    QRectF myStaticRect;
     int myFontSize;
     double myDX;
     double myDY;
@@ -6,6 +6,7 @@
 #include "application.h"
 #include "defines.h"
 #include "fileparser.h"
+#include "headlessrenderer.h"
 #include "mainwindow.h"
 #include "splashscreen.h"
 
@@ -13,6 +14,11 @@ int main(int argv, char *args[])
 {
     Q_INIT_RESOURCE(chemvp);
 
+    // Rendering straight to images needs neither a window nor a display
+    if (HeadlessRenderer::requested(argv, args)) {
+        return HeadlessRenderer::main(argv, args);
+    }
+
     Application app(argv, args);
     QCoreApplication::setOrganizationName(COMPANY_NAME);
     QCoreApplication::setOrganizationDomain(COMPANY_DOMAIN);
@@ -31,8 +37,10 @@ int main(int argv, char *args[])
     } else {
         cmd_line_arg = args[1];
         if (cmd_line_arg == "--help" || cmd_line_arg == "-h" || argv > 3) {
-            std::cout << "Usage: chemvp [coordfile]" << std::endl
-                      << "Where coordfile is an xyz file" << std::endl;
+            std::cout << "Usage: chemvp [coordfile [imagefile]]" << std::endl
+                      << "Where coordfile is an xyz file" << std::endl
+                      << "Run chemvp --render --help to render images without a display"
+                      << std::endl;
             exit(EXIT_FAILURE);
         } else {
         }
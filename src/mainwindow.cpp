@@ -8,7 +8,8 @@
 #include <iomanip>
 #include <iostream>
 
-MainWindow::MainWindow(FileParser *parser_in) : parser(parser_in)
+MainWindow::MainWindow(FileParser *parser_in)
+    : parser(parser_in), parserThread(0), cacheThread(0), fileDisplayed(false)
 {
     undoStack = new QUndoStack();
     drawingInfo = new DrawingInfo();
@@ -18,18 +19,12 @@ MainWindow::MainWindow(FileParser *parser_in) : parser(parser_in)
     createToolBox();
     createMenus();
     createToolbars();
+    createStatusBar();
 
-    Atom::fillLabelToVdwRadiusMap();
-    Atom::fillLabelToMassMap();
-
+    // The user's choice of colors are applied on top of the periodic table's
     QSettings settings;
-    QMap<QString, QVariant> colorMap =
+    Atom::colorOverrides =
         settings.value("Default Atom Colors", QVariant(QMap<QString, QVariant>())).toMap();
-    if (colorMap.isEmpty()) {
-        Atom::fillLabelToColorMap();
-    } else {
-        Atom::labelToColor = colorMap;
-    }
 
     QHBoxLayout *layout = new QHBoxLayout;
     view = new DrawingDisplay(canvas, drawingInfo);
@@ -38,7 +33,7 @@ MainWindow::MainWindow(FileParser *parser_in) : parser(parser_in)
         0, 0, static_cast<int>(DEFAULT_SCENE_SIZE_X), static_cast<int>(DEFAULT_SCENE_SIZE_Y));
     view->setHorizontalScrollBarPolicy(Qt::ScrollBarAlwaysOff);
     view->setVerticalScrollBarPolicy(Qt::ScrollBarAlwaysOff);
-    view->setViewportUpdateMode(QGraphicsView::FullViewportUpdate);
+    view->setViewportUpdateMode(QGraphicsView::MinimalViewportUpdate);
 
     drawingInfo->setHeight(view->sceneRect().height());
     drawingInfo->setWidth(view->sceneRect().width());
@@ -73,6 +68,7 @@ MainWindow::MainWindow(FileParser *parser_in) : parser(parser_in)
 
 MainWindow::~MainWindow()
 {
+    stopParsing();
     QSettings settings;
     settings.setValue("Recently Opened Files", QVariant(recentlyOpenedFiles));
 }
@@ -254,7 +250,7 @@ void MainWindow::changeAtomSize()
         atomSizeSpinBox->setValue(DEFAULT_ATOM_SCALE_FACTOR);
     } else {
         QGraphicsItem *item;
-        foreach (item, canvas->selectedItems()) {
+        foreach (item, canvas->selection()) {
             if (item->type() == Atom::Type) {
                 Atom *atom = dynamic_cast<Atom *>(item);
                 atom->setScaleFactor(atomSizeSpinBox->value());
@@ -289,7 +285,7 @@ void MainWindow::changeBondSize()
         bondSizeSpinBox->setValue(DEFAULT_BOND_THICKNESS);
     } else {
         QGraphicsItem *item;
-        foreach (item, canvas->selectedItems()) {
+        foreach (item, canvas->selection()) {
             if (item->type() == Bond::Type) {
                 Bond *bond = dynamic_cast<Bond *>(item);
                 bond->setThickness(bondSizeSpinBox->value());
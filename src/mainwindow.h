@@ -5,6 +5,7 @@
 #include "drawingdisplay.h"
 #include "drawinginfo.h"
 #include "fileparser.h"
+#include "parserthread.h"
 #include "preferences.h"
 #include "splashscreen.h"
 #include "undo_delete.h"
@@ -13,9 +14,11 @@
 #include <QLabel>
 #include <QMainWindow>
 #include <QMap>
+#include <QProgressBar>
 #include <QSettings>
 #include <QSlider>
 #include <QSvgGenerator>
+#include <QTimer>
 #include <QToolBox>
 #include <QToolButton>
 #include <QUndoCommand>
@@ -30,7 +33,6 @@ class MainWindow : public QMainWindow
   public:
     MainWindow(FileParser *parser);
     ~MainWindow();
-    enum FileType { TIFF, PNG, PDF, PostScript, SVG, CHMVP, Unknown };
 
   public slots:
     void setGeometryStep(int);
@@ -60,11 +62,15 @@ class MainWindow : public QMainWindow
     void save();
     void saveAs();
     void saveProject(QString filename);
+    void exportAnimation();
     void changeZoom(int);
     void setAddArrowMode();
     void aboutCheMVP();
     void showPreferences();
     void openRecentFile();
+    void parsingProgressed();
+    void parsingFinished();
+    void cancelParsing();
 
   private:
     void focusOutEvent(QFocusEvent *event);
@@ -74,11 +80,14 @@ class MainWindow : public QMainWindow
     void createMenus();
     void createToolbars();
     void updateRecentFiles();
-    FileType determineFileType(const QString &fileName);
-    void saveImage(const QString &fileName);
+    // Bitmaps are saved at the resolution last chosen, unless another's given
+    void saveImage(const QString &fileName, int dotsPerInch = 0);
     void foggingToggled(int useFogging);
     void perspectiveToggled(int usePerspective);
     void loadFile();
+    void displayFile();
+    void stopParsing();
+    void createStatusBar();
     void resetSignalsOnFileLoad();
     void resetButtonsOnFileLoad(bool project);
     QIcon textToIcon(const QString &string);
@@ -120,6 +129,14 @@ class MainWindow : public QMainWindow
     QSplitter *splitter;
     DrawingInfo *drawingInfo;
     FileParser *parser;
+    ParserThread *parserThread;
+    // Writes the cache of a big file once it's been read, while the user gets on with it
+    CacheThread *cacheThread;
+    QTimer *parserTimer;
+    QProgressBar *parserProgressBar;
+    QPushButton *cancelParsingButton;
+    // Whether the file being parsed has been put on screen yet
+    bool fileDisplayed;
 
     QComboBox *atomLabelFontSizeCombo;
     QComboBox *textFontSizeCombo;
@@ -180,6 +197,9 @@ class MainWindow : public QMainWindow
     QLabel *zLabel;
 
     QSlider *animationSlider;
+    QSpinBox *animationFirstBox;
+    QSpinBox *animationLastBox;
+    QSpinBox *animationDelayBox;
 
     QString currentSaveFile;
     QMenu *fileMenu;
@@ -95,7 +95,8 @@ void MainWindow::createActions()
 
 void MainWindow::deleteItem()
 {
-    if (canvas->selectedItems().isEmpty()) {
+    QList<QGraphicsItem *> selection = canvas->selection();
+    if (selection.isEmpty()) {
         return;
     }
 
@@ -103,7 +104,7 @@ void MainWindow::deleteItem()
     // Hide bond labels when they're deleted.
     // Prevents bond deletion from being undoable, but fixes geometry time step from reinstating
     // deleted bond
-    foreach (QGraphicsItem *i, canvas->selectedItems()) {
+    foreach (QGraphicsItem *i, selection) {
         if (i->type() == Label::BondLabelType) {
             foreach (Bond *b, canvas->getBonds()) {
                 if (b->label() == i) {
@@ -1,5 +1,7 @@
+#include "animationexporter.h"
+#include "imagewriter.h"
 #include "mainwindow.h"
-#include <QPrinter>
+#include <QInputDialog>
 
 void MainWindow::save()
 {
@@ -88,6 +90,26 @@ void MainWindow::saveAs()
             }
         }
 
+        // Only the bitmaps have a resolution to choose; it's kept for the next time they're saved
+        ImageWriter::FileType fileType = ImageWriter::determineFileType(currentSaveFile);
+        if (fileType == ImageWriter::PNG || fileType == ImageWriter::TIFF) {
+            QSettings settings;
+            int dotsPerInch = settings.value("Image Resolution", DEFAULT_IMAGE_DPI).toInt();
+            QSize defaultSize = ImageWriter::outputSize(canvas->sceneRect());
+            bool ok;
+            dotsPerInch = QInputDialog::getInt(this, "Image Resolution",
+                                               QString("Dots per inch (%1 gives %2 x %3 pixels):")
+                                                   .arg(DEFAULT_IMAGE_DPI)
+                                                   .arg(defaultSize.width())
+                                                   .arg(defaultSize.height()),
+                                               dotsPerInch, 10, 2400, 1, &ok);
+            if (!ok) {
+                delete saveAsDialog;
+                return;
+            }
+            settings.setValue("Image Resolution", dotsPerInch);
+        }
+
         if (currentSaveFile.endsWith(".chmvp")) {
             saveProject(currentSaveFile);
         } else {
@@ -100,109 +122,80 @@ void MainWindow::saveAs()
 void MainWindow::saveAndExit()
 {
     if (currentSaveFile.size()) {
+        // The whole file has to be read before it can be saved
+        if (parserThread) {
+            disconnect(parserThread, SIGNAL(finished()), this, SLOT(parsingFinished()));
+            parserThread->wait();
+            parsingFinished();
+        }
         std::cout << "Saving file..." << currentSaveFile.toStdString() << std::endl;
-        save();
+        // Saving from the command line shouldn't depend on what was last chosen in the GUI
+        if (currentSaveFile.endsWith(".chmvp")) {
+            saveProject(currentSaveFile);
+        } else {
+            saveImage(currentSaveFile, DEFAULT_IMAGE_DPI);
+        }
+        // There's no waiting around for the cache
+        stopParsing();
         exit(0);
     }
 }
 
-void MainWindow::saveImage(const QString &fileName)
+void MainWindow::saveImage(const QString &fileName, int dotsPerInch)
 {
     canvas->unselectAll();
-
-    FileType fileType = determineFileType(fileName);
-    QSize imageDimension(canvas->sceneRect().width(), canvas->sceneRect().height());
-
-    QPainter *painter = new QPainter();
-    QPrinter *printer = new QPrinter();
-    printer->setPaperSize(5.0 * imageDimension, QPrinter::Point);
-    printer->setFullPage(true);
-    printer->setOutputFileName(fileName);
-
-    // The vector graphics formats still seem to rasterize radial gradients, so I
-    // use antialiasing to keep them looking pretty
-    if (fileType == SVG) {
-        QSvgGenerator *svgGen = new QSvgGenerator();
-        svgGen->setSize(5.0 * imageDimension);
-        svgGen->setFileName(fileName);
-        painter->begin(svgGen);
-        painter->setRenderHint(QPainter::SmoothPixmapTransform, true);
-        painter->setRenderHint(QPainter::Antialiasing, true);
-        painter->setRenderHint(QPainter::HighQualityAntialiasing, true);
-        canvas->render(painter);
-        painter->end();
-        delete svgGen;
-    } else if (fileType == PNG || fileType == TIFF) {
-        QImage *image = new QImage(5.0 * imageDimension, QImage::Format_ARGB32);
-        painter->begin(image);
-        painter->setRenderHint(QPainter::SmoothPixmapTransform, true);
-        painter->setRenderHint(QPainter::Antialiasing, true);
-        painter->setRenderHint(QPainter::HighQualityAntialiasing, true);
-        canvas->render(painter);
-        painter->end();
-        image->save(fileName);
-        delete image;
-    } else if (fileType == PDF) {
-        printer->setOutputFormat(QPrinter::PdfFormat);
-        painter->begin(printer);
-        painter->setRenderHint(QPainter::SmoothPixmapTransform, true);
-        painter->setRenderHint(QPainter::Antialiasing, true);
-        painter->setRenderHint(QPainter::HighQualityAntialiasing, true);
-        canvas->render(painter);
-        painter->end();
-    } else if (fileType == PostScript) {
-        // printer->setOutputFormat(QPrinter::PostScriptFormat);
-        printer->setOutputFormat(QPrinter::PdfFormat);
-        painter->begin(printer);
-        painter->setRenderHint(QPainter::SmoothPixmapTransform, true);
-        painter->setRenderHint(QPainter::Antialiasing, true);
-        painter->setRenderHint(QPainter::HighQualityAntialiasing, true);
-        canvas->render(painter);
-        painter->end();
-    } else {
+    if (dotsPerInch <= 0) {
+        QSettings settings;
+        dotsPerInch = settings.value("Image Resolution", DEFAULT_IMAGE_DPI).toInt();
+    }
+    if (ImageWriter::write(canvas, fileName, dotsPerInch)) {
+        return;
+    }
+    if (ImageWriter::determineFileType(fileName) == ImageWriter::Unknown) {
         QString message("Unsupported file type:\n\n");
         message += fileName;
         message += "\n\nSupported extensions are\n.pdf, .svg, .ps, .eps, .png, .tiff, .tif, .chmvp";
         error(message, __FILE__, __LINE__);
-        return;
+    } else {
+        error("Unable to write " + fileName, __FILE__, __LINE__);
     }
-
-    delete painter;
-    delete printer;
 }
 
-MainWindow::FileType MainWindow::determineFileType(const QString &fileName)
+void MainWindow::exportAnimation()
 {
-    QRegExp re(".*\\.pdf", Qt::CaseInsensitive, QRegExp::RegExp2);
-    if (re.exactMatch(fileName)) {
-        return PDF;
+    int first = animationFirstBox->value() - 1;
+    int last = animationLastBox->value() - 1;
+    if (first > last) {
+        qSwap(first, last);
     }
-    re.setPattern(".*\\.svg");
-    if (re.exactMatch(fileName)) {
-        return SVG;
-    }
-    re.setPattern(".*\\.ps");
-    if (re.exactMatch(fileName)) {
-        return PostScript;
-    }
-    re.setPattern(".*\\.eps");
-    if (re.exactMatch(fileName)) {
-        return PostScript;
-    }
-    re.setPattern(".*\\.tif");
-    if (re.exactMatch(fileName)) {
-        return TIFF;
-    }
-    re.setPattern(".*\\.tiff");
-    if (re.exactMatch(fileName)) {
-        return TIFF;
+
+    QString selectedFilter;
+    QString filters = tr("Numbered PNG Images (*.png);;Animated PNG (*.apng);;Portable Document "
+                         "Format (*.pdf)");
+    QString fileName = QFileDialog::getSaveFileName(
+        this, tr("Export Frames"), QDir::homePath(), filters, &selectedFilter);
+    if (fileName.isEmpty()) {
+        return;
     }
-    re.setPattern(".*\\.png");
-    if (re.exactMatch(fileName)) {
-        return PNG;
+    if (AnimationExporter::determineFormat(fileName) == AnimationExporter::Unknown) {
+        // Take the extension from the filter, as the save dialog does
+        QString extension = selectedFilter.mid(selectedFilter.lastIndexOf("*.") + 1);
+        fileName += extension.left(extension.size() - 1);
     }
 
-    return Unknown;
+    QProgressDialog progress(tr("Exporting frames..."), tr("Cancel"), 0, last - first + 1, this);
+    progress.setWindowModality(Qt::WindowModal);
+    progress.setMinimumDuration(0);
+
+    AnimationExporter exporter(parser, drawingInfo, canvas);
+    exporter.setFrameDelay(animationDelayBox->value());
+    // The same resolution as the still images
+    QSettings settings;
+    exporter.setDotsPerInch(settings.value("Image Resolution", DEFAULT_IMAGE_DPI).toInt());
+    exporter.setProgressDialog(&progress);
+    if (!exporter.write(fileName, first, last) && !progress.wasCanceled()) {
+        error(exporter.errorMessage(), __FILE__, __LINE__);
+    }
 }
 
 void MainWindow::openFile()
@@ -213,6 +206,7 @@ void MainWindow::openFile()
             openProject(fileName);
             currentSaveFile = fileName;
         } else {
+            stopParsing();
             parser->setFileName(fileName);
             loadFile();
             currentSaveFile = "";
@@ -264,6 +258,7 @@ void MainWindow::openRecentFile()
                 openProject(fileName);
                 currentSaveFile = fileName;
             } else {
+                stopParsing();
                 parser->setFileName(fileName);
                 loadFile();
                 currentSaveFile = "";
@@ -285,62 +280,175 @@ void MainWindow::loadFile()
             openProject(parser->fileName());
             return;
         }
-        parser->readFile();
-        canvas->clearAll();
-
-        DrawingCanvas *old_canvas = canvas;
-        DrawingInfo *old_info = drawingInfo;
-        QGraphicsView *old_view = view;
-
-        drawingInfo = new DrawingInfo();
-        // Includes loading canvas from parser
-        canvas = new DrawingCanvas(this->drawingInfo, this->parser);
-
-        setWindowTitle(tr("%1 - cheMVP").arg(parser->fileName()));
-
-        this->view = new DrawingDisplay(canvas, drawingInfo);
-        view->setSizePolicy(QSizePolicy::Preferred, QSizePolicy::Preferred);
-        view->setGeometry(
-            0, 0, static_cast<int>(DEFAULT_SCENE_SIZE_X), static_cast<int>(DEFAULT_SCENE_SIZE_Y));
-        //		view->setHorizontalScrollBarPolicy(Qt::ScrollBarAlwaysOff); // Causes display issues
-        // on load
-        view->setVerticalScrollBarPolicy(Qt::ScrollBarAlwaysOff);
-        view->setViewportUpdateMode(QGraphicsView::FullViewportUpdate);
-
-        resetToolBox(NULL);
-        resetSignalsOnFileLoad();
-
-        // Enable the widgets in the animation tab if there are multiple geometries
-        if (parser->numMolecules() <= 1) {
-            animationWidget->setEnabled(false);
-        } else {
-            animationWidget->setEnabled(true);
+        stopParsing();
+        if (!parser->openFile()) {
+            return;
         }
+        // The frames are found on a worker thread, and the first one is drawn as soon as it's
+        // available.  Small files are usually done before the timer first fires.
+        fileDisplayed = false;
+        parserProgressBar->setValue(0);
+        parserProgressBar->show();
+        cancelParsingButton->show();
+        parserThread = new ParserThread(parser, this);
+        connect(parserThread, SIGNAL(finished()), this, SLOT(parsingFinished()));
+        parserThread->start();
+        parserTimer->start();
+    }
+}
 
-        // Set the sliders range and current value.
-        animationSlider->setRange(0, parser->numMolecules() - 1);
-        animationSlider->setValue(parser->current());
+void MainWindow::displayFile()
+{
+    canvas->clearAll();
 
-        QHBoxLayout *layout = new QHBoxLayout;
-        QByteArray state = splitter->saveState();
-        QSplitter *old_splitter = splitter;
-        splitter = new QSplitter(Qt::Horizontal);
-        splitter->addWidget(view);
-        splitter->addWidget(toolBox);
-        splitter->restoreState(state);
-        layout->addWidget(splitter);
+    DrawingCanvas *old_canvas = canvas;
+    DrawingInfo *old_info = drawingInfo;
+    QGraphicsView *old_view = view;
+
+    drawingInfo = new DrawingInfo();
+    // Includes loading canvas from parser
+    canvas = new DrawingCanvas(this->drawingInfo, this->parser);
+
+    setWindowTitle(tr("%1 - cheMVP").arg(parser->fileName()));
+
+    this->view = new DrawingDisplay(canvas, drawingInfo);
+    view->setSizePolicy(QSizePolicy::Preferred, QSizePolicy::Preferred);
+    view->setGeometry(
+        0, 0, static_cast<int>(DEFAULT_SCENE_SIZE_X), static_cast<int>(DEFAULT_SCENE_SIZE_Y));
+    //		view->setHorizontalScrollBarPolicy(Qt::ScrollBarAlwaysOff); // Causes display issues
+    // on load
+    view->setVerticalScrollBarPolicy(Qt::ScrollBarAlwaysOff);
+    view->setViewportUpdateMode(QGraphicsView::MinimalViewportUpdate);
+
+    resetToolBox(NULL);
+    resetSignalsOnFileLoad();
+
+    // Enable the widgets in the animation tab if there are multiple geometries
+    if (parser->numMolecules() <= 1) {
+        animationWidget->setEnabled(false);
+    } else {
+        animationWidget->setEnabled(true);
+    }
+
+    // Set the sliders range and current value.
+    animationSlider->setRange(0, parser->numMolecules() - 1);
+    animationSlider->setValue(parser->current());
+    animationFirstBox->setRange(1, parser->numMolecules());
+    animationFirstBox->setValue(1);
+    animationLastBox->setRange(1, parser->numMolecules());
+    animationLastBox->setValue(parser->numMolecules());
+
+    QHBoxLayout *layout = new QHBoxLayout;
+    QByteArray state = splitter->saveState();
+    QSplitter *old_splitter = splitter;
+    splitter = new QSplitter(Qt::Horizontal);
+    splitter->addWidget(view);
+    splitter->addWidget(toolBox);
+    splitter->restoreState(state);
+    layout->addWidget(splitter);
+
+    QWidget *widget = new QWidget;
+    widget->setLayout(layout);
+    this->setCentralWidget(widget);
+
+    delete old_info;
+    delete old_view;
+    delete old_splitter;
+    delete old_canvas;
+
+    activateToolBar();
+    fileDisplayed = true;
+}
 
-        QWidget *widget = new QWidget;
-        widget->setLayout(layout);
-        this->setCentralWidget(widget);
+void MainWindow::createStatusBar()
+{
+    parserProgressBar = new QProgressBar;
+    parserProgressBar->setRange(0, 100);
+    parserProgressBar->setMaximumWidth(200);
+    parserProgressBar->hide();
+    cancelParsingButton = new QPushButton(tr("Cancel"));
+    cancelParsingButton->setToolTip(tr("Stop reading the file, keeping the steps found so far"));
+    cancelParsingButton->hide();
+    connect(cancelParsingButton, SIGNAL(clicked()), this, SLOT(cancelParsing()));
+    statusBar()->addPermanentWidget(parserProgressBar);
+    statusBar()->addPermanentWidget(cancelParsingButton);
+
+    parserTimer = new QTimer(this);
+    parserTimer->setInterval(100);
+    connect(parserTimer, SIGNAL(timeout()), this, SLOT(parsingProgressed()));
+}
 
-        delete old_info;
-        delete old_view;
-        delete old_splitter;
-        delete old_canvas;
+void MainWindow::parsingProgressed()
+{
+    parserProgressBar->setValue(parser->indexingProgress());
+    int numMolecules = parser->numMolecules();
+    if (!fileDisplayed) {
+        if (numMolecules) {
+            parser->setCurrent(0);
+            displayFile();
+        }
+    } else if (numMolecules - 1 > animationSlider->maximum()) {
+        // Let the user step through the frames found so far, and export up to the last of them
+        bool exportToEnd = animationLastBox->value() == animationLastBox->maximum();
+        animationSlider->setMaximum(numMolecules - 1);
+        animationFirstBox->setMaximum(numMolecules);
+        animationLastBox->setMaximum(numMolecules);
+        if (exportToEnd) {
+            animationLastBox->setValue(numMolecules);
+        }
+        animationWidget->setEnabled(numMolecules > 1);
+    }
+}
 
-        activateToolBar();
+void MainWindow::parsingFinished()
+{
+    parserTimer->stop();
+    parserProgressBar->hide();
+    cancelParsingButton->hide();
+    parserThread->deleteLater();
+    parserThread = 0;
+    cacheThread = new CacheThread(parser, this);
+    cacheThread->start();
+
+    parser->showParseError();
+    if (!fileDisplayed) {
+        // Everything arrived at once, so start on the final geometry as usual
+        if (parser->numMolecules()) {
+            parser->setCurrent(parser->numMolecules() - 1);
+        }
+        displayFile();
+    } else {
+        parsingProgressed();
+    }
+}
+
+void MainWindow::cancelParsing()
+{
+    // The thread stops after the current frame, and finishes up as normal
+    parser->cancelIndexing();
+}
+
+// Abandons any file that's still being parsed or cached, e.g. because another is about to be
+// opened
+void MainWindow::stopParsing()
+{
+    if (cacheThread != 0) {
+        parser->cancelIndexing();
+        cacheThread->wait();
+        delete cacheThread;
+        cacheThread = 0;
+    }
+    if (parserThread == 0) {
+        return;
     }
+    disconnect(parserThread, SIGNAL(finished()), this, SLOT(parsingFinished()));
+    parser->cancelIndexing();
+    parserThread->wait();
+    delete parserThread;
+    parserThread = 0;
+    parserTimer->stop();
+    parserProgressBar->hide();
+    cancelParsingButton->hide();
 }
 
 void MainWindow::saveProject(QString filename)
@@ -398,6 +506,7 @@ void MainWindow::openProject(QString filename, bool onNewMainWindow)
         return;
     }
 
+    stopParsing();
     DrawingCanvas *old_canvas = canvas;
     DrawingInfo *old_info = drawingInfo;
     QGraphicsView *old_view = view;
@@ -416,16 +525,14 @@ void MainWindow::openProject(QString filename, bool onNewMainWindow)
         0, 0, static_cast<int>(DEFAULT_SCENE_SIZE_X), static_cast<int>(DEFAULT_SCENE_SIZE_Y));
     view->setHorizontalScrollBarPolicy(Qt::ScrollBarAlwaysOff);
     view->setVerticalScrollBarPolicy(Qt::ScrollBarAlwaysOff);
-    view->setViewportUpdateMode(QGraphicsView::FullViewportUpdate);
+    view->setViewportUpdateMode(QGraphicsView::MinimalViewportUpdate);
 
-    QMap<QString, QString> *options = new QMap<QString, QString>();
+    // The orientation is restored with the DrawingInfo, so the rotation boxes keep their defaults
+    QMap<QString, QString> *options = defaultToolBoxOptions();
 
     // Appearance
     options->insert("FOGGING_ON", QString("%1").arg(drawingInfo->getUseFogging()));
     options->insert("FOGGING_SCALE", QString("%1").arg(drawingInfo->getFoggingScale()));
-    options->insert("X_ROTATION", "0"); // Where are these stored?
-    options->insert("Y_ROTATION", "0"); // They aren't.
-    options->insert("Z_ROTATION", "0"); // Why not? // No idea.
     options->insert("BACKGROUND_OPACITY", QString("%1").arg(canvas->getBackgroundOpacity()));
     options->insert("ZOOM", QString("%1").arg(drawingInfo->getZoom()));
 
@@ -438,6 +545,7 @@ void MainWindow::openProject(QString filename, bool onNewMainWindow)
     options->insert("ATOM_LABEL_SIZE", QString("%1").arg(Atom::SmallLabel));
 
     resetToolBox(options);
+    delete options;
 
     animationSlider->blockSignals(true);
 
@@ -449,6 +557,10 @@ void MainWindow::openProject(QString filename, bool onNewMainWindow)
     }
     animationSlider->setRange(0, parser->numMolecules() - 1);
     animationSlider->setValue(parser->current());
+    animationFirstBox->setRange(1, parser->numMolecules());
+    animationFirstBox->setValue(1);
+    animationLastBox->setRange(1, parser->numMolecules());
+    animationLastBox->setValue(parser->numMolecules());
 
     animationSlider->blockSignals(false);
 
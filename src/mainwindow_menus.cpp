@@ -73,7 +73,7 @@ void MainWindow::updateMenus()
     QList<QString> atomLabelFonts;
     QList<int> atomLabelFontSizes;
 
-    foreach (QGraphicsItem *item, canvas->selectedItems()) {
+    foreach (QGraphicsItem *item, canvas->selection()) {
         if (item->type() == Bond::Type) {
             Bond *bond = dynamic_cast<Bond *>(item);
             bondScaleFactors.append(bond->thickness());
@@ -252,7 +252,35 @@ QWidget *MainWindow::createAnimationWidget(QMap<QString, QString> *options)
 
     connect(animationSlider, SIGNAL(valueChanged(int)), this, SLOT(setGeometryStep(int)));
 
+    // Export
+    QGridLayout *exportLayout = new QGridLayout;
+    QGroupBox *exportGroupBox = new QGroupBox(tr("Export"));
+    animationFirstBox = new QSpinBox();
+    animationFirstBox->setRange(1, 1);
+    animationLastBox = new QSpinBox();
+    animationLastBox->setRange(1, 1);
+    animationDelayBox = new QSpinBox();
+    animationDelayBox->setRange(10, 10000);
+    animationDelayBox->setSingleStep(10);
+    animationDelayBox->setSuffix(tr(" ms"));
+    animationDelayBox->setValue(DEFAULT_ANIMATION_FRAME_DELAY_MS);
+    animationDelayBox->setToolTip(tr("How long each frame is shown for in an animated PNG"));
+    QPushButton *exportAnimationButton = new QPushButton(tr("Export Frames..."));
+    exportAnimationButton->setToolTip(
+        tr("Save the steps as numbered PNG images, an animated PNG or a PDF with a page per step"));
+    exportLayout->addWidget(new QLabel(tr("From step:")), 0, 0);
+    exportLayout->addWidget(animationFirstBox, 0, 1);
+    exportLayout->addWidget(new QLabel(tr("To step:")), 1, 0);
+    exportLayout->addWidget(animationLastBox, 1, 1);
+    exportLayout->addWidget(new QLabel(tr("Frame delay:")), 2, 0);
+    exportLayout->addWidget(animationDelayBox, 2, 1);
+    exportLayout->addWidget(exportAnimationButton, 3, 0, 1, 2);
+    exportGroupBox->setLayout(exportLayout);
+
+    connect(exportAnimationButton, SIGNAL(clicked()), this, SLOT(exportAnimation()));
+
     layout->addWidget(animationGroupBox);
+    layout->addWidget(exportGroupBox);
     widget->setLayout(layout);
     return widget;
 }
@@ -0,0 +1,49 @@
+#include "mappedfile.h"
+
+MappedFile::MappedFile(const QString &fileName)
+    : myFile(fileName), myMap(0), myData(0), mySize(0)
+{
+}
+
+MappedFile::~MappedFile()
+{
+    close();
+}
+
+bool MappedFile::open()
+{
+    close();
+    if (!myFile.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+    mySize = myFile.size();
+    if (mySize == 0) {
+        // Mapping an empty file fails, but it's still a perfectly good (empty) file
+        myData = "";
+        return true;
+    }
+    myMap = myFile.map(0, mySize);
+    if (myMap != 0) {
+        myData = reinterpret_cast<const char *>(myMap);
+    } else {
+        // Some file systems can't be mapped, so fall back to reading everything in
+        myBuffer = myFile.readAll();
+        mySize = myBuffer.size();
+        myData = myBuffer.constData();
+    }
+    return true;
+}
+
+void MappedFile::close()
+{
+    if (myMap != 0) {
+        myFile.unmap(myMap);
+        myMap = 0;
+    }
+    myBuffer.clear();
+    if (myFile.isOpen()) {
+        myFile.close();
+    }
+    myData = 0;
+    mySize = 0;
+}
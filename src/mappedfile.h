@@ -0,0 +1,52 @@
+#ifndef MAPPEDFILE_H_
+#define MAPPEDFILE_H_
+
+#include <QByteArray>
+#include <QFile>
+#include <QString>
+
+/*
+ * A read-only view of an entire file.  Where the platform allows it the file is memory
+ * mapped, so the parsers can walk the raw bytes without copying them into lines first;
+ * otherwise the contents are read into memory and the same view is provided.
+ */
+class MappedFile
+{
+  public:
+    MappedFile(const QString &fileName);
+    ~MappedFile();
+
+    bool open();
+    void close();
+    bool isOpen() const
+    {
+        return myData != 0;
+    }
+    const char *begin() const
+    {
+        return myData;
+    }
+    const char *end() const
+    {
+        return myData + mySize;
+    }
+    qint64 size() const
+    {
+        return mySize;
+    }
+    const QString fileName() const
+    {
+        return myFile.fileName();
+    }
+
+  private:
+    Q_DISABLE_COPY(MappedFile)
+
+    QFile myFile;
+    QByteArray myBuffer;
+    uchar *myMap;
+    const char *myData;
+    qint64 mySize;
+};
+
+#endif /*MAPPEDFILE_H_*/
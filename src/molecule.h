@@ -1,78 +1,179 @@
 #ifndef MOLECULE_H_
 #define MOLECULE_H_
 
+#include <QHash>
+#include <QMutex>
 #include <QString>
+#include <QVector>
 #include <QXmlStreamReader>
 #include <QXmlStreamWriter>
 #include <vector>
 
-struct AtomEntry {
-    QString Label;
-    double x;
-    double y;
-    double z;
+/*
+ * The distinct atom labels seen in a trajectory.  Every frame repeats the same few labels, so
+ * each one is stored here once and the atoms just refer to it by an id.  The ids are four bytes,
+ * so even a file that gives every atom a label of its own can't run out of them.  Frames are
+ * decoded on a worker thread while the viewer reads the labels of those it has, so the labels
+ * are locked, and handed out by value.
+ */
+class AtomLabels
+{
+  public:
+    quint32 id(const QString &label)
+    {
+        QMutexLocker locker(&_lock);
+        QHash<QString, quint32>::const_iterator id = _ids.constFind(label);
+        if (id != _ids.constEnd()) {
+            return id.value();
+        }
+        quint32 newId = _labels.size();
+        _labels.append(label);
+        _ids.insert(label, newId);
+        return newId;
+    }
+    QString label(quint32 id) const
+    {
+        QMutexLocker locker(&_lock);
+        return _labels[id];
+    }
+    int size() const
+    {
+        QMutexLocker locker(&_lock);
+        return _labels.size();
+    }
+    void clear()
+    {
+        QMutexLocker locker(&_lock);
+        _labels.clear();
+        _ids.clear();
+    }
+
+  private:
+    mutable QMutex _lock;
+    QVector<QString> _labels;
+    QHash<QString, quint32> _ids;
 };
 
+/*
+ * A single geometry.  The coordinates are kept in separate, contiguous arrays so that loops over
+ * the atoms stream through memory, and each atom's label is a two byte id into the AtomLabels of
+ * the trajectory it came from, which must outlive the molecule.
+ */
 class Molecule
 {
   public:
-    Molecule()
+    Molecule(AtomLabels *labels) : _labels(labels)
     {
     }
-    ~Molecule()
+
+    void reserve(int numAtoms)
     {
+        _x.reserve(numAtoms);
+        _y.reserve(numAtoms);
+        _z.reserve(numAtoms);
+        _elements.reserve(numAtoms);
     }
-
-    void addAtom(AtomEntry *atom)
+    void addAtom(quint32 element, double x, double y, double z)
+    {
+        _elements.push_back(element);
+        _x.push_back(x);
+        _y.push_back(y);
+        _z.push_back(z);
+    }
+    void addAtom(const QString &label, double x, double y, double z)
+    {
+        addAtom(_labels->id(label), x, y, z);
+    }
+    // Replaces the atoms with copies of the arrays given
+    void setAtoms(int numAtoms, const quint32 *elements, const double *x, const double *y,
+                  const double *z)
     {
-        _molecule.push_back(atom);
+        _elements.assign(elements, elements + numAtoms);
+        _x.assign(x, x + numAtoms);
+        _y.assign(y, y + numAtoms);
+        _z.assign(z, z + numAtoms);
     }
     void setComment(QString c)
     {
         _comment = c;
     }
-    std::vector<AtomEntry *> &atomsList()
+    const QString &comment() const
     {
-        return _molecule;
+        return _comment;
     }
     int numAtoms() const
     {
-        return _molecule.size();
+        return _elements.size();
+    }
+    quint32 element(int atom) const
+    {
+        return _elements[atom];
+    }
+    QString label(int atom) const
+    {
+        return _labels->label(_elements[atom]);
+    }
+    double x(int atom) const
+    {
+        return _x[atom];
+    }
+    double y(int atom) const
+    {
+        return _y[atom];
+    }
+    double z(int atom) const
+    {
+        return _z[atom];
+    }
+    const double *xData() const
+    {
+        return _x.data();
+    }
+    const double *yData() const
+    {
+        return _y.data();
+    }
+    const double *zData() const
+    {
+        return _z.data();
+    }
+    const quint32 *elementData() const
+    {
+        return _elements.data();
     }
 
     void serialize(QXmlStreamWriter *writer)
     {
         writer->writeStartElement("Molecule");
-        writer->writeAttribute("items", QString("%1").arg(_molecule.size()));
+        writer->writeAttribute("items", QString("%1").arg(numAtoms()));
         writer->writeAttribute("comment", _comment);
-        foreach (AtomEntry *a, _molecule) {
+        for (int i = 0; i < numAtoms(); i++) {
             writer->writeStartElement("AtomEntry");
-            writer->writeAttribute("label", a->Label);
-            writer->writeAttribute("x", QString("%1").arg(a->x));
-            writer->writeAttribute("y", QString("%1").arg(a->y));
-            writer->writeAttribute("z", QString("%1").arg(a->z));
+            writer->writeAttribute("label", label(i));
+            writer->writeAttribute("x", QString("%1").arg(_x[i]));
+            writer->writeAttribute("y", QString("%1").arg(_y[i]));
+            writer->writeAttribute("z", QString("%1").arg(_z[i]));
             writer->writeEndElement();
         }
         writer->writeEndElement();
     };
 
-    static Molecule *deserialize(QXmlStreamReader *reader)
+    static Molecule *deserialize(QXmlStreamReader *reader, AtomLabels *labels)
     {
         reader->readNextStartElement();
         Q_ASSERT(reader->isStartElement() && reader->name() == "Molecule");
 
-        Molecule *m = new Molecule();
+        Molecule *m = new Molecule(labels);
         int size = reader->attributes().value("items").toString().toInt();
+        m->reserve(size);
         for (int i = 0; i < size; i++) {
             reader->readNextStartElement();
             Q_ASSERT(reader->isStartElement() && reader->name().toString() == "AtomEntry");
 
-            AtomEntry *a = new AtomEntry();
-            a->Label = reader->attributes().value("label").toString();
-            a->x = reader->attributes().value("x").toString().toDouble();
-            a->y = reader->attributes().value("y").toString().toDouble();
-            a->z = reader->attributes().value("z").toString().toDouble();
-            m->addAtom(a);
+            m->addAtom(reader->attributes().value("label").toString(),
+                       reader->attributes().value("x").toString().toDouble(),
+                       reader->attributes().value("y").toString().toDouble(),
+                       reader->attributes().value("z").toString().toDouble());
             reader->skipCurrentElement();
         }
         reader->skipCurrentElement();
@@ -80,7 +181,11 @@ class Molecule
     };
 
   private:
-    std::vector<AtomEntry *> _molecule;
+    AtomLabels *_labels;
+    std::vector<double> _x;
+    std::vector<double> _y;
+    std::vector<double> _z;
+    std::vector<quint32> _elements;
     QString _comment;
 };
 
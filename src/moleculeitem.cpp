@@ -0,0 +1,358 @@
+#include "moleculeitem.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+// The radix sort looks at this many bits of the depth at a time
+#define RADIX_BITS 16
+// The picking grid is never allowed more than this many cells per atom
+#define MAX_CELLS_PER_ATOM 4
+
+// Maps a depth onto an integer that sorts in the same order: positive numbers just need the sign
+// bit setting, but negative ones count the wrong way and have to be flipped
+static quint64 depthKey(double z)
+{
+    quint64 bits;
+    memcpy(&bits, &z, sizeof(bits));
+    return (bits >> 63) ? ~bits : bits | (Q_UINT64_C(1) << 63);
+}
+
+static bool lineIntersectsRect(const QLineF &line, const QRectF &rect)
+{
+    if (rect.contains(line.p1()) || rect.contains(line.p2())) {
+        return true;
+    }
+    QLineF edges[4] = {QLineF(rect.topLeft(), rect.topRight()),
+                       QLineF(rect.topRight(), rect.bottomRight()),
+                       QLineF(rect.bottomRight(), rect.bottomLeft()),
+                       QLineF(rect.bottomLeft(), rect.topLeft())};
+    for (int edge = 0; edge < 4; ++edge) {
+        if (line.intersect(edges[edge], 0) == QLineF::BoundedIntersection) {
+            return true;
+        }
+    }
+    return false;
+}
+
+MoleculeItem::MoleculeItem(const QList<Atom *> &atoms, const QList<Bond *> &bonds,
+                           QGraphicsItem *parent)
+    : QGraphicsItem(parent), myAtoms(atoms.toVector()), myBonds(bonds.toVector()),
+      myCellSize(1.0), myCellsX(0), myCellsY(0)
+{
+    // The exposed rectangle is needed to skip the atoms that are out of sight
+    setFlag(QGraphicsItem::ItemUsesExtendedStyleOption, true);
+    // The annotations always sit on top of the molecule
+    setZValue(-std::numeric_limits<qreal>::max());
+    updateLayout();
+}
+
+QRectF MoleculeItem::boundingRect() const
+{
+    return myBoundingRect;
+}
+
+void MoleculeItem::paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget)
+{
+    const QRectF &exposed = option->exposedRect;
+    QTransform transform = painter->transform();
+    int numAtoms = myAtoms.size();
+    foreach (int index, myDrawOrder) {
+        if (index < numAtoms) {
+            Atom *atom = myAtoms[index];
+            QPointF pos = atom->pos();
+            if (!exposed.intersects(atom->boundingRect().translated(pos))) {
+                continue;
+            }
+            // Each atom is drawn in its own coordinates, just as the scene would have done
+            painter->setTransform(QTransform::fromTranslate(pos.x(), pos.y()) * transform);
+            atom->paint(painter, option, widget);
+        } else {
+            Bond *bond = myBonds[index - numAtoms];
+            if (!exposed.intersects(bond->boundingRect())) {
+                continue;
+            }
+            painter->setTransform(transform);
+            bond->paint(painter, option, widget);
+        }
+    }
+    painter->setTransform(transform);
+}
+
+QList<QGraphicsItem *> MoleculeItem::drawOrder() const
+{
+    QList<QGraphicsItem *> items;
+    int numAtoms = myAtoms.size();
+    foreach (int index, myDrawOrder) {
+        if (index < numAtoms) {
+            items.append(myAtoms[index]);
+        } else {
+            items.append(myBonds[index - numAtoms]);
+        }
+    }
+    return items;
+}
+
+void MoleculeItem::addBond(Bond *bond)
+{
+    myBonds.append(bond);
+    updateLayout();
+}
+
+void MoleculeItem::removeItems(const QList<QGraphicsItem *> &items)
+{
+    QSet<QGraphicsItem *> removed = items.toSet();
+    QVector<Atom *> atoms;
+    foreach (Atom *atom, myAtoms) {
+        if (!removed.contains(atom)) {
+            atoms.append(atom);
+        }
+    }
+    QVector<Bond *> bonds;
+    foreach (Bond *bond, myBonds) {
+        if (!removed.contains(bond)) {
+            bonds.append(bond);
+        }
+    }
+    myAtoms.swap(atoms);
+    myBonds.swap(bonds);
+    updateLayout();
+}
+
+void MoleculeItem::addItems(const QList<QGraphicsItem *> &items)
+{
+    foreach (QGraphicsItem *item, items) {
+        if (item->type() == Atom::Type) {
+            myAtoms.append(qgraphicsitem_cast<Atom *>(item));
+        } else if (item->type() == Bond::Type) {
+            myBonds.append(qgraphicsitem_cast<Bond *>(item));
+        }
+    }
+    updateLayout();
+}
+
+void MoleculeItem::updateItem(QGraphicsItem *item)
+{
+    // The atoms and bonds have no parent, so their positions are already in our coordinates
+    update(item->boundingRect().translated(item->pos()));
+}
+
+void MoleculeItem::updateLayout()
+{
+    QRectF bounds;
+    foreach (Atom *atom, myAtoms) {
+        bounds |= atom->boundingRect().translated(atom->pos());
+    }
+    foreach (Bond *bond, myBonds) {
+        bounds |= bond->boundingRect();
+    }
+    // This is the one change to the scene's index per refresh, and only if the molecule grew
+    if (bounds != myBoundingRect) {
+        prepareGeometryChange();
+        myBoundingRect = bounds;
+    }
+    sortByDepth();
+    buildGrid();
+    update();
+}
+
+void MoleculeItem::sortByDepth()
+{
+    int numAtoms = myAtoms.size();
+    int numItems = numAtoms + myBonds.size();
+    QVector<quint64> keys(numItems);
+    QVector<int> order(numItems);
+    for (int i = 0; i < numAtoms; ++i) {
+        keys[i] = depthKey(myAtoms[i]->zValue());
+        order[i] = i;
+    }
+    for (int i = numAtoms; i < numItems; ++i) {
+        keys[i] = depthKey(myBonds[i - numAtoms]->zValue());
+        order[i] = i;
+    }
+
+    // A least significant digit first radix sort, which is stable, so items at the same depth
+    // keep the order the scene would have drawn them in
+    const quint64 mask = (1 << RADIX_BITS) - 1;
+    QVector<quint64> sortedKeys(numItems);
+    QVector<int> sortedOrder(numItems);
+    QVector<int> start(1 << RADIX_BITS);
+    for (int shift = 0; shift < 64 && numItems; shift += RADIX_BITS) {
+        start.fill(0);
+        for (int i = 0; i < numItems; ++i) {
+            ++start[(keys[i] >> shift) & mask];
+        }
+        // A digit that's the same for everything can't change the order
+        if (start[(keys[0] >> shift) & mask] == numItems) {
+            continue;
+        }
+        int total = 0;
+        for (int digit = 0; digit <= int(mask); ++digit) {
+            int count = start[digit];
+            start[digit] = total;
+            total += count;
+        }
+        for (int i = 0; i < numItems; ++i) {
+            int position = start[(keys[i] >> shift) & mask]++;
+            sortedKeys[position] = keys[i];
+            sortedOrder[position] = order[i];
+        }
+        keys.swap(sortedKeys);
+        order.swap(sortedOrder);
+    }
+    myDrawOrder = order;
+}
+
+void MoleculeItem::buildGrid()
+{
+    int numAtoms = myAtoms.size();
+    myCellsX = myCellsY = 0;
+    myCellStart.clear();
+    myCellAtoms.clear();
+    if (numAtoms == 0) {
+        return;
+    }
+
+    // Atoms with a NaN or infinite coordinate can't be placed in a cell, and would stop the cell
+    // size below from ever settling, so they're left out; nothing can be found under them anyway
+    double xMin = 0.0, xMax = 0.0, yMin = 0.0, yMax = 0.0;
+    double maxRadius = 0.0;
+    int numPlaced = 0;
+    foreach (Atom *atom, myAtoms) {
+        QPointF pos = atom->pos();
+        if (!std::isfinite(pos.x()) || !std::isfinite(pos.y())) {
+            continue;
+        }
+        if (numPlaced++ == 0) {
+            xMin = xMax = pos.x();
+            yMin = yMax = pos.y();
+        }
+        xMin = std::min(xMin, pos.x());
+        xMax = std::max(xMax, pos.x());
+        yMin = std::min(yMin, pos.y());
+        yMax = std::max(yMax, pos.y());
+        maxRadius = std::max(maxRadius, atom->effectiveRadius());
+    }
+    if (numPlaced == 0) {
+        return;
+    }
+
+    // No atom reaches further than its radius, so anything under a point is centered either in
+    // that point's cell or one of the eight around it
+    myCellSize = std::max(maxRadius, 1e-3);
+    double cellsX, cellsY;
+    for (;;) {
+        cellsX = std::floor((xMax - xMin) / myCellSize) + 1.0;
+        cellsY = std::floor((yMax - yMin) / myCellSize) + 1.0;
+        if (cellsX * cellsY <= double(MAX_CELLS_PER_ATOM) * numPlaced) {
+            break;
+        }
+        myCellSize *= 2.0;
+    }
+    myCellsX = static_cast<int>(cellsX);
+    myCellsY = static_cast<int>(cellsY);
+    myGridOrigin = QPointF(xMin, yMin);
+
+    // A counting sort of the atoms by cell; myCellStart[c] is where cell c's atoms begin
+    int numCells = myCellsX * myCellsY;
+    QVector<int> cellOf(numAtoms, -1);
+    myCellStart.fill(0, numCells + 1);
+    for (int i = 0; i < numAtoms; ++i) {
+        QPointF pos = myAtoms[i]->pos();
+        if (!std::isfinite(pos.x()) || !std::isfinite(pos.y())) {
+            continue;
+        }
+        int cx = static_cast<int>((pos.x() - xMin) / myCellSize);
+        int cy = static_cast<int>((pos.y() - yMin) / myCellSize);
+        cellOf[i] = cellIndex(cx, cy);
+        ++myCellStart[cellOf[i] + 1];
+    }
+    for (int c = 0; c < numCells; ++c) {
+        myCellStart[c + 1] += myCellStart[c];
+    }
+    myCellAtoms.resize(numPlaced);
+    QVector<int> next(myCellStart);
+    for (int i = 0; i < numAtoms; ++i) {
+        if (cellOf[i] >= 0) {
+            myCellAtoms[next[cellOf[i]]++] = i;
+        }
+    }
+}
+
+Atom *MoleculeItem::atomAt(const QPointF &pos) const
+{
+    if (myCellStart.isEmpty()) {
+        return 0;
+    }
+    int cx = static_cast<int>(std::floor((pos.x() - myGridOrigin.x()) / myCellSize));
+    int cy = static_cast<int>(std::floor((pos.y() - myGridOrigin.y()) / myCellSize));
+    Atom *picked = 0;
+    for (int y = std::max(cy - 1, 0); y <= std::min(cy + 1, myCellsY - 1); ++y) {
+        for (int x = std::max(cx - 1, 0); x <= std::min(cx + 1, myCellsX - 1); ++x) {
+            int cell = cellIndex(x, y);
+            for (int n = myCellStart[cell]; n < myCellStart[cell + 1]; ++n) {
+                Atom *atom = myAtoms[myCellAtoms[n]];
+                QPointF d = pos - atom->pos();
+                double r = atom->effectiveRadius();
+                // The one nearest the viewer wins, as it's the one drawn on top
+                if (d.x() * d.x() + d.y() * d.y() <= r * r &&
+                    (picked == 0 || atom->zValue() > picked->zValue())) {
+                    picked = atom;
+                }
+            }
+        }
+    }
+    return picked;
+}
+
+QGraphicsItem *MoleculeItem::itemAt(const QPointF &pos) const
+{
+    Atom *atom = atomAt(pos);
+    if (atom != 0) {
+        return atom;
+    }
+    // Clicking on a bond is rare enough that it's not worth indexing them too
+    Bond *picked = 0;
+    foreach (Bond *bond, myBonds) {
+        if (bond->contains(pos) && (picked == 0 || bond->zValue() > picked->zValue())) {
+            picked = bond;
+        }
+    }
+    return picked;
+}
+
+QList<Atom *> MoleculeItem::atomsIn(const QRectF &rect) const
+{
+    QList<Atom *> atoms;
+    if (myCellStart.isEmpty()) {
+        return atoms;
+    }
+    int xFirst = static_cast<int>(std::floor((rect.left() - myGridOrigin.x()) / myCellSize)) - 1;
+    int xLast = static_cast<int>(std::floor((rect.right() - myGridOrigin.x()) / myCellSize)) + 1;
+    int yFirst = static_cast<int>(std::floor((rect.top() - myGridOrigin.y()) / myCellSize)) - 1;
+    int yLast = static_cast<int>(std::floor((rect.bottom() - myGridOrigin.y()) / myCellSize)) + 1;
+    for (int y = std::max(yFirst, 0); y <= std::min(yLast, myCellsY - 1); ++y) {
+        for (int x = std::max(xFirst, 0); x <= std::min(xLast, myCellsX - 1); ++x) {
+            int cell = cellIndex(x, y);
+            for (int n = myCellStart[cell]; n < myCellStart[cell + 1]; ++n) {
+                Atom *atom = myAtoms[myCellAtoms[n]];
+                if (rect.intersects(atom->boundingRect().translated(atom->pos()))) {
+                    atoms.append(atom);
+                }
+            }
+        }
+    }
+    return atoms;
+}
+
+QList<Bond *> MoleculeItem::bondsIn(const QRectF &rect) const
+{
+    QList<Bond *> bonds;
+    foreach (Bond *bond, myBonds) {
+        if (lineIntersectsRect(bond->line(), rect)) {
+            bonds.append(bond);
+        }
+    }
+    return bonds;
+}
@@ -0,0 +1,82 @@
+#ifndef MOLECULEITEM_H_
+#define MOLECULEITEM_H_
+
+#include <QGraphicsItem>
+#include <QList>
+#include <QVector>
+#include <QtGui>
+
+#include "atom.h"
+#include "bond.h"
+#include "defines.h"
+#include "drawinginfo.h"
+
+/*
+ * Draws a whole molecule as a single scene item, for systems too large to give every atom and
+ * bond an item of its own.  The atoms and bonds are still created, and hold their own appearance
+ * and selection state, but they're never added to the scene; this item sorts them by depth and
+ * paints them all in one go, and keeps its own grid of the atoms for finding what's under the
+ * cursor.  Labels, angle markers and the rest of the annotations remain ordinary scene items.
+ */
+class MoleculeItem : public QGraphicsItem
+{
+  public:
+    enum { Type = UserType + MOLECULEITEMTYPE };
+    int type() const
+    {
+        return Type;
+    }
+
+    MoleculeItem(const QList<Atom *> &atoms, const QList<Bond *> &bonds,
+                 QGraphicsItem *parent = 0);
+
+    QRectF boundingRect() const;
+    void paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget = 0);
+
+    void addBond(Bond *bond);
+    // Takes atoms and bonds out of the molecule, as deleting them does, and puts them back
+    void removeItems(const QList<QGraphicsItem *> &items);
+    void addItems(const QList<QGraphicsItem *> &items);
+    const QVector<Atom *> &atoms() const
+    {
+        return myAtoms;
+    }
+    const QVector<Bond *> &bonds() const
+    {
+        return myBonds;
+    }
+    // Repaints just the part of the molecule covered by one of its atoms or bonds
+    void updateItem(QGraphicsItem *item);
+    // Called once the atoms and bonds have been moved, to redo the depth order and the grid
+    void updateLayout();
+
+    Atom *atomAt(const QPointF &pos) const;
+    QGraphicsItem *itemAt(const QPointF &pos) const;
+    QList<Atom *> atomsIn(const QRectF &rect) const;
+    QList<Bond *> bondsIn(const QRectF &rect) const;
+    // The atoms and bonds, back to front, as they're drawn
+    QList<QGraphicsItem *> drawOrder() const;
+
+  protected:
+    void sortByDepth();
+    void buildGrid();
+    int cellIndex(int cx, int cy) const
+    {
+        return cy * myCellsX + cx;
+    }
+
+    QVector<Atom *> myAtoms;
+    QVector<Bond *> myBonds;
+    QRectF myBoundingRect;
+    // The order to draw in, back to front: indices below myAtoms.size() are atoms, the rest bonds
+    QVector<int> myDrawOrder;
+    // The atoms, sorted by the grid cell their centers fall in
+    QVector<int> myCellStart;
+    QVector<int> myCellAtoms;
+    QPointF myGridOrigin;
+    double myCellSize;
+    int myCellsX;
+    int myCellsY;
+};
+
+#endif /*MOLECULEITEM_H_*/
@@ -0,0 +1,20 @@
+#include "parserthread.h"
+
+ParserThread::ParserThread(FileParser *parser, QObject *parent)
+    : QThread(parent), myParser(parser)
+{
+}
+
+void ParserThread::run()
+{
+    myParser->indexFrames();
+}
+
+CacheThread::CacheThread(FileParser *parser, QObject *parent) : QThread(parent), myParser(parser)
+{
+}
+
+void CacheThread::run()
+{
+    myParser->writeCache();
+}
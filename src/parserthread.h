@@ -0,0 +1,37 @@
+#ifndef PARSERTHREAD_H
+#define PARSERTHREAD_H
+
+#include "fileparser.h"
+#include <QThread>
+
+// Finds the frames in a file opened by the parser, without holding up the GUI
+class ParserThread : public QThread
+{
+    Q_OBJECT
+
+  public:
+    ParserThread(FileParser *parser, QObject *parent = 0);
+
+  protected:
+    void run();
+
+  private:
+    FileParser *myParser;
+};
+
+// Saves the frames of a file that's been indexed to its cache, once they're on display
+class CacheThread : public QThread
+{
+    Q_OBJECT
+
+  public:
+    CacheThread(FileParser *parser, QObject *parent = 0);
+
+  protected:
+    void run();
+
+  private:
+    FileParser *myParser;
+};
+
+#endif // PARSERTHREAD_H
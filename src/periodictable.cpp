@@ -0,0 +1,69 @@
+#include "periodictable.h"
+
+// Symbols are one or two letters, so each has a slot in a table indexed by its letters
+#define SYMBOL_SLOTS (26 * 27)
+
+static int symbolSlot(char first, char second)
+{
+    first |= 0x20;
+    second |= 0x20;
+    if (first < 'a' || first > 'z') {
+        return -1;
+    }
+    if (second == 0x20) {
+        // No second letter
+        return (first - 'a') * 27;
+    }
+    if (second < 'a' || second > 'z') {
+        return -1;
+    }
+    return (first - 'a') * 27 + (second - 'a') + 1;
+}
+
+namespace
+{
+struct SymbolTable {
+    signed char atomicNumbers[SYMBOL_SLOTS];
+
+    SymbolTable()
+    {
+        for (int slot = 0; slot < SYMBOL_SLOTS; ++slot) {
+            atomicNumbers[slot] = -1;
+        }
+        for (int z = 0; z < PeriodicTable::NumElements; ++z) {
+            const char *symbol = periodicTable[z].symbol;
+            atomicNumbers[symbolSlot(symbol[0], symbol[1] ? symbol[1] : ' ')] = z;
+        }
+    }
+};
+}
+
+int PeriodicTable::atomicNumber(const char *begin, const char *end)
+{
+    static const SymbolTable table;
+    int slot;
+    if (end - begin == 1) {
+        slot = symbolSlot(begin[0], ' ');
+    } else if (end - begin == 2) {
+        slot = symbolSlot(begin[0], begin[1]);
+    } else {
+        return -1;
+    }
+    return slot < 0 ? -1 : table.atomicNumbers[slot];
+}
+
+int PeriodicTable::atomicNumber(const QString &symbol)
+{
+    if (symbol.size() < 1 || symbol.size() > 2) {
+        return -1;
+    }
+    char text[2];
+    for (int i = 0; i < symbol.size(); ++i) {
+        ushort c = symbol[i].unicode();
+        if (c > 0x7f) {
+            return -1;
+        }
+        text[i] = char(c);
+    }
+    return atomicNumber(text, text + symbol.size());
+}
@@ -0,0 +1,150 @@
+#ifndef PERIODICTABLE_H_
+#define PERIODICTABLE_H_
+
+#include <QString>
+
+struct Element {
+    const char *symbol;
+    // Used to size the atoms and decide what's bonded
+    double radius;
+    double mass;
+    unsigned char red;
+    unsigned char green;
+    unsigned char blue;
+};
+
+/*
+ * Everything cheMVP knows about each element, indexed by atomic number; element 0 is the dummy
+ * atom X.  The masses were all "borrowed" from PSI3's masses.h file.  After Xe everything looks
+ * the same anyway, so 1.44 is used as the radius of the mega heavy atoms.
+ */
+constexpr Element periodicTable[] = {
+    {"X", 0.00, 0.000000000, 255, 20, 147},
+    {"H", 0.30, 1.007825032, 255, 255, 255},
+    {"He", 0.93, 4.002603254, 217, 255, 255},
+    {"Li", 1.23, 7.016004548, 204, 128, 255},
+    {"Be", 0.90, 9.012182201, 194, 255, 0},
+    {"B", 0.82, 11.009305406, 255, 181, 181},
+    {"C", 0.77, 12.000000000, 144, 144, 144},
+    {"N", 0.75, 14.003074005, 40, 80, 248},
+    {"O", 0.73, 15.994914620, 255, 13, 13},
+    {"F", 0.72, 18.998403224, 144, 224, 80},
+    {"Ne", 0.71, 19.992440175, 179, 227, 245},
+    {"Na", 1.54, 22.989769281, 171, 92, 242},
+    {"Mg", 1.36, 23.985041699, 138, 255, 0},
+    {"Al", 1.18, 26.981538627, 191, 166, 166},
+    {"Si", 1.11, 27.976926532, 240, 200, 160},
+    {"P", 1.06, 30.973761629, 255, 128, 0},
+    {"S", 1.02, 31.972070999, 255, 255, 48},
+    {"Cl", 0.99, 34.968852682, 31, 240, 31},
+    {"Ar", 0.98, 39.962383123, 128, 209, 227},
+    {"K", 2.03, 38.963706679, 143, 64, 212},
+    {"Ca", 1.74, 39.962590983, 61, 255, 0},
+    {"Sc", 1.44, 44.955911909, 230, 230, 230},
+    {"Ti", 1.32, 47.947946281, 191, 194, 199},
+    {"V", 1.22, 50.943959507, 166, 166, 171},
+    {"Cr", 1.18, 51.940507472, 138, 153, 199},
+    {"Mn", 1.17, 54.938045141, 156, 122, 199},
+    {"Fe", 1.17, 55.934937475, 224, 102, 51},
+    {"Co", 1.16, 58.933195048, 240, 144, 160},
+    {"Ni", 1.15, 57.935342907, 80, 208, 80},
+    {"Cu", 1.17, 62.929597474, 200, 128, 51},
+    {"Zn", 1.25, 63.929142222, 125, 128, 176},
+    {"Ga", 1.26, 68.925573587, 194, 143, 143},
+    {"Ge", 1.22, 73.921177767, 102, 143, 143},
+    {"As", 1.20, 74.921596478, 189, 128, 227},
+    {"Se", 1.16, 79.916521271, 255, 161, 0},
+    {"Br", 1.14, 78.918337087, 166, 41, 41},
+    {"Kr", 1.12, 85.910610729, 92, 184, 209},
+    {"Rb", 2.16, 84.911789737, 112, 46, 176},
+    {"Sr", 1.91, 87.905612124, 0, 255, 0},
+    {"Y", 1.62, 88.905848295, 148, 255, 255},
+    {"Zr", 1.45, 89.904704416, 148, 224, 224},
+    {"Nb", 1.34, 92.906378058, 115, 194, 201},
+    {"Mo", 1.30, 97.905408169, 84, 181, 181},
+    {"Tc", 1.27, 98.906254747, 59, 158, 158},
+    {"Ru", 1.25, 101.904349312, 36, 143, 143},
+    {"Rh", 1.25, 102.905504292, 10, 125, 140},
+    {"Pd", 1.28, 105.903485715, 0, 105, 133},
+    {"Ag", 1.34, 106.90509682, 192, 192, 192},
+    {"Cd", 1.48, 113.90335854, 255, 217, 143},
+    {"In", 1.44, 114.903878484, 166, 117, 115},
+    {"Sn", 1.41, 119.902194676, 102, 128, 128},
+    {"Sb", 1.40, 120.903815686, 158, 99, 181},
+    {"Te", 1.36, 129.906224399, 212, 122, 0},
+    {"I", 1.33, 126.904472681, 148, 0, 148},
+    {"Xe", 1.31, 131.904153457, 66, 158, 176},
+    {"Cs", 1.44, 132.905451932, 87, 23, 143},
+    {"Ba", 1.44, 137.905247237, 0, 201, 0},
+    {"La", 1.44, 138.906353267, 112, 212, 255},
+    {"Ce", 1.44, 139.905438706, 255, 255, 199},
+    {"Pr", 1.44, 140.907652769, 217, 255, 199},
+    {"Nd", 1.44, 144.912749023, 199, 255, 199},
+    {"Pm", 1.44, 151.919732425, 163, 255, 199},
+    {"Sm", 1.44, 152.921230339, 143, 255, 199},
+    {"Eu", 1.44, 157.924103912, 97, 255, 199},
+    {"Gd", 1.44, 158.925346757, 69, 255, 199},
+    {"Tb", 1.44, 163.929174751, 48, 255, 199},
+    {"Dy", 1.44, 164.93032207, 31, 255, 199},
+    {"Ho", 1.44, 165.930293061, 0, 255, 156},
+    {"Er", 1.44, 168.93421325, 0, 230, 117},
+    {"Tm", 1.44, 173.938862089, 0, 212, 82},
+    {"Yb", 1.44, 174.940771819, 0, 191, 56},
+    {"Lu", 1.44, 179.946549953, 0, 171, 36},
+    {"Hf", 1.44, 180.947995763, 77, 194, 255},
+    {"Ta", 1.44, 183.950931188, 77, 166, 255},
+    {"W", 1.44, 186.955753109, 33, 148, 214},
+    {"Re", 1.44, 191.96148069, 38, 125, 171},
+    {"Os", 1.44, 192.96292643, 38, 102, 150},
+    {"Ir", 1.44, 194.964791134, 23, 84, 135},
+    {"Pt", 1.44, 196.966568662, 208, 208, 224},
+    {"Au", 1.44, 201.970643011, 255, 209, 35},
+    {"Hg", 1.44, 204.974427541, 184, 184, 208},
+    {"Tl", 1.44, 207.976652071, 166, 84, 77},
+    {"Pb", 1.44, 208.980398734, 87, 89, 97},
+    {"Bi", 1.44, 208.982430435, 158, 79, 181},
+    {"Po", 1.44, 210.987496271, 171, 92, 0},
+    {"At", 1.44, 222.017577738, 117, 79, 69},
+    {"Rn", 1.44, 222.01755173, 66, 130, 150},
+    {"Fr", 1.44, 228.031070292, 66, 0, 102},
+    {"Ra", 1.44, 227.027752127, 0, 125, 0},
+    {"Ac", 1.44, 232.038055325, 112, 171, 250},
+    {"Th", 1.44, 231.03588399, 0, 186, 255},
+    {"Pa", 1.44, 238.050788247, 0, 161, 255},
+    {"U", 1.44, 237.048173444, 0, 143, 255},
+    {"Np", 1.44, 242.058742611, 0, 128, 255},
+    {"Pu", 1.44, 243.06138108, 0, 107, 255},
+    {"Am", 1.44, 247.07035354, 84, 92, 242},
+    {"Cm", 1.44, 247.07030708, 120, 92, 227},
+    {"Bk", 1.44, 251.079586788, 138, 79, 227},
+    {"Cf", 1.44, 252.082978512, 161, 54, 212},
+    {"Es", 1.44, 257.095104724, 179, 31, 212},
+    {"Fm", 1.44, 258.098431319, 179, 31, 186},
+    {"Md", 1.44, 255.093241131, 179, 13, 166},
+    {"No", 1.44, 260.105504, 189, 13, 135},
+    {"Lr", 1.44, 263.112547, 199, 0, 102},
+    {"Rf", 1.44, 255.107398, 204, 0, 89},
+    {"Db", 1.44, 259.114500, 209, 0, 79},
+    {"Sg", 1.44, 262.122892, 217, 0, 69},
+    {"Bh", 1.44, 263.128558, 224, 0, 56},
+    {"Hs", 1.44, 265.136151, 230, 0, 46},
+    {"Mt", 1.44, 281.162061, 235, 0, 38},
+    {"Ds", 1.44, 272.153615, 183, 189, 199},
+    {"Rg", 1.44, 283.171792, 183, 189, 199},
+};
+
+class PeriodicTable
+{
+  public:
+    enum { NumElements = sizeof(periodicTable) / sizeof(periodicTable[0]) };
+
+    static const Element &element(int atomicNumber)
+    {
+        return periodicTable[atomicNumber];
+    }
+    // The atomic number of the symbol in [begin, end), without regard to case, or -1
+    static int atomicNumber(const char *begin, const char *end);
+    static int atomicNumber(const QString &symbol);
+};
+
+#endif /*PERIODICTABLE_H_*/
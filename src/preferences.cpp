@@ -4,7 +4,7 @@ Preferences::Preferences(DrawingCanvas *d, int s)
 {
     _canvas = d;
     _drawingStyle = s;
-    _colorChanges = Atom::labelToColor;
+    _colorChanges = Atom::colorOverrides;
 
     _listWidget = new QListWidget();
     _listWidget->addItem(tr("Atom Colors"));
@@ -50,7 +50,7 @@ Preferences::Preferences(DrawingCanvas *d, int s)
 void Preferences::revert()
 {
     if (_listWidget->currentRow() == 0) {
-        _colorChanges = Atom::labelToColor;
+        _colorChanges = Atom::colorOverrides;
         _canvas->updateAtomColors(_colorChanges);
     }
 }
@@ -58,8 +58,8 @@ void Preferences::revert()
 void Preferences::restoreDefaults()
 {
     if (_listWidget->currentRow() == 0) {
-        Atom::fillLabelToColorMap();
-        _colorChanges = Atom::labelToColor;
+        Atom::colorOverrides.clear();
+        _colorChanges.clear();
         _canvas->updateAtomColors(_colorChanges);
         savePreferences();
         foreach (QToolButton *b, _atomButtons) {
@@ -71,12 +71,12 @@ void Preferences::restoreDefaults()
 
 void Preferences::savePreferences()
 {
-    Atom::labelToColor = _colorChanges;
+    Atom::colorOverrides = _colorChanges;
     foreach (Atom *a, _canvas->getAtoms()) {
         a->setDrawingStyle(DrawingInfo::DrawingStyle(_drawingStyle));
     }
     QSettings settings;
-    settings.setValue("Default Atom Colors", Atom::labelToColor);
+    settings.setValue("Default Atom Colors", Atom::colorOverrides);
 }
 
 QToolButton *Preferences::makeAtomButton(const char *label)
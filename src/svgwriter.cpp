@@ -0,0 +1,316 @@
+#include "svgwriter.h"
+
+#include <QFile>
+#include <QGuiApplication>
+#include <QScreen>
+#include <QStringList>
+
+#include "anglemarker.h"
+#include "arrow.h"
+#include "atom.h"
+#include "bond.h"
+#include "label.h"
+#include "moleculeitem.h"
+
+SvgWriter::SvgWriter(QGraphicsScene *scene, const QSize &size) : myScene(scene), mySize(size)
+{
+}
+
+bool SvgWriter::write(const QString &fileName)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        return false;
+    }
+    collectItems();
+
+    // One element to a line, but no indentation, which would only make the file bigger
+    myXml.setDevice(&file);
+    myXml.setAutoFormatting(true);
+    myXml.setAutoFormattingIndent(0);
+    myXml.writeStartDocument();
+    myXml.writeStartElement("svg");
+    myXml.writeAttribute("xmlns", "http://www.w3.org/2000/svg");
+    myXml.writeAttribute("xmlns:xlink", "http://www.w3.org/1999/xlink");
+    myXml.writeAttribute("version", "1.1");
+    myXml.writeAttribute("width", QString::number(mySize.width()));
+    myXml.writeAttribute("height", QString::number(mySize.height()));
+    QRectF sceneRect = myScene->sceneRect();
+    myXml.writeAttribute("viewBox",
+                         QString("%1 %2 %3 %4")
+                             .arg(number(sceneRect.x()))
+                             .arg(number(sceneRect.y()))
+                             .arg(number(sceneRect.width()))
+                             .arg(number(sceneRect.height())));
+    // The background goes underneath everything, just as the scene paints it
+    QBrush background = myScene->backgroundBrush();
+    if (background.style() != Qt::NoBrush && background.color().alpha() != 0) {
+        myXml.writeEmptyElement("rect");
+        myXml.writeAttribute("x", number(sceneRect.x()));
+        myXml.writeAttribute("y", number(sceneRect.y()));
+        myXml.writeAttribute("width", number(sceneRect.width()));
+        myXml.writeAttribute("height", number(sceneRect.height()));
+        writeBrush(background);
+    }
+    writeDefinitions();
+    for (int i = 0; i < myItems.size(); ++i) {
+        writeItem(myItems[i].first, myItems[i].second);
+    }
+    myXml.writeEndElement();
+    myXml.writeEndDocument();
+    myXml.setDevice(0);
+
+    myItems.clear();
+    mySymbols.clear();
+    return !myXml.hasError() && file.error() == QFile::NoError;
+}
+
+void SvgWriter::collectItems()
+{
+    myItems.clear();
+    foreach (QGraphicsItem *item, myScene->items(Qt::AscendingOrder)) {
+        if (!item->isVisible()) {
+            continue;
+        }
+        if (item->type() == MoleculeItem::Type) {
+            // The molecule's atoms and bonds aren't in the scene, so they go in one at a time, in
+            // the order the molecule would draw them
+            QTransform transform = item->sceneTransform();
+            foreach (QGraphicsItem *child, static_cast<MoleculeItem *>(item)->drawOrder()) {
+                myItems.append(qMakePair(child, child->sceneTransform() * transform));
+            }
+        } else {
+            myItems.append(qMakePair(item, item->sceneTransform()));
+        }
+    }
+}
+
+void SvgWriter::writeDefinitions()
+{
+    myXml.writeStartElement("defs");
+    mySymbols.clear();
+    for (int i = 0; i < myItems.size(); ++i) {
+        if (myItems[i].first->type() != Atom::Type) {
+            continue;
+        }
+        Atom *atom = static_cast<Atom *>(myItems[i].first);
+        QString key = atom->svgSymbolKey();
+        if (!mySymbols.contains(key)) {
+            QString id = QString("atom%1").arg(mySymbols.size());
+            mySymbols.insert(key, id);
+            atom->writeSvgSymbol(this, id);
+        }
+    }
+    myXml.writeEndElement();
+}
+
+void SvgWriter::writeItem(QGraphicsItem *item, const QTransform &transform)
+{
+    int type = item->type();
+    if (type == Atom::Type) {
+        Atom *atom = static_cast<Atom *>(item);
+        atom->writeSvg(this, mySymbols.value(atom->svgSymbolKey()), transform.map(QPointF()));
+        return;
+    }
+    // Angles draw nothing themselves, and the arrows' drag boxes only show under the mouse
+    if (type != Bond::Type && type != AngleMarker::Type && type != Arrow::Type &&
+        type != Label::BondLabelType && type != Label::AngleLabelType &&
+        type != Label::TextLabelType) {
+        return;
+    }
+
+    // Everything else is written in its own coordinates, which are mostly the scene's anyway
+    bool grouped = !transform.isIdentity();
+    if (grouped) {
+        myXml.writeStartElement("g");
+        if (transform.type() == QTransform::TxTranslate) {
+            myXml.writeAttribute("transform",
+                                 QString("translate(%1 %2)")
+                                     .arg(number(transform.dx()))
+                                     .arg(number(transform.dy())));
+        } else {
+            myXml.writeAttribute("transform",
+                                 QString("matrix(%1 %2 %3 %4 %5 %6)")
+                                     .arg(number(transform.m11()))
+                                     .arg(number(transform.m12()))
+                                     .arg(number(transform.m21()))
+                                     .arg(number(transform.m22()))
+                                     .arg(number(transform.dx()))
+                                     .arg(number(transform.dy())));
+        }
+    }
+    if (type == Bond::Type) {
+        static_cast<Bond *>(item)->writeSvg(this);
+    } else if (type == AngleMarker::Type) {
+        static_cast<AngleMarker *>(item)->writeSvg(this);
+    } else if (type == Arrow::Type) {
+        static_cast<Arrow *>(item)->writeSvg(this);
+    } else {
+        static_cast<Label *>(item)->writeSvg(this);
+    }
+    if (grouped) {
+        myXml.writeEndElement();
+    }
+}
+
+void SvgWriter::writeLine(const QLineF &line, const QPen &pen)
+{
+    myXml.writeEmptyElement("line");
+    myXml.writeAttribute("x1", number(line.x1()));
+    myXml.writeAttribute("y1", number(line.y1()));
+    myXml.writeAttribute("x2", number(line.x2()));
+    myXml.writeAttribute("y2", number(line.y2()));
+    writePen(pen);
+}
+
+void SvgWriter::writePath(const QPainterPath &path, const QPen &pen, const QBrush &brush)
+{
+    myXml.writeEmptyElement("path");
+    myXml.writeAttribute("d", pathData(path));
+    writeBrush(brush);
+    writePen(pen);
+}
+
+void SvgWriter::writePolygon(const QPolygonF &polygon, const QPen &pen, const QBrush &brush)
+{
+    QStringList points;
+    foreach (const QPointF &point, polygon) {
+        points << number(point.x()) + "," + number(point.y());
+    }
+    myXml.writeEmptyElement("polygon");
+    myXml.writeAttribute("points", points.join(" "));
+    writeBrush(brush);
+    writePen(pen);
+}
+
+void SvgWriter::writeCircle(const QPointF &center, double radius, const QBrush &brush)
+{
+    myXml.writeEmptyElement("circle");
+    myXml.writeAttribute("cx", number(center.x()));
+    myXml.writeAttribute("cy", number(center.y()));
+    myXml.writeAttribute("r", number(radius));
+    writeBrush(brush);
+}
+
+void SvgWriter::writeText(const QPointF &position, const QString &text, const QFont &font,
+                          const QColor &color)
+{
+    myXml.writeStartElement("text");
+    myXml.writeAttribute("x", number(position.x()));
+    myXml.writeAttribute("y", number(position.y()));
+    myXml.writeAttribute("font-family", "'" + font.family() + "'");
+    myXml.writeAttribute("font-size", number(fontPixelSize(font)));
+    if (font.bold()) {
+        myXml.writeAttribute("font-weight", "bold");
+    }
+    if (font.italic()) {
+        myXml.writeAttribute("font-style", "italic");
+    }
+    if (font.underline()) {
+        myXml.writeAttribute("text-decoration", "underline");
+    }
+    writeColor("fill", color);
+    // Otherwise runs of spaces, and any at the ends, are dropped
+    if (text.contains("  ") || text.startsWith(' ') || text.endsWith(' ')) {
+        myXml.writeAttribute("xml:space", "preserve");
+    }
+    myXml.writeCharacters(text);
+    myXml.writeEndElement();
+}
+
+void SvgWriter::writeColor(const QString &attribute, const QColor &color)
+{
+    if (color.alpha() == 0) {
+        myXml.writeAttribute(attribute, "none");
+        return;
+    }
+    myXml.writeAttribute(attribute, color.name());
+    if (color.alpha() < 255) {
+        QString opacity = (attribute == "stop-color" ? QString("stop-opacity")
+                                                     : attribute + "-opacity");
+        myXml.writeAttribute(opacity, number(color.alphaF()));
+    }
+}
+
+void SvgWriter::writePen(const QPen &pen)
+{
+    if (pen.style() == Qt::NoPen || pen.color().alpha() == 0) {
+        myXml.writeAttribute("stroke", "none");
+        return;
+    }
+    writeColor("stroke", pen.color());
+    // Cosmetic pens are the same width however the scene's scaled
+    double width = pen.widthF();
+    if (width == 0.0) {
+        width = 1.0;
+    }
+    myXml.writeAttribute("stroke-width", number(width));
+    if (pen.isCosmetic()) {
+        myXml.writeAttribute("vector-effect", "non-scaling-stroke");
+    }
+    if (pen.capStyle() == Qt::SquareCap) {
+        myXml.writeAttribute("stroke-linecap", "square");
+    } else if (pen.capStyle() == Qt::RoundCap) {
+        myXml.writeAttribute("stroke-linecap", "round");
+    }
+    if (pen.joinStyle() == Qt::BevelJoin) {
+        myXml.writeAttribute("stroke-linejoin", "bevel");
+    } else if (pen.joinStyle() == Qt::RoundJoin) {
+        myXml.writeAttribute("stroke-linejoin", "round");
+    }
+    // Qt's dashes are in units of the pen's width
+    if (pen.style() != Qt::SolidLine) {
+        QStringList dashes;
+        foreach (qreal dash, pen.dashPattern()) {
+            dashes << number(dash * width);
+        }
+        myXml.writeAttribute("stroke-dasharray", dashes.join(","));
+        if (pen.dashOffset() != 0.0) {
+            myXml.writeAttribute("stroke-dashoffset", number(pen.dashOffset() * width));
+        }
+    }
+}
+
+void SvgWriter::writeBrush(const QBrush &brush)
+{
+    if (brush.style() == Qt::NoBrush) {
+        myXml.writeAttribute("fill", "none");
+    } else {
+        writeColor("fill", brush.color());
+    }
+}
+
+QString SvgWriter::number(double value)
+{
+    return QString::number(value, 'g', 6);
+}
+
+QString SvgWriter::pathData(const QPainterPath &path)
+{
+    QString data;
+    for (int i = 0; i < path.elementCount(); ++i) {
+        const QPainterPath::Element &element = path.elementAt(i);
+        if (element.type == QPainterPath::MoveToElement) {
+            data += "M";
+        } else if (element.type == QPainterPath::LineToElement) {
+            data += "L";
+        } else if (element.type == QPainterPath::CurveToElement) {
+            data += "C";
+        } else {
+            data += " ";
+        }
+        data += number(element.x) + " " + number(element.y);
+    }
+    return data;
+}
+
+double SvgWriter::fontPixelSize(const QFont &font)
+{
+    if (font.pixelSize() > 0) {
+        return font.pixelSize();
+    }
+    // Fonts are laid out for the screen, and the scene's units are its pixels
+    QScreen *screen = QGuiApplication::primaryScreen();
+    double dotsPerInch = (screen ? screen->logicalDotsPerInchY() : 96.0);
+    return font.pointSizeF() * dotsPerInch / 72.0;
+}
@@ -0,0 +1,72 @@
+#ifndef SVGWRITER_H_
+#define SVGWRITER_H_
+
+#include <QBrush>
+#include <QColor>
+#include <QFont>
+#include <QGraphicsItem>
+#include <QGraphicsScene>
+#include <QHash>
+#include <QLineF>
+#include <QPainterPath>
+#include <QPair>
+#include <QPen>
+#include <QPolygonF>
+#include <QSize>
+#include <QString>
+#include <QTransform>
+#include <QVector>
+#include <QXmlStreamWriter>
+
+/*
+ * Writes a scene out as SVG by walking its items, rather than painting it through QSvgGenerator,
+ * which writes out every atom's gradient and outline in full.  Every atom that looks the same,
+ * bar its size and position, shares one drawing in the <defs>, drawn at a fixed radius; each
+ * atom is then just a <use> of it, scaled to size.  The other items write themselves out as
+ * plain lines, paths and text.  The document is in the scene's units, and as big as the other
+ * image formats.
+ */
+class SvgWriter
+{
+  public:
+    SvgWriter(QGraphicsScene *scene, const QSize &size);
+
+    bool write(const QString &fileName);
+
+    // For the items writing themselves out, in their own coordinates
+    QXmlStreamWriter *xml()
+    {
+        return &myXml;
+    }
+    void writeLine(const QLineF &line, const QPen &pen);
+    void writePath(const QPainterPath &path, const QPen &pen, const QBrush &brush = QBrush());
+    void writePolygon(const QPolygonF &polygon, const QPen &pen, const QBrush &brush);
+    void writeCircle(const QPointF &center, double radius, const QBrush &brush);
+    // The position is that of the start of the text's baseline
+    void writeText(const QPointF &position, const QString &text, const QFont &font,
+                   const QColor &color);
+    // Writes the color, and its opacity if it has one, as the given attribute
+    void writeColor(const QString &attribute, const QColor &color);
+    void writePen(const QPen &pen);
+    void writeBrush(const QBrush &brush);
+
+    static QString number(double value);
+    static QString pathData(const QPainterPath &path);
+    // The size that Qt lays the font out at, in the scene's units
+    static double fontPixelSize(const QFont &font);
+
+  protected:
+    void collectItems();
+    void writeDefinitions();
+    void writeItem(QGraphicsItem *item, const QTransform &transform);
+
+    QGraphicsScene *myScene;
+    QSize mySize;
+    QXmlStreamWriter myXml;
+    // Everything to be drawn, back to front, with its transform to the scene
+    QVector<QPair<QGraphicsItem *, QTransform> > myItems;
+    // The id of the drawing shared by each kind of atom
+    QHash<QString, QString> mySymbols;
+};
+
+#endif /*SVGWRITER_H_*/
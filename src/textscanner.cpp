@@ -0,0 +1,227 @@
+#include "textscanner.h"
+
+#include <climits>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+
+// Powers of ten that are exactly representable as doubles
+static const double exactPowersOfTen[] = {1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,
+                                          1e8,  1e9,  1e10, 1e11, 1e12, 1e13, 1e14, 1e15,
+                                          1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+
+TextScanner::TextScanner(const char *begin, const char *end)
+    : myEnd(end), myNext(begin), myLineBegin(begin), myLineEnd(begin), myCursor(begin),
+      myFrameBegin(0)
+{
+}
+
+bool TextScanner::nextLine()
+{
+    if (myNext >= myEnd) {
+        myLineBegin = myLineEnd = myCursor = myEnd;
+        return false;
+    }
+    myLineBegin = myCursor = myNext;
+    const char *newline =
+        static_cast<const char *>(memchr(myNext, '\n', static_cast<size_t>(myEnd - myNext)));
+    if (newline == 0) {
+        myLineEnd = myNext = myEnd;
+    } else {
+        myLineEnd = newline;
+        myNext = newline + 1;
+    }
+    // Tolerate DOS line endings
+    if (myLineEnd > myLineBegin && myLineEnd[-1] == '\r') {
+        --myLineEnd;
+    }
+    return true;
+}
+
+bool TextScanner::lineIsBlank() const
+{
+    for (const char *c = myLineBegin; c < myLineEnd; ++c) {
+        if (!isBlank(*c)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Returns the first occurrence of text in [begin, end), or null if there isn't one
+const char *TextScanner::findText(const char *begin, const char *end, const char *text)
+{
+    size_t length = strlen(text);
+    if (length == 0) {
+        return begin;
+    }
+    while (end - begin >= static_cast<ptrdiff_t>(length)) {
+        const char *candidate = static_cast<const char *>(
+            memchr(begin, text[0], static_cast<size_t>(end - begin) - length + 1));
+        if (candidate == 0) {
+            return 0;
+        }
+        if (memcmp(candidate + 1, text + 1, length - 1) == 0) {
+            return candidate;
+        }
+        begin = candidate + 1;
+    }
+    return 0;
+}
+
+void TextScanner::skipBlanks()
+{
+    while (myCursor < myLineEnd && isBlank(*myCursor)) {
+        ++myCursor;
+    }
+}
+
+bool TextScanner::atEndOfLine()
+{
+    skipBlanks();
+    return myCursor >= myLineEnd;
+}
+
+bool TextScanner::readWord(const char *&begin, const char *&end)
+{
+    skipBlanks();
+    begin = myCursor;
+    while (myCursor < myLineEnd && !isBlank(*myCursor)) {
+        ++myCursor;
+    }
+    end = myCursor;
+    return end > begin;
+}
+
+bool TextScanner::readInt(int &value)
+{
+    skipBlanks();
+    const char *c = myCursor;
+    bool negative = false;
+    if (c < myLineEnd && (*c == '-' || *c == '+')) {
+        negative = (*c == '-');
+        ++c;
+    }
+    if (c >= myLineEnd || !isDigit(*c)) {
+        return false;
+    }
+    int result = 0;
+    while (c < myLineEnd && isDigit(*c)) {
+        int digit = *c - '0';
+        // Too many digits to fit is as unreadable as none at all
+        if (result > (INT_MAX - digit) / 10) {
+            return false;
+        }
+        result = 10 * result + digit;
+        ++c;
+    }
+    value = negative ? -result : result;
+    myCursor = c;
+    return true;
+}
+
+bool TextScanner::readDouble(double &value)
+{
+    skipBlanks();
+    const char *c = myCursor;
+    if (!parseDouble(c, myLineEnd, value)) {
+        return false;
+    }
+    // The number must be followed by whitespace, or the end of the line
+    if (c < myLineEnd && !isBlank(*c)) {
+        return false;
+    }
+    myCursor = c;
+    return true;
+}
+
+/*
+ * Parses a floating point number of the form [+-]digits[.digits][(eEdD)[+-]digits] starting at
+ * pos, leaving pos just after the number on success.  Up to 19 significant digits are accumulated
+ * into an integer, which is then scaled by a power of ten; when both are exactly representable
+ * (which covers every coordinate printed by the supported programs) the result is correctly
+ * rounded.
+ */
+bool TextScanner::parseDouble(const char *&pos, const char *end, double &value)
+{
+    const char *c = pos;
+    bool negative = false;
+    if (c < end && (*c == '-' || *c == '+')) {
+        negative = (*c == '-');
+        ++c;
+    }
+
+    quint64 mantissa = 0;
+    int significantDigits = 0;
+    int exponent = 0;
+    bool sawDigits = false;
+    while (c < end && isDigit(*c)) {
+        if (significantDigits < 19) {
+            mantissa = 10 * mantissa + (*c - '0');
+            if (mantissa) {
+                ++significantDigits;
+            }
+        } else {
+            ++exponent;
+        }
+        sawDigits = true;
+        ++c;
+    }
+    if (c < end && *c == '.') {
+        ++c;
+        while (c < end && isDigit(*c)) {
+            if (significantDigits < 19) {
+                mantissa = 10 * mantissa + (*c - '0');
+                if (mantissa) {
+                    ++significantDigits;
+                }
+                --exponent;
+            }
+            sawDigits = true;
+            ++c;
+        }
+    }
+    if (!sawDigits) {
+        return false;
+    }
+
+    // Fortran programs sometimes use D for the exponent
+    if (c < end && (*c == 'e' || *c == 'E' || *c == 'd' || *c == 'D')) {
+        const char *e = c + 1;
+        bool negativeExponent = false;
+        if (e < end && (*e == '-' || *e == '+')) {
+            negativeExponent = (*e == '-');
+            ++e;
+        }
+        if (e < end && isDigit(*e)) {
+            int explicitExponent = 0;
+            while (e < end && isDigit(*e)) {
+                if (explicitExponent < 10000) {
+                    explicitExponent = 10 * explicitExponent + (*e - '0');
+                }
+                ++e;
+            }
+            exponent += negativeExponent ? -explicitExponent : explicitExponent;
+            c = e;
+        }
+    }
+
+    double result;
+    if (mantissa == 0) {
+        result = 0.0;
+    } else if (mantissa < (Q_UINT64_C(1) << 53) && exponent >= -22 && exponent <= 22) {
+        result = static_cast<double>(mantissa);
+        if (exponent < 0) {
+            result /= exactPowersOfTen[-exponent];
+        } else {
+            result *= exactPowersOfTen[exponent];
+        }
+    } else {
+        // Rare enough that the extra precision is worth more than the speed
+        result = static_cast<double>(static_cast<long double>(mantissa) *
+                                     std::pow(10.0L, static_cast<long double>(exponent)));
+    }
+    value = negative ? -result : result;
+    pos = c;
+    return true;
+}
@@ -0,0 +1,83 @@
+#ifndef TEXTSCANNER_H_
+#define TEXTSCANNER_H_
+
+#include <QtGlobal>
+
+/*
+ * A hand-written, allocation-free tokenizer that walks a block of text in place.  The text is
+ * consumed one line at a time; within the current line, words and numbers are read from left
+ * to right.  Nothing is copied, so this is suitable for use on memory-mapped files.
+ */
+class TextScanner
+{
+  public:
+    TextScanner(const char *begin, const char *end);
+
+    // Advances to the next line of text, returning false if the end of the text was reached
+    bool nextLine();
+    bool atEnd() const
+    {
+        return myNext >= myEnd;
+    }
+    // The start of the line that nextLine() will move to
+    const char *position() const
+    {
+        return myNext;
+    }
+    void setPosition(const char *pos)
+    {
+        myNext = pos;
+        myLineBegin = myLineEnd = myCursor = pos;
+    }
+    const char *lineBegin() const
+    {
+        return myLineBegin;
+    }
+    // The end of the current line, with any newline and carriage return characters excluded
+    const char *lineEnd() const
+    {
+        return myLineEnd;
+    }
+    bool lineIsBlank() const;
+    // Remembers the current line as the one that introduced a frame; until then there's none
+    void markFrame()
+    {
+        myFrameBegin = myLineBegin;
+    }
+    const char *frameBegin() const
+    {
+        return myFrameBegin;
+    }
+    bool lineContains(const char *text) const
+    {
+        return findText(myLineBegin, myLineEnd, text) != 0;
+    }
+
+    // These operate on the remainder of the current line
+    void skipBlanks();
+    bool atEndOfLine();
+    bool readWord(const char *&begin, const char *&end);
+    bool readInt(int &value);
+    bool readDouble(double &value);
+
+    static bool isBlank(char c)
+    {
+        return c == ' ' || c == '\t' || c == '\r' || c == '\f' || c == '\v';
+    }
+    static bool isDigit(char c)
+    {
+        return c >= '0' && c <= '9';
+    }
+    static const char *findText(const char *begin, const char *end, const char *text);
+    static bool parseDouble(const char *&pos, const char *end, double &value);
+
+  private:
+    const char *myEnd;
+    const char *myNext;
+    const char *myLineBegin;
+    const char *myLineEnd;
+    const char *myCursor;
+    const char *myFrameBegin;
+};
+
+#endif /*TEXTSCANNER_H_*/
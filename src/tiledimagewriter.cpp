@@ -0,0 +1,383 @@
+#include "tiledimagewriter.h"
+
+#include <cstring>
+
+#include <QImage>
+#include <QMutexLocker>
+#include <QPainter>
+#include <QRunnable>
+#include <QThread>
+#include <QThreadPool>
+#include <zlib.h>
+
+#include "defines.h"
+#include "imagewriter.h"
+
+static const char pngSignature[8] = {'\x89', 'P', 'N', 'G', '\r', '\n', '\x1a', '\n'};
+
+// The image data is written out in chunks of about this size
+#define PNG_IDAT_SIZE (256 * 1024)
+
+// The TIFF field types used here
+#define TIFF_SHORT 3
+#define TIFF_LONG 4
+#define TIFF_RATIONAL 5
+
+// Compresses one band as raw deflate blocks ending on a byte boundary, so that the bands can be
+// strung together after a single zlib header
+static QByteArray deflateBand(const uchar *data, int size)
+{
+    z_stream stream;
+    std::memset(&stream, 0, sizeof(stream));
+    deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY);
+    QByteArray compressed(int(deflateBound(&stream, size)) + 16, Qt::Uninitialized);
+    stream.next_in = const_cast<Bytef *>(data);
+    stream.avail_in = size;
+    stream.next_out = reinterpret_cast<Bytef *>(compressed.data());
+    stream.avail_out = compressed.size();
+    deflate(&stream, Z_SYNC_FLUSH);
+    compressed.resize(int(stream.total_out));
+    deflateEnd(&stream);
+    return compressed;
+}
+
+static void appendUInt32(QByteArray &data, quint32 value)
+{
+    data.append(char(value >> 24));
+    data.append(char(value >> 16));
+    data.append(char(value >> 8));
+    data.append(char(value));
+}
+
+// TIFFs are written little endian, which is what's marked in the header
+static void appendLittleUInt16(QByteArray &data, quint16 value)
+{
+    data.append(char(value));
+    data.append(char(value >> 8));
+}
+
+static void appendLittleUInt32(QByteArray &data, quint32 value)
+{
+    data.append(char(value));
+    data.append(char(value >> 8));
+    data.append(char(value >> 16));
+    data.append(char(value >> 24));
+}
+
+static void appendTIFFEntry(QByteArray &ifd, quint16 tag, quint16 type, quint32 count,
+                            quint32 value)
+{
+    appendLittleUInt16(ifd, tag);
+    appendLittleUInt16(ifd, type);
+    appendLittleUInt32(ifd, count);
+    // A single short sits at the start of the value field
+    if (type == TIFF_SHORT && count == 1) {
+        appendLittleUInt16(ifd, quint16(value));
+        appendLittleUInt16(ifd, 0);
+    } else {
+        appendLittleUInt32(ifd, value);
+    }
+}
+
+class BandTask : public QRunnable
+{
+  public:
+    BandTask(TiledImageWriter *writer, int band, int firstRow, int numRows)
+        : myWriter(writer), myBand(band), myFirstRow(firstRow), myNumRows(numRows)
+    {
+    }
+
+    void run()
+    {
+        myWriter->bandDone(myBand, myWriter->renderBand(myFirstRow, myNumRows));
+    }
+
+  protected:
+    TiledImageWriter *myWriter;
+    int myBand;
+    int myFirstRow;
+    int myNumRows;
+};
+
+TiledImageWriter::TiledImageWriter(QGraphicsScene *scene, const QSize &size, int dotsPerInch)
+    : mySize(size), myDotsPerInch(dotsPerInch), myNumThreads(0), myFormat(PNG), myAdler(1)
+{
+    // The scene's items can only be looked at from the thread that owns them, so they're drawn
+    // here, once, and the workers only play the recording back
+    ImageWriter::render(scene, &myPicture, QRectF(QPointF(0.0, 0.0), QSizeF(size)));
+}
+
+bool TiledImageWriter::write(const QString &fileName, Format format)
+{
+    myFormat = format;
+    myFile.setFileName(fileName);
+    if (!myFile.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        return false;
+    }
+    bool ok = (format == PNG ? writePNGHeader() : writeTIFFHeader());
+
+    int rowsPerBand = qMax(1, IMAGE_BAND_BYTES / (4 * mySize.width()));
+    int numBands = (mySize.height() + rowsPerBand - 1) / rowsPerBand;
+    int numThreads = (myNumThreads > 0 ? myNumThreads : QThread::idealThreadCount());
+    int maxPending = numThreads * IMAGE_BANDS_PER_THREAD;
+
+    QThreadPool pool;
+    pool.setMaxThreadCount(numThreads);
+    myFinishedBands.clear();
+    int nextBand = 0;
+    for (int band = 0; ok && band < numBands; ++band) {
+        // Keep the workers busy, but don't get so far ahead that the bands pile up
+        while (nextBand < numBands && nextBand - band < maxPending) {
+            int firstRow = nextBand * rowsPerBand;
+            int numRows = qMin(rowsPerBand, mySize.height() - firstRow);
+            pool.start(new BandTask(this, nextBand, firstRow, numRows));
+            ++nextBand;
+        }
+        Band rendered = waitForBand(band);
+        ok = (format == PNG ? writePNGBand(rendered) : writeTIFFBand(rendered));
+    }
+    pool.clear();
+    pool.waitForDone();
+    myFinishedBands.clear();
+
+    if (ok) {
+        ok = (format == PNG ? finishPNG() : finishTIFF(rowsPerBand));
+    }
+    myFile.close();
+    if (!ok) {
+        myFile.remove();
+    }
+    return ok;
+}
+
+TiledImageWriter::Band TiledImageWriter::renderBand(int firstRow, int numRows) const
+{
+    int width = mySize.width();
+    int rowBytes = 4 * width;
+    // PNG rows each start with the filter type
+    int filteredRowBytes = (myFormat == PNG ? rowBytes + 1 : rowBytes);
+    QByteArray filtered(numRows * filteredRowBytes, Qt::Uninitialized);
+    {
+        // A picture can't be played on two threads at once, so each band has its own copy
+        QPicture picture;
+        picture.setData(myPicture.data(), myPicture.size());
+        QImage image(width, numRows, QImage::Format_ARGB32_Premultiplied);
+        image.fill(Qt::transparent);
+        QPainter painter(&image);
+        painter.setRenderHint(QPainter::SmoothPixmapTransform, true);
+        painter.setRenderHint(QPainter::Antialiasing, true);
+        painter.setRenderHint(QPainter::HighQualityAntialiasing, true);
+        painter.translate(0.0, -firstRow);
+        painter.drawPicture(0, 0, picture);
+        painter.end();
+
+        // Each byte is stored as the difference from the one a pixel to the left, which is PNG's
+        // Sub filter and TIFF's horizontal predictor alike
+        uchar *out = reinterpret_cast<uchar *>(filtered.data());
+        for (int row = 0; row < numRows; ++row) {
+            const QRgb *line = reinterpret_cast<const QRgb *>(image.constScanLine(row));
+            if (myFormat == PNG) {
+                *out++ = 1;
+            }
+            uchar previous[4] = {0, 0, 0, 0};
+            for (int x = 0; x < width; ++x) {
+                QRgb pixel = qUnpremultiply(line[x]);
+                uchar rgba[4] = {uchar(qRed(pixel)), uchar(qGreen(pixel)), uchar(qBlue(pixel)),
+                                 uchar(qAlpha(pixel))};
+                for (int k = 0; k < 4; ++k) {
+                    *out++ = uchar(rgba[k] - previous[k]);
+                    previous[k] = rgba[k];
+                }
+            }
+        }
+    }
+
+    Band band;
+    const uchar *data = reinterpret_cast<const uchar *>(filtered.constData());
+    band.size = filtered.size();
+    if (myFormat == PNG) {
+        band.data = deflateBand(data, filtered.size());
+        band.adler = adler32(adler32(0, Z_NULL, 0), data, filtered.size());
+    } else {
+        // Each TIFF strip is a zlib stream of its own, which is just what Qt makes, bar the length
+        // that it puts in front
+        band.data = qCompress(data, filtered.size()).mid(4);
+        band.adler = 0;
+    }
+    return band;
+}
+
+void TiledImageWriter::bandDone(int band, const Band &rendered)
+{
+    QMutexLocker locker(&myLock);
+    myFinishedBands.insert(band, rendered);
+    myBandReady.wakeAll();
+}
+
+TiledImageWriter::Band TiledImageWriter::waitForBand(int band)
+{
+    QMutexLocker locker(&myLock);
+    while (!myFinishedBands.contains(band)) {
+        myBandReady.wait(&myLock);
+    }
+    return myFinishedBands.take(band);
+}
+
+bool TiledImageWriter::writePNGHeader()
+{
+    myFile.write(pngSignature, sizeof(pngSignature));
+
+    QByteArray header;
+    appendUInt32(header, mySize.width());
+    appendUInt32(header, mySize.height());
+    // 8 bits per channel, RGBA, and the standard compression, filtering and no interlacing
+    header.append(char(8));
+    header.append(char(6));
+    header.append(char(0));
+    header.append(char(0));
+    header.append(char(0));
+    writeChunk("IHDR", header);
+
+    QByteArray resolution;
+    quint32 dotsPerMeter = qRound(myDotsPerInch / 0.0254);
+    appendUInt32(resolution, dotsPerMeter);
+    appendUInt32(resolution, dotsPerMeter);
+    resolution.append(char(1));
+    writeChunk("pHYs", resolution);
+
+    // The zlib header for a 32k window and the default compression level
+    myPendingData = QByteArray("\x78\x9c", 2);
+    myAdler = adler32(0, Z_NULL, 0);
+    return myFile.error() == QFile::NoError;
+}
+
+bool TiledImageWriter::writePNGBand(const Band &band)
+{
+    myPendingData.append(band.data);
+    myAdler = adler32_combine(myAdler, band.adler, band.size);
+    if (myPendingData.size() >= PNG_IDAT_SIZE) {
+        writeChunk("IDAT", myPendingData);
+        myPendingData.clear();
+    }
+    return myFile.error() == QFile::NoError;
+}
+
+bool TiledImageWriter::finishPNG()
+{
+    // An empty final block, fixed Huffman codes, closes the stream
+    myPendingData.append(QByteArray("\x03\x00", 2));
+    appendUInt32(myPendingData, myAdler);
+    writeChunk("IDAT", myPendingData);
+    myPendingData.clear();
+    writeChunk("IEND", QByteArray());
+    return myFile.error() == QFile::NoError;
+}
+
+bool TiledImageWriter::writeTIFFHeader()
+{
+    // The offset of the directory is filled in once the strips have all been written
+    QByteArray header("II");
+    appendLittleUInt16(header, 42);
+    appendLittleUInt32(header, 0);
+    myFile.write(header);
+    myStripOffsets.clear();
+    myStripSizes.clear();
+    return myFile.error() == QFile::NoError;
+}
+
+bool TiledImageWriter::writeTIFFBand(const Band &band)
+{
+    // The offsets are only 32 bits
+    qint64 offset = myFile.pos();
+    if (offset + band.data.size() > Q_INT64_C(0xffffffff)) {
+        return false;
+    }
+    myStripOffsets.append(quint32(offset));
+    myStripSizes.append(quint32(band.data.size()));
+    myFile.write(band.data);
+    return myFile.error() == QFile::NoError;
+}
+
+bool TiledImageWriter::finishTIFF(int rowsPerStrip)
+{
+    // Everything too big to fit in the directory goes just before it, starting on a word boundary
+    qint64 start = myFile.pos() + (myFile.pos() & 1);
+    QByteArray values;
+    if (myFile.pos() & 1) {
+        myFile.write("", 1);
+    }
+    quint32 bitsPerSampleOffset = quint32(start + values.size());
+    for (int k = 0; k < 4; ++k) {
+        appendLittleUInt16(values, 8);
+    }
+    quint32 resolutionOffset = quint32(start + values.size());
+    appendLittleUInt32(values, myDotsPerInch);
+    appendLittleUInt32(values, 1);
+    // A single strip's offset and size fit in the directory itself
+    int numStrips = myStripOffsets.size();
+    quint32 stripOffsets = myStripOffsets.first();
+    quint32 stripSizes = myStripSizes.first();
+    if (numStrips > 1) {
+        stripOffsets = quint32(start + values.size());
+        foreach (quint32 offset, myStripOffsets) {
+            appendLittleUInt32(values, offset);
+        }
+        stripSizes = quint32(start + values.size());
+        foreach (quint32 size, myStripSizes) {
+            appendLittleUInt32(values, size);
+        }
+    }
+    qint64 ifdOffset = start + values.size();
+    if (ifdOffset + 6 + 15 * 12 > Q_INT64_C(0xffffffff)) {
+        return false;
+    }
+
+    // The entries must be in order of their tags
+    QByteArray ifd;
+    appendLittleUInt16(ifd, 15);
+    appendTIFFEntry(ifd, 256, TIFF_LONG, 1, mySize.width());
+    appendTIFFEntry(ifd, 257, TIFF_LONG, 1, mySize.height());
+    appendTIFFEntry(ifd, 258, TIFF_SHORT, 4, bitsPerSampleOffset);
+    // Deflate
+    appendTIFFEntry(ifd, 259, TIFF_SHORT, 1, 8);
+    // RGB
+    appendTIFFEntry(ifd, 262, TIFF_SHORT, 1, 2);
+    appendTIFFEntry(ifd, 273, TIFF_LONG, numStrips, stripOffsets);
+    appendTIFFEntry(ifd, 277, TIFF_SHORT, 1, 4);
+    appendTIFFEntry(ifd, 278, TIFF_LONG, 1, rowsPerStrip);
+    appendTIFFEntry(ifd, 279, TIFF_LONG, numStrips, stripSizes);
+    // Both resolutions are the same, so they share the one value
+    appendTIFFEntry(ifd, 282, TIFF_RATIONAL, 1, resolutionOffset);
+    appendTIFFEntry(ifd, 283, TIFF_RATIONAL, 1, resolutionOffset);
+    // The samples are interleaved
+    appendTIFFEntry(ifd, 284, TIFF_SHORT, 1, 1);
+    // Inches
+    appendTIFFEntry(ifd, 296, TIFF_SHORT, 1, 2);
+    // Horizontal differencing
+    appendTIFFEntry(ifd, 317, TIFF_SHORT, 1, 2);
+    // The alpha isn't premultiplied
+    appendTIFFEntry(ifd, 338, TIFF_SHORT, 1, 2);
+    appendLittleUInt32(ifd, 0);
+
+    myFile.write(values);
+    myFile.write(ifd);
+    QByteArray offset;
+    appendLittleUInt32(offset, quint32(ifdOffset));
+    myFile.seek(4);
+    myFile.write(offset);
+    return myFile.error() == QFile::NoError;
+}
+
+void TiledImageWriter::writeChunk(const char *type, const QByteArray &data)
+{
+    QByteArray chunk;
+    appendUInt32(chunk, data.size());
+    chunk.append(type, 4);
+    myFile.write(chunk);
+    myFile.write(data);
+    QByteArray crc;
+    quint32 checksum = crc32(crc32(0, reinterpret_cast<const Bytef *>(type), 4),
+                             reinterpret_cast<const Bytef *>(data.constData()), data.size());
+    appendUInt32(crc, checksum);
+    myFile.write(crc);
+}
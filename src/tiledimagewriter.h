@@ -0,0 +1,78 @@
+#ifndef TILEDIMAGEWRITER_H_
+#define TILEDIMAGEWRITER_H_
+
+#include <QByteArray>
+#include <QFile>
+#include <QGraphicsScene>
+#include <QList>
+#include <QMap>
+#include <QMutex>
+#include <QPicture>
+#include <QSize>
+#include <QString>
+#include <QWaitCondition>
+
+/*
+ * Writes a scene out as a PNG or TIFF of any size, without ever holding the whole image.  The
+ * scene is recorded once, as drawing commands, which are then played back into one band of rows
+ * at a time, on a thread pool; each band is filtered and compressed by the thread that drew it.
+ * The bands are written out in order as they arrive, and only a few are kept waiting, so the
+ * memory needed depends on the width of the image and not its area.
+ */
+class TiledImageWriter
+{
+  public:
+    enum Format { PNG, TIFF };
+
+    TiledImageWriter(QGraphicsScene *scene, const QSize &size, int dotsPerInch);
+
+    // Zero threads means one for each core
+    void setNumThreads(int n)
+    {
+        myNumThreads = n;
+    }
+    bool write(const QString &fileName, Format format);
+
+  protected:
+    struct Band {
+        // The band's rows, filtered and compressed
+        QByteArray data;
+        // For PNGs, the checksum of the filtered rows, and how many bytes they came to
+        quint32 adler;
+        qint64 size;
+    };
+    friend class BandTask;
+
+    // Run on the worker threads
+    Band renderBand(int firstRow, int numRows) const;
+    void bandDone(int band, const Band &rendered);
+    // Run on the calling thread
+    Band waitForBand(int band);
+
+    bool writePNGHeader();
+    bool writePNGBand(const Band &band);
+    bool finishPNG();
+    bool writeTIFFHeader();
+    bool writeTIFFBand(const Band &band);
+    bool finishTIFF(int rowsPerStrip);
+    void writeChunk(const char *type, const QByteArray &data);
+
+    QSize mySize;
+    int myDotsPerInch;
+    int myNumThreads;
+    Format myFormat;
+    // The scene, already drawn at the size of the image
+    QPicture myPicture;
+
+    QFile myFile;
+    QByteArray myPendingData;
+    quint32 myAdler;
+    QList<quint32> myStripOffsets;
+    QList<quint32> myStripSizes;
+
+    QMutex myLock;
+    QWaitCondition myBandReady;
+    QMap<int, Band> myFinishedBands;
+};
+
+#endif /*TILEDIMAGEWRITER_H_*/